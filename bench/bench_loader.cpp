@@ -0,0 +1,602 @@
+// Loader benchmark: writes a synthetic glTF corpus of configurable size, loads it repeatedly
+// and reports the time of every loader stage, throughput and peak memory as JSON.
+//
+// Usage: glTF-Bench [--vertices N] [--meshes N] [--nodes N] [--materials N] [--images N]
+//                   [--image-size N] [--buffers N] [--layout external|embedded|glb]
+//                   [--iterations N] [--workers N] [--no-mmap] [--optimize]
+//                   [--overdraw THRESHOLD] [--meshlets] [--lods N] [--cluster-lod]
+//                   [--encode-vertices] [--normal-bits 8|16] [--dir PATH] [--out FILE]
+
+#include "../include/glTF_loader.h"
+#include "../include/baked_model.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+
+// The shape of the generated corpus and how it is loaded
+struct BenchConfig {
+	unsigned int vertices = 10000;   // Vertices per mesh
+	unsigned int meshes = 16;        // Meshes, each with one indexed triangle primitive
+	unsigned int nodes = 16;         // Nodes, each instancing a mesh round robin
+	unsigned int materials = 4;      // Materials, each sampling an image round robin
+	unsigned int images = 4;         // PNG images
+	unsigned int imageSize = 256;    // The width and height of every image
+	unsigned int buffers = 1;        // External buffers the geometry is split across
+	std::string layout = "external"; // external, embedded or glb
+	unsigned int iterations = 5;     // Loads to time, the median is reported
+	unsigned int workers = 0;        // Loader worker threads, 0 for one per hardware thread
+	bool memoryMap = true;           // Whether buffer files are mapped
+	bool optimize = false;           // Whether assembly runs the vertex cache and fetch passes
+	float overdraw = 0.0f;           // The threshold assembly optimizes overdraw with, 0 to leave it
+	bool meshlets = false;           // Whether assembly cuts the triangles into meshlets
+	unsigned int lods = 0;           // The coarser levels assembly simplifies every mesh into
+	bool clusterLod = false;         // Whether assembly builds a cluster hierarchy over every mesh
+	bool encodeVertices = false;     // Whether assembly quantizes positions, encodes normals and stores half texture coordinates
+	unsigned int normalBits = 16;    // The bits of each octahedral normal component
+	std::string directory = "bench_corpus/";
+	std::string output;              // The JSON report, stdout when empty
+};
+
+// What was written to disk
+struct Corpus {
+	std::string modelPath;
+	size_t jsonBytes = 0;
+	size_t bufferBytes = 0;
+	size_t imageBytes = 0;
+	size_t objects = 0;              // Every record of every table
+	size_t vertices = 0;
+};
+
+
+static uint32_t crcTable[256];
+
+static uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+{
+	if (crcTable[1] == 0) {
+		for (uint32_t n = 0; n != 256; ++n) {
+			uint32_t c = n;
+			for (int k = 0; k != 8; ++k) {
+				c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			crcTable[n] = c;
+		}
+	}
+	crc = ~crc;
+	for (size_t i = 0; i != size; ++i) {
+		crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static void appendBigEndian(std::vector<unsigned char>& out, uint32_t value)
+{
+	out.push_back(static_cast<unsigned char>(value >> 24));
+	out.push_back(static_cast<unsigned char>(value >> 16));
+	out.push_back(static_cast<unsigned char>(value >> 8));
+	out.push_back(static_cast<unsigned char>(value));
+}
+
+static void appendChunk(std::vector<unsigned char>& png, const char* type, const std::vector<unsigned char>& data)
+{
+	appendBigEndian(png, static_cast<uint32_t>(data.size()));
+	const size_t start = png.size();
+	png.insert(png.end(), type, type + 4);
+	png.insert(png.end(), data.begin(), data.end());
+	appendBigEndian(png, crc32(png.data() + start, png.size() - start));
+}
+
+// An RGBA PNG with stored (uncompressed) deflate blocks, valid for any decoder without needing a compressor
+static std::vector<unsigned char> makePNG(unsigned int size, unsigned int seed)
+{
+	std::vector<unsigned char> raw;
+	raw.reserve((size * 4 + 1) * size);
+	for (unsigned int y = 0; y != size; ++y) {
+		raw.push_back(0);
+		for (unsigned int x = 0; x != size; ++x) {
+			raw.push_back(static_cast<unsigned char>(x * 255 / size));
+			raw.push_back(static_cast<unsigned char>(y * 255 / size));
+			raw.push_back(static_cast<unsigned char>(seed * 37));
+			raw.push_back(255);
+		}
+	}
+
+	std::vector<unsigned char> zlib = { 0x78, 0x01 };
+	for (size_t offset = 0; offset < raw.size() || offset == 0; offset += 65535) {
+		const size_t length = std::min<size_t>(65535, raw.size() - offset);
+		zlib.push_back(offset + length == raw.size() ? 1 : 0);
+		zlib.push_back(static_cast<unsigned char>(length));
+		zlib.push_back(static_cast<unsigned char>(length >> 8));
+		zlib.push_back(static_cast<unsigned char>(~length));
+		zlib.push_back(static_cast<unsigned char>(~length >> 8));
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+	}
+	uint32_t a = 1, b = 0;
+	for (unsigned char byte : raw) {
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	appendBigEndian(zlib, (b << 16) | a);
+
+	std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::vector<unsigned char> header;
+	appendBigEndian(header, size);
+	appendBigEndian(header, size);
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });
+	appendChunk(png, "IHDR", header);
+	appendChunk(png, "IDAT", zlib);
+	appendChunk(png, "IEND", std::vector<unsigned char>());
+	return png;
+}
+
+static std::string base64Encode(const std::vector<unsigned char>& bytes)
+{
+	const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	std::string text;
+	text.reserve((bytes.size() + 2) / 3 * 4);
+	for (size_t i = 0; i < bytes.size(); i += 3) {
+		const uint32_t triple = (bytes[i] << 16) |
+			(i + 1 < bytes.size() ? bytes[i + 1] << 8 : 0) |
+			(i + 2 < bytes.size() ? bytes[i + 2] : 0);
+		text += alphabet[(triple >> 18) & 63];
+		text += alphabet[(triple >> 12) & 63];
+		text += i + 1 < bytes.size() ? alphabet[(triple >> 6) & 63] : '=';
+		text += i + 2 < bytes.size() ? alphabet[triple & 63] : '=';
+	}
+	return text;
+}
+
+static void append(std::vector<unsigned char>& out, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	out.insert(out.end(), bytes, bytes + size);
+}
+
+static bool writeFile(const std::string& path, const void* data, size_t size)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(static_cast<const char*>(data), size);
+	return static_cast<bool>(file);
+}
+
+// Write the corpus described by the config, returns false if a file could not be written
+static bool generateCorpus(const BenchConfig& config, Corpus& corpus)
+{
+	const bool glb = config.layout == "glb";
+	const bool embedded = config.layout == "embedded";
+	const unsigned int bufferCount = glb ? 1 : std::max(1u, config.buffers);
+	const bool wideIndices = config.vertices > 65535;
+	const size_t indexSize = wideIndices ? 4 : 2;
+
+	json document;
+	document["asset"] = { { "version", "2.0" }, { "generator", "glTF-Bench" } };
+	json& accessors = document["accessors"] = json::array();
+	json& bufferViews = document["bufferViews"] = json::array();
+	std::vector<std::vector<unsigned char>> buffers(bufferCount);
+
+	auto addView = [&](unsigned int buffer, const void* data, size_t size, unsigned int target) {
+		std::vector<unsigned char>& bytes = buffers[buffer];
+		bytes.resize((bytes.size() + 3) & ~size_t(3));
+		json view = { { "buffer", buffer }, { "byteOffset", bytes.size() }, { "byteLength", size } };
+		if (target != 0) {
+			view["target"] = target;
+		}
+		append(bytes, data, size);
+		bufferViews.push_back(view);
+		return bufferViews.size() - 1;
+	};
+
+	// Every mesh is a sheet of rolling hills, a grid of vertices with two triangles over every cell facing up
+	json& meshes = document["meshes"] = json::array();
+	const unsigned int columns = std::max(2u, std::min(256u, static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<double>(config.vertices))))));
+	const unsigned int rows = (config.vertices + columns - 1) / columns;
+	for (unsigned int mesh = 0; mesh != config.meshes; ++mesh) {
+		const unsigned int buffer = mesh % bufferCount;
+		std::vector<float> positions(config.vertices * 3), normals(config.vertices * 3), texCoords(config.vertices * 2);
+		const float phase = mesh * 0.7f;
+		for (unsigned int v = 0; v != config.vertices; ++v) {
+			const float x = static_cast<float>(v % columns);
+			const float z = static_cast<float>(v / columns);
+			const float sx = std::sin(x * 0.1f + phase), cx = std::cos(x * 0.1f + phase);
+			const float sz = std::sin(z * 0.1f), cz = std::cos(z * 0.1f);
+			positions[v * 3 + 0] = x;
+			positions[v * 3 + 1] = 4.0f * sx * cz;
+			positions[v * 3 + 2] = z;
+			// The normal of the height field is (-dy/dx, 1, -dy/dz)
+			const float nx = -0.4f * cx * cz, nz = 0.4f * sx * sz;
+			const float length = std::sqrt(nx * nx + 1.0f + nz * nz);
+			normals[v * 3 + 0] = nx / length;
+			normals[v * 3 + 1] = 1.0f / length;
+			normals[v * 3 + 2] = nz / length;
+			texCoords[v * 2 + 0] = x / (columns - 1);
+			texCoords[v * 2 + 1] = z / std::max(1u, rows - 1);
+		}
+		float bounds[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		for (unsigned int v = 0; v != config.vertices; ++v) {
+			for (size_t axis = 0; axis != 3; ++axis) {
+				bounds[axis] = std::min(bounds[axis], positions[v * 3 + axis]);
+				bounds[axis + 3] = std::max(bounds[axis + 3], positions[v * 3 + axis]);
+			}
+		}
+		std::vector<uint32_t> cells;
+		for (unsigned int v = 0; v + columns + 1 < config.vertices; ++v) {
+			if (v % columns == columns - 1) {
+				continue;
+			}
+			const uint32_t corners[6] = { v, v + columns, v + 1, v + 1, v + columns, v + columns + 1 };
+			cells.insert(cells.end(), corners, corners + 6);
+		}
+		const size_t triangles = cells.size() / 3;
+		std::vector<unsigned char> indices(cells.size() * indexSize);
+		for (size_t i = 0; i != cells.size(); ++i) {
+			std::memcpy(indices.data() + i * indexSize, &cells[i], indexSize);
+		}
+
+		const size_t first = accessors.size();
+		accessors.push_back({ { "bufferView", addView(buffer, positions.data(), positions.size() * 4, 34962) },
+			{ "componentType", 5126 }, { "count", config.vertices }, { "type", "VEC3" },
+			{ "min", { bounds[0], bounds[1], bounds[2] } }, { "max", { bounds[3], bounds[4], bounds[5] } } });
+		accessors.push_back({ { "bufferView", addView(buffer, normals.data(), normals.size() * 4, 34962) },
+			{ "componentType", 5126 }, { "count", config.vertices }, { "type", "VEC3" } });
+		accessors.push_back({ { "bufferView", addView(buffer, texCoords.data(), texCoords.size() * 4, 34962) },
+			{ "componentType", 5126 }, { "count", config.vertices }, { "type", "VEC2" } });
+		accessors.push_back({ { "bufferView", addView(buffer, indices.data(), indices.size(), 34963) },
+			{ "componentType", wideIndices ? 5125 : 5123 }, { "count", triangles * 3 }, { "type", "SCALAR" } });
+
+		json primitive = { { "attributes", { { "POSITION", first }, { "NORMAL", first + 1 }, { "TEXCOORD_0", first + 2 } } },
+			{ "indices", first + 3 }, { "mode", 4 } };
+		if (config.materials != 0) {
+			primitive["material"] = mesh % config.materials;
+		}
+		meshes.push_back({ { "primitives", { primitive } } });
+		corpus.vertices += config.vertices;
+	}
+
+	// Images live next to the model, inside data URIs, or in the BIN chunk
+	json& images = document["images"] = json::array();
+	for (unsigned int image = 0; image != config.images; ++image) {
+		const std::vector<unsigned char> png = makePNG(config.imageSize, image);
+		corpus.imageBytes += png.size();
+		if (glb) {
+			images.push_back({ { "bufferView", addView(0, png.data(), png.size(), 0) }, { "mimeType", "image/png" } });
+		}
+		else if (embedded) {
+			images.push_back({ { "uri", "data:image/png;base64," + base64Encode(png) } });
+		}
+		else {
+			const std::string name = "image" + std::to_string(image) + ".png";
+			if (!writeFile(config.directory + name, png.data(), png.size())) {
+				return false;
+			}
+			images.push_back({ { "uri", name } });
+		}
+	}
+	document["samplers"] = { { { "magFilter", 9729 }, { "minFilter", 9987 }, { "wrapS", 10497 }, { "wrapT", 10497 } } };
+	json& textures = document["textures"] = json::array();
+	json& materials = document["materials"] = json::array();
+	for (unsigned int material = 0; material != config.materials; ++material) {
+		json pbr = { { "baseColorFactor", { 1.0, 1.0, 1.0, 1.0 } } };
+		if (config.images != 0) {
+			textures.push_back({ { "sampler", 0 }, { "source", material % config.images } });
+			pbr["baseColorTexture"] = { { "index", textures.size() - 1 } };
+		}
+		materials.push_back({ { "name", "material" + std::to_string(material) }, { "pbrMetallicRoughness", pbr } });
+	}
+
+	json& nodes = document["nodes"] = json::array();
+	json roots = json::array();
+	for (unsigned int node = 0; node != config.nodes; ++node) {
+		json record = { { "translation", { node * 2.0, 0.0, 0.0 } } };
+		if (config.meshes != 0) {
+			record["mesh"] = node % config.meshes;
+		}
+		nodes.push_back(record);
+		roots.push_back(node);
+	}
+	document["scenes"] = { { { "nodes", roots } } };
+	document["scene"] = 0;
+
+	json& bufferTable = document["buffers"] = json::array();
+	for (unsigned int buffer = 0; buffer != bufferCount; ++buffer) {
+		const std::vector<unsigned char>& bytes = buffers[buffer];
+		corpus.bufferBytes += bytes.size();
+		if (glb) {
+			bufferTable.push_back({ { "byteLength", bytes.size() } });
+		}
+		else if (embedded) {
+			bufferTable.push_back({ { "byteLength", bytes.size() }, { "uri", "data:application/octet-stream;base64," + base64Encode(bytes) } });
+		}
+		else {
+			const std::string name = "buffer" + std::to_string(buffer) + ".bin";
+			if (!writeFile(config.directory + name, bytes.data(), bytes.size())) {
+				return false;
+			}
+			bufferTable.push_back({ { "byteLength", bytes.size() }, { "uri", name } });
+		}
+	}
+
+	corpus.objects = accessors.size() + bufferViews.size() + bufferTable.size() + meshes.size() +
+		images.size() + textures.size() + materials.size() + nodes.size() + 2;
+
+	std::string text = document.dump();
+	corpus.jsonBytes = text.size();
+	if (!glb) {
+		corpus.modelPath = config.directory + "model.gltf";
+		return writeFile(corpus.modelPath, text.data(), text.size());
+	}
+
+	// Both chunks are padded to 4 bytes, JSON with spaces and BIN with zeros
+	text.resize((text.size() + 3) & ~size_t(3), ' ');
+	std::vector<unsigned char> bin = buffers[0];
+	bin.resize((bin.size() + 3) & ~size_t(3), 0);
+	std::vector<unsigned char> container;
+	const uint32_t header[3] = { GLB_MAGIC, 2, static_cast<uint32_t>(GLB_HEADER_SIZE + 2 * GLB_CHUNK_HEADER_SIZE + text.size() + bin.size()) };
+	append(container, header, sizeof(header));
+	const uint32_t jsonChunk[2] = { static_cast<uint32_t>(text.size()), GLB_CHUNK_JSON };
+	append(container, jsonChunk, sizeof(jsonChunk));
+	append(container, text.data(), text.size());
+	const uint32_t binChunk[2] = { static_cast<uint32_t>(bin.size()), GLB_CHUNK_BIN };
+	append(container, binChunk, sizeof(binChunk));
+	append(container, bin.data(), bin.size());
+	corpus.modelPath = config.directory + "model.glb";
+	return writeFile(corpus.modelPath, container.data(), container.size());
+}
+
+static size_t peakResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return static_cast<size_t>(usage.ru_maxrss);
+#else
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+// The samples of one stage, in seconds
+struct Samples {
+	std::vector<double> seconds;
+
+	double median() const {
+		if (seconds.empty()) {
+			return 0.0;
+		}
+		std::vector<double> sorted = seconds;
+		std::sort(sorted.begin(), sorted.end());
+		return sorted[sorted.size() / 2];
+	}
+	double best() const { return seconds.empty() ? 0.0 : *std::min_element(seconds.begin(), seconds.end()); }
+	json report() const { return { { "median", median() }, { "min", best() } }; }
+};
+
+static bool parseArguments(int argc, char** argv, BenchConfig& config)
+{
+	bool nodesGiven = false;
+	for (int i = 1; i < argc; ++i) {
+		const std::string name = argv[i];
+		if (name == "--no-mmap") {
+			config.memoryMap = false;
+			continue;
+		}
+		if (name == "--optimize") {
+			config.optimize = true;
+			continue;
+		}
+		if (name == "--meshlets") {
+			config.meshlets = true;
+			continue;
+		}
+		if (name == "--cluster-lod") {
+			config.clusterLod = true;
+			continue;
+		}
+		if (name == "--encode-vertices") {
+			config.encodeVertices = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			std::cout << "Missing value for " << name << std::endl;
+			return false;
+		}
+		const std::string value = argv[++i];
+		if (name == "--vertices") config.vertices = std::stoul(value);
+		else if (name == "--meshes") config.meshes = std::stoul(value);
+		else if (name == "--nodes") { config.nodes = std::stoul(value); nodesGiven = true; }
+		else if (name == "--materials") config.materials = std::stoul(value);
+		else if (name == "--images") config.images = std::stoul(value);
+		else if (name == "--image-size") config.imageSize = std::stoul(value);
+		else if (name == "--buffers") config.buffers = std::stoul(value);
+		else if (name == "--layout") config.layout = value;
+		else if (name == "--iterations") config.iterations = std::max(1ul, std::stoul(value));
+		else if (name == "--workers") config.workers = std::stoul(value);
+		else if (name == "--overdraw") config.overdraw = std::stof(value);
+		else if (name == "--lods") config.lods = std::stoul(value);
+		else if (name == "--normal-bits") config.normalBits = std::stoul(value);
+		else if (name == "--dir") config.directory = value.empty() || value.back() == '/' || value.back() == '\\' ? value : value + "/";
+		else if (name == "--out") config.output = value;
+		else {
+			std::cout << "Unknown option " << name << std::endl;
+			return false;
+		}
+	}
+	if (!nodesGiven) {
+		config.nodes = config.meshes;
+	}
+	if (config.layout != "external" && config.layout != "embedded" && config.layout != "glb") {
+		std::cout << "Unknown layout " << config.layout << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	BenchConfig config;
+	if (!parseArguments(argc, argv, config)) {
+		return 1;
+	}
+
+	Corpus corpus;
+	std::error_code error;
+	std::filesystem::create_directories(config.directory, error);
+	if (!generateCorpus(config, corpus)) {
+		std::cout << "Failed to write the corpus to " << config.directory << std::endl;
+		return 1;
+	}
+
+	LoaderOptions options;
+	options.workerCount = config.workers;
+	options.memoryMapBuffers = config.memoryMap;
+
+	Samples read, parse, buffers, decompress, views, images, load, access, assembly, cacheSave, cacheOpen;
+	uint64_t checksum = 0;
+	BakeOptions bakeOptions;
+	bakeOptions.optimizeVertexCache = config.optimize;
+	bakeOptions.optimizeOverdraw = config.overdraw > 0.0f;
+	bakeOptions.overdrawThreshold = config.overdraw;
+	bakeOptions.buildMeshlets = config.meshlets;
+	bakeOptions.lodLevels = config.lods;
+	bakeOptions.buildClusterLod = config.clusterLod;
+	bakeOptions.quantizePositions = config.encodeVertices;
+	bakeOptions.encodeNormals = config.encodeVertices;
+	bakeOptions.normalBits = config.normalBits;
+	bakeOptions.halfTexcoords = config.encodeVertices;
+	bakeOptions.workerCount = config.workers;
+	BakeReport bakeReport;
+	const std::string cachePath = corpus.modelPath + ".cache";
+	for (unsigned int iteration = 0; iteration != config.iterations; ++iteration) {
+		auto start = std::chrono::steady_clock::now();
+		auto lap = [&start]() {
+			const auto now = std::chrono::steady_clock::now();
+			const double seconds = std::chrono::duration<double>(now - start).count();
+			start = now;
+			return seconds;
+		};
+
+		glTFloader loader(corpus.modelPath, config.directory, options);
+		load.seconds.push_back(lap());
+		read.seconds.push_back(loader.Timings.read);
+		parse.seconds.push_back(loader.Timings.parse);
+		buffers.seconds.push_back(loader.Timings.buffers);
+		decompress.seconds.push_back(loader.Timings.decompress);
+		views.seconds.push_back(loader.Timings.views);
+		images.seconds.push_back(loader.Timings.images);
+
+		// Touch the first byte of every element of every accessor
+		for (unsigned int accessor = 0; accessor != loader.Accessors.size(); ++accessor) {
+			const AccessorView& view = loader.GetView(accessor);
+			for (size_t element = 0; element != view.count; ++element) {
+				checksum += view[element][0];
+			}
+		}
+		access.seconds.push_back(lap());
+
+		BakedModel baked;
+		baked.Build(loader, bakeOptions);
+		assembly.seconds.push_back(lap());
+		bakeReport = baked.Report;
+
+		const std::vector<std::string> dependencies = getModelDependencies(loader);
+		baked.Save(cachePath, hashModelSources(corpus.modelPath, config.directory, dependencies), dependencies);
+		cacheSave.seconds.push_back(lap());
+
+		BakedModel cached;
+		if (!cached.Open(cachePath, corpus.modelPath, config.directory, bakeOptions)) {
+			std::cout << "Failed to open the cache " << cachePath << std::endl;
+		}
+		cacheOpen.seconds.push_back(lap());
+	}
+
+	const double totalBytes = static_cast<double>(corpus.jsonBytes + corpus.bufferBytes + corpus.imageBytes);
+	auto rate = [](double amount, double seconds) { return seconds > 0.0 ? amount / seconds : 0.0; };
+
+	json report;
+	report["config"] = {
+		{ "vertices", config.vertices }, { "meshes", config.meshes }, { "nodes", config.nodes },
+		{ "materials", config.materials }, { "images", config.images }, { "imageSize", config.imageSize },
+		{ "buffers", config.buffers }, { "layout", config.layout }, { "iterations", config.iterations },
+		{ "workers", config.workers }, { "memoryMap", config.memoryMap }, { "optimize", config.optimize },
+		{ "overdraw", config.overdraw }, { "meshlets", config.meshlets }, { "lods", config.lods },
+		{ "clusterLod", config.clusterLod }, { "encodeVertices", config.encodeVertices }, { "normalBits", config.normalBits } };
+	report["corpus"] = {
+		{ "jsonBytes", corpus.jsonBytes }, { "bufferBytes", corpus.bufferBytes }, { "imageBytes", corpus.imageBytes },
+		{ "objects", corpus.objects }, { "vertices", corpus.vertices } };
+	report["seconds"] = {
+		{ "read", read.report() }, { "parse", parse.report() }, { "buffers", buffers.report() },
+		{ "decompress", decompress.report() }, { "views", views.report() }, { "images", images.report() },
+		{ "load", load.report() }, { "access", access.report() }, { "assembly", assembly.report() },
+		{ "cacheSave", cacheSave.report() }, { "cacheOpen", cacheOpen.report() } };
+	report["throughput"] = {
+		{ "loadMBps", rate(totalBytes / 1e6, load.median()) },
+		{ "parseMBps", rate(corpus.jsonBytes / 1e6, parse.median()) },
+		{ "parseObjectsPerSecond", rate(static_cast<double>(corpus.objects), parse.median()) },
+		{ "accessMBps", rate(corpus.bufferBytes / 1e6, access.median()) },
+		{ "assemblyVerticesPerSecond", rate(static_cast<double>(corpus.vertices), assembly.median()) },
+		{ "cacheOpenMBps", rate(totalBytes / 1e6, cacheOpen.median()) } };
+	if (bakeOptions.optimizeVertexCache || bakeOptions.optimizeOverdraw) {
+		report["vertexCache"] = {
+			{ "acmrBefore", bakeReport.vertexCacheBefore.acmr() }, { "acmrAfter", bakeReport.vertexCacheAfter.acmr() },
+			{ "atvrBefore", bakeReport.vertexCacheBefore.atvr() }, { "atvrAfter", bakeReport.vertexCacheAfter.atvr() },
+			{ "storedOrderKept", bakeReport.storedOrderKept } };
+	}
+	if (bakeOptions.optimizeOverdraw) {
+		report["overdraw"] = {
+			{ "before", bakeReport.overdrawBefore.overdraw() }, { "after", bakeReport.overdrawAfter.overdraw() } };
+	}
+	if (bakeOptions.buildMeshlets) {
+		report["meshlets"] = {
+			{ "count", bakeReport.meshlets },
+			{ "trianglesPerMeshlet", rate(static_cast<double>(bakeReport.meshletTriangles), static_cast<double>(bakeReport.meshlets)) } };
+	}
+	if (bakeOptions.lodLevels != 0) {
+		report["lods"] = { { "levels", bakeReport.lodLevels }, { "triangles", bakeReport.lodTriangles } };
+	}
+	if (bakeOptions.buildClusterLod) {
+		report["clusterLod"] = {
+			{ "clusters", bakeReport.clusters }, { "levels", bakeReport.clusterLevels }, { "coarseTriangles", bakeReport.clusterTriangles } };
+	}
+	if (config.encodeVertices) {
+		const VertexEncodingStats& encoding = bakeReport.encoding;
+		report["vertexEncoding"] = {
+			{ "bytesBefore", encoding.bytesBefore }, { "bytesAfter", encoding.bytesAfter },
+			{ "positionError", encoding.positionError }, { "normalErrorDegrees", encoding.normalError },
+			{ "tangentErrorDegrees", encoding.tangentError }, { "texcoordError", encoding.texcoordError },
+			{ "floatTexcoordPrimitives", encoding.floatTexcoords } };
+	}
+	report["peakRssBytes"] = peakResidentBytes();
+	report["checksum"] = checksum;
+
+	if (config.output.empty()) {
+		std::cout << report.dump(2) << std::endl;
+	}
+	else {
+		std::ofstream(config.output) << report.dump(2) << std::endl;
+	}
+	return 0;
+}
@@ -5,21 +5,123 @@
 #include <GLAD/glad.h>
 #include <GLFW/glfw3.h>
 
-#include <string>
-#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <optional>
 
 
+// Specifies if an accessor's elements are scalars, vectors or matrices
+enum Accessor_Type {
+	SCALAR,
+	VEC2,
+	VEC3,
+	VEC4,
+	MAT2,
+	MAT3,
+	MAT4
+};
+
+// The largest number of components an element can have (MAT4)
+const size_t MAX_COMPONENTS = 16;
+
+// Elements of an accessor that replace the ones of its buffer view, or of zeros when it has none
+struct Accessor_Sparse {
+	size_t count = 0;                      // The number of elements replaced
+	unsigned int indicesBufferView = 0;    // The buffer view holding the indices of the replaced elements
+	size_t indicesByteOffset = 0;          // The offset of the indices relative to the start of their buffer view
+	GLenum indicesComponentType = 0;       // GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	unsigned int valuesBufferView = 0;     // The buffer view holding the replacing elements, tightly packed
+	size_t valuesByteOffset = 0;           // The offset of the values relative to the start of their buffer view
+};
+
 // A typed view into a buffer view that contains raw binary data
 struct Accessor {
-	unsigned int bufferView; // The index of the bufferView
-	size_t   byteOffset;     // The offset relative to the start of the buffer view in bytes
-	GLenum componentType;  // The data type of the accessor's components
-	bool normalized;         // Specifies whether integer data values are normalized before usage 
-	size_t count;            // The number of elements referenced by this accessor 
-	std::string type;        // Specifies if the accessor's elements are scalars, vectors or matrices
-	std::vector<float> max;  // Maximum value of each component in this accessor
-	std::vector<float> min;  // Minimum value of each component in this accessor
+	std::optional<unsigned int> bufferView; // The index of the bufferView, every element starts as zero without one
+	size_t   byteOffset = 0; // The offset relative to the start of the buffer view in bytes
+	GLenum componentType = 0; // The data type of the accessor's components
+	bool normalized = false; // Specifies whether integer data values are normalized before usage 
+	size_t count = 0;        // The number of elements referenced by this accessor 
+	Accessor_Type type = SCALAR; // Specifies if the accessor's elements are scalars, vectors or matrices
+	bool hasMax = false;     // Whether max holds the accessor's maximum
+	bool hasMin = false;     // Whether min holds the accessor's minimum
+	float max[MAX_COMPONENTS] = {}; // Maximum value of each component in this accessor
+	float min[MAX_COMPONENTS] = {}; // Minimum value of each component in this accessor
+	std::optional<Accessor_Sparse> sparse; // The elements that deviate from the buffer view
+};
+
+// A non-owning, strided view of the elements of an accessor inside a loaded buffer
+struct AccessorView {
+	const unsigned char* data = nullptr; // The first byte of the first element
+	size_t count = 0;         // The number of elements in the view
+	size_t stride = 0;        // The distance in bytes between the starts of two consecutive elements
+	size_t elementSize = 0;   // The size of one element in bytes
+	size_t numComponents = 0; // The number of components per element
+	GLenum componentType = 0; // The data type of the components
+	bool normalized = false;  // Whether integer components are normalized before usage
+
+	bool empty() const { return count == 0; }
+
+	// Whether the elements are tightly packed one after the other
+	bool packed() const { return stride == elementSize; }
+
+	// The first byte of the given element
+	const unsigned char* operator[](size_t element) const { return data + element * stride; }
+
+	// Read one component of one element, the caller picks the type matching componentType
+	template<typename T>
+	T get(size_t element, size_t component = 0) const {
+		T value;
+		std::memcpy(&value, data + element * stride + component * sizeof(T), sizeof(T));
+		return value;
+	}
+};
+
+// A sparse accessor read without expanding it: the elements of its buffer view with some of them replaced
+struct SparseAccessorView {
+	AccessorView base;     // The elements before replacement, data is null when they all start as zero
+	AccessorView indices;  // The strictly increasing indices of the replaced elements, unsigned integer scalars
+	AccessorView values;   // The replacing elements, in the order of indices and laid out like base
 };
 
+// The number of components of an accessor's type
+inline size_t getNumComponents(Accessor_Type type) {
+	switch (type) {
+	case SCALAR: return 1;
+	case VEC2:   return 2;
+	case VEC3:   return 3;
+	case VEC4:   return 4;
+	case MAT2:   return 4;
+	case MAT3:   return 9;
+	case MAT4:   return 16;
+	default:     return 0;
+	}
+}
+
+// The size in bytes of one component of the given type
+inline size_t getComponentTypeSize(GLenum componentType) {
+	switch (componentType) {
+	case GL_BYTE:           return sizeof(int8_t);
+	case GL_UNSIGNED_BYTE:  return sizeof(uint8_t);
+	case GL_SHORT:          return sizeof(int16_t);
+	case GL_UNSIGNED_SHORT: return sizeof(uint16_t);
+	case GL_INT:            return sizeof(int32_t);
+	case GL_UNSIGNED_INT:   return sizeof(uint32_t);
+	case GL_FLOAT:          return sizeof(float);
+	case GL_HALF_FLOAT:     return sizeof(uint16_t);
+	default:                return 0;
+	}
+}
+
+// The size in bytes of one element, matrix columns are padded to 4 byte boundaries
+inline size_t getElementSize(Accessor_Type type, GLenum componentType) {
+	const size_t componentSize = getComponentTypeSize(componentType);
+	const size_t columns = type == MAT2 ? 2 : type == MAT3 ? 3 : 0;
+	if (columns != 0) {
+		const size_t columnSize = columns * componentSize;
+		return columns * ((columnSize + 3) & ~size_t(3));
+	}
+	return getNumComponents(type) * componentSize;
+}
+
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,28 @@
+#ifndef ACCESSOR_DECODE_H
+#define ACCESSOR_DECODE_H
+
+#include <cstdint>
+
+#include "accessor.h"
+
+
+// The representation decodeAccessor writes components in
+enum DecodeFormat {
+	DECODE_FLOAT,    // float, normalized integers are mapped to [0, 1] or [-1, 1]
+	DECODE_HALF,     // IEEE half float stored in a uint16_t, normalized integers are mapped like DECODE_FLOAT
+	DECODE_INTEGER   // 32-bit integer, signed components are sign extended, normalization is ignored and floats are truncated
+};
+
+// The size in bytes of one component written in the given format
+inline size_t getDecodeFormatSize(DecodeFormat format) {
+	return format == DECODE_HALF ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+// Convert the elements of an accessor of any component type, packed or strided, into out.
+// The first `components` components of every element are written, all of them when 0, and components
+// the accessor does not have are left untouched. Consecutive elements start outStride bytes apart,
+// tightly packed when 0. Returns false if the component type is unknown.
+bool decodeAccessor(const AccessorView& view, DecodeFormat format, void* out, size_t components = 0, size_t outStride = 0);
+
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef ASYNC_LOADER_H
+#define ASYNC_LOADER_H
+
+#include <chrono>
+#include <future>
+#include <memory>
+
+#include "glTF_loader.h"
+#include "baked_model.h"
+#include "load_progress.h"
+
+
+// A model loading in the background, either a glTFloader or a BakedModel
+template<typename Model>
+class LoadHandle {
+public:
+	LoadHandle(std::shared_future<std::shared_ptr<Model>> model, std::shared_ptr<LoadProgress> progress)
+		: model(std::move(model)), progress(std::move(progress))
+	{
+	}
+
+	// The finished model, null if the load was cancelled
+	const std::shared_future<std::shared_ptr<Model>>& GetModel() const { return model; }
+	// Whether GetModel() can be read without blocking
+	bool Ready() const { return model.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+
+	// The progress of every stage, the application advances LOAD_GPU as it uploads the model
+	LoadProgress& Progress() const { return *progress; }
+
+	// Ask the load to stop, GetModel() then gives null once the workers have stopped
+	void Cancel() { progress->Cancel(); }
+
+private:
+	std::shared_future<std::shared_ptr<Model>> model;
+	std::shared_ptr<LoadProgress> progress;
+};
+
+// Load a model on a background thread, the caller keeps running while it parses, reads and decodes
+LoadHandle<glTFloader> LoadModelAsync(const std::string& modelPath, const std::string& directory, LoaderOptions options = LoaderOptions());
+
+// Load the GPU-ready form of a model on a background thread, through its cache file when it is current
+LoadHandle<BakedModel> LoadBakedModelAsync(const std::string& modelPath, const std::string& directory, const std::string& cachePath,
+	LoaderOptions options = LoaderOptions(), const CacheOptions& cacheOptions = CacheOptions(), const BakeOptions& bakeOptions = BakeOptions());
+
+
+#endif
@@ -0,0 +1,268 @@
+#ifndef BAKED_MODEL_H
+#define BAKED_MODEL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "glTF_loader.h"
+#include "mapped_file.h"
+#include "mesh_optimize.h"
+#include "meshlet.h"
+#include "vertex_encoding.h"
+
+
+// Bump whenever a baked record or section changes, caches of other versions are rebuilt
+const uint32_t BAKED_MODEL_VERSION = 11;
+
+// The attributes the viewer's shader reads, each value is its attribute location
+enum VertexLocation {
+	LOCATION_POSITION,
+	LOCATION_NORMAL,
+	LOCATION_COLOR,
+	LOCATION_TEXCOORD,
+	LOCATION_TANGENT,
+	LOCATION_COUNT
+};
+
+// The glTF semantic read at every attribute location and the most components the shader takes from it
+const Attribute LOCATION_SEMANTICS[LOCATION_COUNT] = { POSITION, NORMAL, COLOR_0, TEXCOORD_0, TANGENT };
+const uint8_t LOCATION_COMPONENTS[LOCATION_COUNT] = { 3, 3, 4, 2, 4 };
+
+// How one attribute is stored in a primitive's vertices, the arguments of glVertexAttribPointer. Normals and tangents
+// stored with two components are octahedrally encoded, see vertex_encoding.h.
+struct BakedAttribute {
+	uint32_t componentType = GL_FLOAT;       // The type of the components as stored
+	uint8_t components = 0;                  // The number of components stored, 0 when the primitive does not have the attribute
+	uint8_t normalized = 0;                  // Whether integer components are mapped to [0, 1] or [-1, 1]
+	uint16_t offset = 0;                     // Interleaved, the offset from the start of the vertex. Split, the bytes per vertex of the streams before it.
+
+	bool present() const { return components != 0; }
+
+	// The bytes one value takes, padded to a multiple of 4
+	unsigned int size() const { return (components * static_cast<unsigned int>(getComponentTypeSize(componentType)) + 3) & ~3u; }
+};
+
+// A coarser level of a primitive, a range of its index stream after its own indices, over the same vertices.
+// Stored in cache files as is.
+struct BakedLod {
+	uint32_t firstIndex = 0;                 // The first index of the level, counted from the primitive's first index
+	uint32_t indexCount = 0;                 // The number of indices of the level
+	float error = 0.0f;                      // How far the level strays from the full surface, in the primitive's units
+};
+
+// A primitive ready to upload, its streams point into the storage of its model
+struct BakedPrimitive {
+	const unsigned char* vertices = nullptr; // The vertices, interleaved or as one stream per attribute
+	size_t vertexCount = 0;                  // The number of vertices
+	unsigned int vertexSize = 0;             // The bytes one vertex takes over all its attributes, a multiple of 4
+	bool interleaved = true;                 // Whether the attributes are interleaved or stored one stream after another
+	BakedAttribute attributes[LOCATION_COUNT]; // The layout of every attribute, indexed by location
+	const unsigned char* indices = nullptr;  // The indices as glTF stores them, null to draw the vertices in order
+	size_t indexCount = 0;                   // The number of indices
+	GLenum indexType = GL_UNSIGNED_SHORT;    // GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	uint32_t minIndex = 0;                   // The smallest index, the start of the range given to glDrawRangeElements
+	uint32_t maxIndex = 0;                   // The largest index, the end of that range
+	GLenum mode = GL_TRIANGLES;              // The primitive's topology
+	const Meshlet* meshlets = nullptr;       // The meshlets its indices are cut into, null when none were built
+	size_t meshletCount = 0;                 // The number of meshlets
+	const BakedLod* lods = nullptr;          // Ever coarser levels of the primitive, null when none were built
+	size_t lodCount = 0;                     // The number of coarser levels
+	const ClusterLod* clusters = nullptr;    // A hierarchy of ever coarser clusters over the primitive, null when none was built
+	size_t clusterCount = 0;                 // The number of clusters
+	size_t clusterIndexCount = 0;            // The indices of the clusters coarser than the meshlets, stored after those of the levels
+	float boundsCenter[3] = {};              // The bounding sphere of the vertices, set when levels are built
+	float boundsRadius = 0.0f;
+	float positionOffset[3] = {};            // Positions decode to positionOffset + positionScale * the stored value, set when they are quantized
+	float positionScale[3] = { 1.0f, 1.0f, 1.0f };
+	int image = -1;                          // The index of the base color image, -1 for none
+	Sampler sampler;                         // How the base color image is sampled
+	bool doubleSided = false;                // Whether its material draws back faces too, so neither the GPU nor meshlet culling may skip them
+
+	// The distance in bytes between the values of an attribute in consecutive vertices
+	unsigned int attributeStride(unsigned int location) const { return interleaved ? vertexSize : attributes[location].size(); }
+
+	// Where the first value of an attribute starts, relative to vertices
+	size_t attributeOffset(unsigned int location) const {
+		return interleaved ? attributes[location].offset : attributes[location].offset * vertexCount;
+	}
+
+	// The transform from the stored positions to the primitive's space, to apply before the node's
+	glm::mat4 positionTransform() const {
+		glm::mat4 transform(1.0f);
+		for (int axis = 0; axis != 3; ++axis) {
+			transform[axis][axis] = positionScale[axis];
+			transform[3][axis] = positionOffset[axis];
+		}
+		return transform;
+	}
+
+	// The indices stored for the primitive, its own followed by those of its coarser levels and clusters
+	size_t storedIndexCount() const {
+		return (lodCount != 0 ? lods[lodCount - 1].firstIndex + lods[lodCount - 1].indexCount : indexCount) + clusterIndexCount;
+	}
+};
+
+// Whether two primitives store their vertices alike, so one vertex array can draw both
+bool sameVertexLayout(const BakedPrimitive& a, const BakedPrimitive& b);
+
+// Copy the positions of a primitive's vertices into out as one tight stream, attributes[LOCATION_POSITION].size()
+// bytes per vertex in the type they are stored in. Passes that only need positions read that stream alone.
+void copyPositions(const BakedPrimitive& primitive, unsigned char* out);
+
+// The level of a primitive to draw, 0 for its own indices and n for lods[n - 1]. That is the coarsest level whose
+// error, seen from eye at the nearest point of the bounding sphere through a vertical field of view of fovY radians
+// on a viewport viewportHeight pixels high, covers at most pixelError pixels. world places the primitive.
+unsigned int selectLod(const BakedLod* lods, size_t lodCount, const glm::vec3& center, float radius, const glm::mat4& world,
+	const glm::vec3& eye, float fovY, float viewportHeight, float pixelError);
+
+// GLSL for a vertex shader reading a primitive's vertices: an input for every attribute it stores, at its location
+// and in the type the shader receives, and functions vertexPosition(), vertexNormal(), vertexTangent(), vertexColor()
+// and vertexTexcoord() decoding them. Quantized positions come out as stored, positionTransform() undoes them.
+std::string getVertexDecodeGLSL(const BakedPrimitive& primitive);
+
+// Decoded pixels, 8 bits per channel
+struct BakedImage {
+	int width = 0;                           // The width of the image in pixels
+	int height = 0;                          // The height of the image in pixels
+	int channels = 0;                        // The number of channels per pixel, 0 if the image failed to decode
+	const unsigned char* pixels = nullptr;   // The pixels, rows stored top to bottom
+};
+
+// The primitives of a mesh, a contiguous range of the model's primitives
+struct BakedMesh {
+	unsigned int firstPrimitive = 0;         // The index of the mesh's first primitive
+	unsigned int primitiveCount = 0;         // The number of primitives in the mesh
+};
+
+// A node of the default scene with its transform resolved to world space
+struct BakedNode {
+	int mesh = -1;                           // The index of the node's mesh, -1 for none
+	int parent = -1;                         // The index of the parent in the baked nodes, -1 for a root
+	glm::mat4 world = glm::mat4(1.0f);       // The transform from the node to the scene
+};
+
+// Settings for assembling a model, a cache only serves the settings it was built with
+struct BakeOptions {
+	bool keepQuantized = true;               // Store integer attributes (KHR_mesh_quantization) in their own type instead of float
+	bool interleaveVertices = true;          // Interleave the attributes of every vertex instead of storing one stream per attribute
+	bool narrowIndices = true;               // Store 32-bit indices as 16-bit ones when every index fits
+	bool splitLargeMeshes = true;            // Cut indexed lists of points, lines and triangles that 16-bit indices cannot address into chunks that they can
+	bool weldVertices = false;               // Give primitives drawn without indices indices over their distinct vertices
+	float weldPositionTolerance = 0.0f;      // The grid float positions snap to before comparing, 0 to weld identical ones only
+	float weldNormalTolerance = 0.0f;        // The grid float normals snap to before comparing, 0 to weld identical ones only
+	bool optimizeVertexCache = false;        // Reorder indexed triangles for the post-transform cache and vertices for fetching
+	bool optimizeOverdraw = false;           // Also reorder clusters of triangles so the ones facing out are drawn first, every primitive is taken as opaque
+	float overdrawThreshold = 1.05f;         // How much worse the cache miss ratio may get for less overdraw, 1 gives up the least
+	bool buildMeshlets = false;              // Cut indexed triangle lists into meshlets with bounds the CPU can cull
+	unsigned int lodLevels = 0;              // The coarser levels to simplify every indexed triangle list into, 0 for none
+	float lodRatio = 0.5f;                   // The share of the full triangles each level aims to keep of the level before
+	float lodMaxError = 0.05f;               // The most a level may stray from the full surface, relative to its bounding radius
+	bool buildClusterLod = false;            // Build a hierarchy of ever coarser clusters over every indexed triangle list, picked cluster by cluster
+	bool quantizePositions = false;          // Store float positions as 16-bit normalized integers over their accessor's bounds
+	bool encodeNormals = false;              // Store normals and tangents as two octahedral snorm components, the tangent's sign folded into the second
+	unsigned int normalBits = 16;            // The bits of each octahedral component, 8 or 16
+	bool halfTexcoords = false;              // Store float texture coordinates as half floats when none moves by more than texcoordTolerance
+	float texcoordTolerance = 1.0f / 2048.0f; // Half a texel of a 1024 texture, which halves keep for coordinates within [-2, 2]
+	unsigned int workerCount = 0;            // The threads the optimization passes run on, 0 for one per hardware thread. Not part of the cache key.
+};
+
+// What the optional passes of Build measured, empty for a model mapped from a cache
+struct BakeReport {
+	VertexCacheStats vertexCacheBefore;      // The indexed triangle lists as the file stores them
+	VertexCacheStats vertexCacheAfter;       // The same lists once optimized
+	size_t storedOrderKept = 0;              // The lists left in their stored order, as reordering shaded no fewer vertices
+	size_t weldedVerticesBefore = 0;         // The vertices of the primitives given indices by welding
+	size_t weldedVerticesAfter = 0;          // The distinct vertices left of them
+	OverdrawStats overdrawBefore;            // The overdraw of those lists as stored, measured when overdraw is optimized
+	OverdrawStats overdrawAfter;             // Their overdraw once optimized
+	size_t meshlets = 0;                     // The meshlets built
+	size_t meshletTriangles = 0;             // The triangles cut into them
+	size_t lodLevels = 0;                    // The coarser levels built over every primitive
+	size_t lodTriangles = 0;                 // The triangles of all those levels
+	size_t clusters = 0;                     // The clusters of every hierarchy built
+	size_t clusterLevels = 0;                // The levels of the deepest hierarchy
+	size_t clusterTriangles = 0;             // The triangles of the clusters coarser than the meshlets
+	VertexEncodingStats encoding;            // What the compact vertex encodings saved and the error they introduced
+	bool cacheSaveFailed = false;            // The model was baked but its cache file could not be written
+};
+
+// Settings for writing a cache file
+struct CacheOptions {
+	bool compress = false;                   // Compress large sections with LZ4, smaller files but a copy on load
+	size_t compressThreshold = 64 << 10;     // Sections smaller than this are always stored as is
+};
+
+// A model processed into GPU-ready streams, either built from a glTFloader or mapped from a cache file.
+// Every pointer in the tables refers to storage owned by the model, so it cannot be copied.
+class BakedModel {
+public:
+	std::vector<BakedMesh> Meshes;
+	std::vector<BakedPrimitive> Primitives;
+	std::vector<BakedImage> Images;
+	std::vector<BakedNode> Nodes;
+	BakeReport Report;
+
+	BakedModel() = default;
+	BakedModel(const BakedModel&) = delete;
+	BakedModel& operator=(const BakedModel&) = delete;
+	BakedModel(BakedModel&&) = default;
+	BakedModel& operator=(BakedModel&&) = default;
+
+	// Assemble the vertices, indices, pixels and scene of a loaded model
+	void Build(const glTFloader& loader, const BakeOptions& options = BakeOptions());
+
+	// Write the model to a cache file keyed by the content hash of its sources
+	bool Save(const std::string& path, uint64_t sourceHash, const std::vector<std::string>& dependencies, const CacheOptions& options = CacheOptions()) const;
+
+	// Map a cache file, fails if it is missing, malformed, of another version, built with other
+	// settings or older than its sources
+	bool Open(const std::string& path, const std::string& modelPath, const std::string& directory, const BakeOptions& options = BakeOptions());
+
+private:
+	// The cache file, the tables point straight into it
+	MappedFile file;
+	// The hash of the settings the model was built with
+	uint64_t optionsHash = 0;
+	// The streams of a model built in memory
+	std::vector<unsigned char> vertices;
+	std::vector<unsigned char> indices;
+	std::vector<unsigned char> pixels;
+	// The meshlets of every primitive, built or read from the cache
+	std::vector<Meshlet> meshlets;
+	// The coarser levels of every primitive, built or read from the cache
+	std::vector<BakedLod> lods;
+	// The cluster hierarchies of every primitive, built or read from the cache
+	std::vector<ClusterLod> clusters;
+	// Sections of the cache file that were stored compressed
+	std::vector<std::vector<unsigned char>> decompressed;
+
+	void clear();
+};
+
+// The nodes of the default scene with their world transforms, parents before their children
+std::vector<BakedNode> flattenScene(const glTFloader& loader);
+
+// The base color image of a primitive's material and how it is sampled, both left untouched without one
+void getBaseColorTexture(const glTFloader& loader, const Mesh_Primitive& primitive, int& image, Sampler& sampler);
+
+// Whether the material of a primitive draws back faces too, false without a material
+bool isDoubleSided(const glTFloader& loader, const Mesh_Primitive& primitive);
+
+// The files a model reads besides its glTF document, relative to its directory
+std::vector<std::string> getModelDependencies(const glTFloader& loader);
+
+// The content hash of a model file and its dependencies, 0 if any of them cannot be read
+uint64_t hashModelSources(const std::string& modelPath, const std::string& directory, const std::vector<std::string>& dependencies);
+
+// Load the GPU-ready form of a model from its cache when the cache is current,
+// otherwise from the glTF itself and refresh the cache, a cache that cannot be written sets Report.cacheSaveFailed.
+// Returns false if the load was cancelled.
+bool LoadBakedModel(const std::string& modelPath, const std::string& directory, const std::string& cachePath, BakedModel& model,
+	const LoaderOptions& options = LoaderOptions(), const CacheOptions& cacheOptions = CacheOptions(),
+	const BakeOptions& bakeOptions = BakeOptions());
+
+
+#endif
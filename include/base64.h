@@ -0,0 +1,21 @@
+#ifndef BASE64_H
+#define BASE64_H
+
+#include <string>
+
+
+// The number of bytes the base64 text decodes to, 0 if its length can never be valid
+size_t base64DecodedSize(const char* text, size_t length);
+
+// Decode base64 text into out, which must hold base64DecodedSize(text, length) bytes.
+// Large inputs are decoded in parallel chunks. Returns false if the text is malformed.
+bool base64Decode(const char* text, size_t length, unsigned char* out);
+
+// Whether the URI embeds its data rather than pointing to a file
+bool isDataUri(const std::string& uri);
+
+// Find the media type and base64 payload of a data URI, returns false if it is not a base64 data URI
+bool parseDataUri(const std::string& uri, std::string& mediaType, const char*& payload, size_t& payloadLength);
+
+
+#endif
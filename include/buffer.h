@@ -2,11 +2,23 @@
 #define BUFFER_H
 
 #include <string>
+#include <vector>
+
+#include "mapped_file.h"
 
 // A buffer points to some binary geometry, animation, or skins
 struct Buffer {
-	std::string uri;        // The URI of the buffer
+	std::string uri;        // The URI of the buffer, a data URI keeps only its header once it is decoded
 	size_t byteLength;      // The length of the buffer in bytes
+	bool fallback = false;  // Whether the buffer only reserves room for compressed buffer views to decode into
+};
+
+// The loaded bytes of a buffer, either mapped straight from disk or owned in memory
+struct BufferData {
+	MappedFile mapping;                // The read-only mapping of the buffer's file, if it was mapped
+	std::vector<unsigned char> owned;  // The buffer's bytes, if they were read into memory
+	const unsigned char* data = nullptr; // The first byte of the buffer, wherever it lives
+	size_t size = 0;                   // The number of bytes available at data
 };
 
-#endif
\ No newline at end of file
+#endif
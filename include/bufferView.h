@@ -1,15 +1,45 @@
 #ifndef BUFFERVIEW_H
 #define BUFFERVIEW_H
 
+#include <glad/glad.h>
+
+#include <optional>
 #include <unordered_map>
 
 
+// How the data of a compressed buffer view was encoded (EXT_meshopt_compression)
+enum Meshopt_Mode {
+	MESHOPT_ATTRIBUTES,  // Vertex attributes, elements of byteStride bytes
+	MESHOPT_TRIANGLES,   // A triangle list of 2 or 4 byte indices
+	MESHOPT_INDICES      // Any other sequence of 2 or 4 byte indices
+};
+
+// The transform applied to attribute data before it was compressed, undone after decoding
+enum Meshopt_Filter {
+	MESHOPT_FILTER_NONE,
+	MESHOPT_FILTER_OCTAHEDRAL,   // Unit vectors of 8 or 16 bit components stored as octahedral coordinates
+	MESHOPT_FILTER_QUATERNION,   // Unit quaternions of 16 bit components stored as their three smallest components
+	MESHOPT_FILTER_EXPONENTIAL   // Floats stored as a 24 bit mantissa and an 8 bit exponent
+};
+
+// Where the compressed form of a buffer view lives and how to decode it
+struct Meshopt_Compression {
+	unsigned int buffer = 0;     // The index of the buffer holding the compressed data
+	size_t byteOffset = 0;       // The offset of the compressed data in that buffer
+	size_t byteLength = 0;       // The length of the compressed data in bytes
+	size_t byteStride = 0;       // The size of one decoded element in bytes
+	size_t count = 0;            // The number of decoded elements
+	Meshopt_Mode mode = MESHOPT_ATTRIBUTES;
+	Meshopt_Filter filter = MESHOPT_FILTER_NONE;
+};
+
 // A view into a buffer generally representing a subset of the buffer
 struct BufferView {
 	unsigned int buffer;    // The index of the buffer
-	size_t byteOffset;      // The offset into the buffer in bytes
-	size_t byteLength;      // The length of the buffer in bytes
-	size_t byteStride;      // The stride in bytes
-	GLenum target;   // The hint representing the intended GPU buffer to use with this buffer view
+	size_t byteOffset = 0;  // The offset into the buffer in bytes
+	size_t byteLength = 0;  // The length of the buffer in bytes
+	size_t byteStride = 0;  // The stride in bytes, 0 when the elements are tightly packed
+	GLenum target = 0;      // The hint representing the intended GPU buffer to use with this buffer view
+	std::optional<Meshopt_Compression> meshopt; // The compressed form of the view's data, decoded into the view while loading
 };
-#endif
\ No newline at end of file
+#endif
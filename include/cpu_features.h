@@ -0,0 +1,29 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define GLTF_X86 1
+#endif
+
+// Lets a single function use instructions beyond the compiler's baseline, MSVC needs no attribute
+#if defined(GLTF_X86) && (defined(__GNUC__) || defined(__clang__))
+#define GLTF_TARGET(features) __attribute__((target(features)))
+#else
+#define GLTF_TARGET(features)
+#endif
+
+
+// The instruction set extensions available on the running CPU, detected once at startup
+struct CpuFeatures {
+	bool ssse3 = false;
+	bool sse41 = false;
+	bool avx2 = false;
+	bool f16c = false;    // Conversions between float and half float
+	bool avx512 = false;  // AVX-512 F and BW
+};
+
+const CpuFeatures& getCpuFeatures();
+
+
+#endif
@@ -3,6 +3,12 @@
 
 #include <iostream>
 #include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 
 #include "nlohmann/json.hpp"
@@ -17,65 +23,139 @@
 #include "sampler.h"
 #include "node.h"
 #include "scene.h"
+#include "load_progress.h"
 
 
 using json = nlohmann::json;
 
 
+// GLB container layout
+const uint32_t GLB_MAGIC = 0x46546C67;       // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;  // "JSON"
+const uint32_t GLB_CHUNK_BIN = 0x004E4942;   // "BIN\0"
+const size_t GLB_HEADER_SIZE = 12;
+const size_t GLB_CHUNK_HEADER_SIZE = 8;
+
+
+// Settings that control how a model is loaded
+struct LoaderOptions {
+	bool memoryMapBuffers = true;         // Map buffer files read-only instead of reading them into owned memory
+	bool decodeImages = true;             // Decode every image into pixels while the model loads
+	unsigned int workerCount = 0;         // The threads reading buffers and decoding images, 0 for one per hardware thread
+	size_t maxBytesInFlight = 256 << 20;  // The most bytes being read or decoded at once, 0 for no limit
+	std::shared_ptr<LoadProgress> progress; // Receives the progress of every stage and can cancel the load, may be null
+};
+
+// The wall time each stage of the constructor added to the load, in seconds.
+// Buffer reads and image decodes that overlap the parse are hidden inside the parse time.
+struct LoadTimings {
+	double read = 0.0;        // Reading or mapping the model file
+	double parse = 0.0;       // Parsing the JSON into the tables
+	double buffers = 0.0;     // Waiting for the buffers once the parse is done
+	double decompress = 0.0;  // Decoding the compressed buffer views into their fallback buffers
+	double views = 0.0;       // Validating every accessor against its buffer
+	double images = 0.0;      // Waiting for the images once the accessors are validated
+};
+
+// The buffer reads and image decodes running while a model loads
+struct LoadQueue;
+
+
 class glTFloader {
 public:
-	// A map of accessors and their respective keys
-	std::unordered_map<unsigned int, Accessor> Accessors;
+	// The accessors of the model, addressed by their glTF index
+	std::vector<Accessor> Accessors;
 	
-	// A map of buffer views and their respective keys
-	std::unordered_map<unsigned int, BufferView> BufferViews;
+	// The buffer views of the model, addressed by their glTF index
+	std::vector<BufferView> BufferViews;
 	
-	// A map of buffers and their respective keys
-	std::unordered_map<unsigned int, Buffer> Buffers;
+	// The buffers of the model, addressed by their glTF index
+	std::vector<Buffer> Buffers;
 	
-	// A map of meshes and their respective keys
-	std::unordered_map<unsigned int, Mesh> Meshes;
+	// The meshes of the model, addressed by their glTF index
+	std::vector<Mesh> Meshes;
 	
-	// A map of images and their respective keys
-	std::unordered_map<unsigned int, Image> Images;
+	// The images of the model, addressed by their glTF index
+	std::vector<Image> Images;
 	
-	// A map of materials and their respective keys
-	std::unordered_map<unsigned int, Material> Materials;
+	// The materials of the model, addressed by their glTF index
+	std::vector<Material> Materials;
 	
-	// A map of textures and their respective keys
-	std::unordered_map<unsigned int, Texture> Textures;
+	// The textures of the model, addressed by their glTF index
+	std::vector<Texture> Textures;
 	
-	// A map of samplers and their respective keys
-	std::unordered_map<unsigned int, Sampler> Samplers;
+	// The samplers of the model, addressed by their glTF index
+	std::vector<Sampler> Samplers;
 	
-	// A map of nodes and their respective keys
-	std::unordered_map<unsigned int, Node> Nodes;
+	// The nodes of the model, addressed by their glTF index
+	std::vector<Node> Nodes;
 	
-	// A map of scenes and their respective keys
-	std::unordered_map<unsigned int, Scene> Scenes;
+	// The scenes of the model, addressed by their glTF index
+	std::vector<Scene> Scenes;
+
+	// The index of the scene to display
+	unsigned int DefaultScene = 0;
+
+	// How long each stage of loading took
+	LoadTimings Timings;
 	
 	// Constructor
-	glTFloader(const std::string& modelPath, const std::string& directory);
+	glTFloader(const std::string& modelPath, const std::string& directory, const LoaderOptions& options = LoaderOptions());
+
+	// A zero-copy view of an accessor's elements, empty if the accessor failed validation.
+	// Sparse accessors and accessors without a buffer view are expanded into owned memory on first use.
+	const AccessorView& GetView(unsigned int accessor) const;
+
+	// An accessor's elements as its buffer view holds them along with its sparse replacements, never expanded.
+	// indices and values are empty when the accessor is not sparse.
+	const SparseAccessorView& GetSparseView(unsigned int accessor) const;
+
+	// The bytes of a buffer view as loaded, false if its buffer is missing or too short
+	bool GetBufferViewBytes(unsigned int bufferView, const unsigned char*& data, size_t& size) const;
+
+	// The encoded bytes of an image, read from its file, data URI or buffer view on first use
+	bool GetImageBytes(unsigned int image, const unsigned char*& data, size_t& size);
 
-	std::vector<unsigned char> GetData(Accessor& accessor);
+	// The pixels of an image decoded during loading, empty if it failed or images are not decoded
+	const ImagePixels& GetImagePixels(unsigned int image) const;
 
 private:
 	// Directory
 	std::string directory = "";
-	// A binary geometry to store the contents needed for drawing
-	std::unordered_map<unsigned int, std::vector<unsigned char>> binaryGeometry;
+	// Loading settings
+	LoaderOptions options;
+	// The model file itself, a .gltf document or a whole .glb container
+	BufferData container;
+	// The BIN chunk of a GLB container, it lives inside the container
+	const unsigned char* binaryChunk = nullptr;
+	size_t binaryChunkLength = 0;
+	// A binary geometry to store the contents needed for drawing, indexed like Buffers.
+	// Workers fill the slots while the parser appends new ones, so the storage must never move.
+	std::deque<BufferData> binaryGeometry;
+	// The encoded bytes of every image requested so far, indexed like Images
+	std::deque<BufferData> imageData;
+	// The decoded pixels of every image, indexed like Images
+	std::deque<ImagePixels> imagePixels;
+	// A bounds-checked view of every accessor, indexed like Accessors. Views of accessors that
+	// need expanding are filled in by the first GetView, each guarded by its flag in expanded.
+	mutable std::vector<AccessorView> accessorViews;
+	std::vector<SparseAccessorView> sparseViews;
+	std::vector<bool> needsExpanding;
+	std::unique_ptr<std::once_flag[]> expanded;
+	// The elements of every expanded accessor, indexed like Accessors
+	mutable std::vector<std::vector<unsigned char>> expandedData;
 	
-	void loadAccessors(const json& jAccessors);
-	void loadBufferViews(const json& jBufferViews);
-	void loadBuffers(const json& jBuffers);
-	void loadMeshes(const json& jMeshes);
-	void loadImages(const json& jImages);
-	void loadMaterials(const json& jMaterials);
-	void loadTextures(const json& jTextures);
-	void loadSamplers(const json& jSamplers);
-	void loadNodes(const json& jNodes);
-	void loadScenes(const json& jScenes);
-	void loadBinaryGeometry(std::ifstream& binFile, unsigned int buffer);
+	bool readFile(const std::string& path, BufferData& bufferData);
+	bool parseGLB(const unsigned char*& jsonData, size_t& jsonLength, const std::string& modelPath);
+	bool decodeDataUri(const std::string& uri, std::string& mediaType, BufferData& bufferData);
+	bool loadImageBytes(const Image& source, BufferData& bytes);
+	bool decodeImage(const BufferData& bytes, ImagePixels& image, LoadQueue& queue);
+	void scheduleBuffer(LoadQueue& queue, unsigned int buffer);
+	void scheduleImage(LoadQueue& queue, unsigned int image);
+	void decodeCompressedViews(LoadQueue& queue);
+	void createAccessorViews();
+	bool bindView(unsigned int accessor, const char* part, unsigned int bufferView, size_t byteOffset, bool packed, AccessorView& view) const;
+	void expandAccessor(unsigned int accessor) const;
 };
 
 #endif
\ No newline at end of file
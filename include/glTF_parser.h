@@ -0,0 +1,136 @@
+#ifndef GLTF_PARSER_H
+#define GLTF_PARSER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+
+class glTFloader;
+class LoadProgress;
+struct Accessor;
+struct BufferView;
+struct Buffer;
+struct Mesh;
+struct Mesh_Primitive;
+struct Image;
+struct Sampler;
+struct Texture;
+struct Material;
+struct Node;
+struct Scene;
+
+
+// A SAX handler that fills the loader's tables while the JSON is being tokenized.
+// The document tree is never built, and unknown properties and extensions are skipped without being stored.
+class glTFparser : public nlohmann::json_sax<nlohmann::json> {
+public:
+	explicit glTFparser(glTFloader& loader);
+
+	// The reason the last parse stopped early, empty on success
+	const std::string& Error() const { return error; }
+
+	// Called with the index of every buffer and image as soon as its object closes, so loading can start mid-parse
+	std::function<void(unsigned int)> BufferParsed;
+	std::function<void(unsigned int)> ImageParsed;
+	// Checked as every table element closes, the parse stops once it is cancelled
+	const LoadProgress* Progress = nullptr;
+
+	bool null() override;
+	bool boolean(bool val) override;
+	bool number_integer(number_integer_t val) override;
+	bool number_unsigned(number_unsigned_t val) override;
+	bool number_float(number_float_t val, const string_t& s) override;
+	bool string(string_t& val) override;
+	bool binary(binary_t& val) override;
+	bool start_object(std::size_t elements) override;
+	bool key(string_t& val) override;
+	bool end_object() override;
+	bool start_array(std::size_t elements) override;
+	bool end_array() override;
+	bool parse_error(std::size_t position, const std::string& last_token, const nlohmann::detail::exception& ex) override;
+
+private:
+	// The top-level arrays the parser understands
+	enum Table {
+		NO_TABLE,
+		ACCESSORS,
+		BUFFER_VIEWS,
+		BUFFERS,
+		MESHES,
+		IMAGES,
+		SAMPLERS,
+		TEXTURES,
+		MATERIALS,
+		NODES,
+		SCENES
+	};
+
+	// One open object or array on the way from the root to the current token
+	struct Frame {
+		bool isArray;     // Whether this is an array or an object
+		std::string key;  // The key of the current member when this is an object
+		size_t index;     // The index of the current element when this is an array
+	};
+
+	// A scalar token, numbers keep every representation the JSON could mean
+	struct Value {
+		enum Kind { NUMBER, STRING, BOOLEAN, NULL_VALUE } kind;
+		double number = 0.0;
+		unsigned long long integer = 0;
+		bool outOfRange = false;        // Negative, not a number or too large for integer, which is 0 then
+		bool boolean = false;
+		const std::string* string = nullptr;
+	};
+
+	glTFloader& loader;
+	std::string error;
+
+	std::vector<Frame> path;     // The containers that are currently open
+	size_t skipDepth = 0;        // The nesting depth inside an ignored subtree, 0 when not skipping
+	Table table = NO_TABLE;      // The table whose array is currently open
+
+	// The records being filled, they stay valid until their object closes
+	Accessor* accessor = nullptr;
+	BufferView* bufferView = nullptr;
+	Buffer* buffer = nullptr;
+	Mesh* mesh = nullptr;
+	Mesh_Primitive* primitive = nullptr;
+	Image* image = nullptr;
+	Sampler* sampler = nullptr;
+	Texture* texture = nullptr;
+	Material* material = nullptr;
+	Node* node = nullptr;
+	Scene* scene = nullptr;
+	bool nodeHasMatrix = false;  // Whether the current node gave its transform as a matrix
+
+	// Whether a container starting at the current position is read or skipped
+	bool enter(bool isArray);
+	void leave();
+	// Move to the next element when the parent is an array
+	void next();
+
+	bool value(const Value& val);
+	bool accessorValue(const Value& val);
+	bool sparseValue(const Value& val);
+	bool bufferViewValue(const Value& val);
+	bool meshoptValue(const Value& val);
+	bool bufferValue(const Value& val);
+	bool meshValue(const Value& val);
+	bool imageValue(const Value& val);
+	bool samplerValue(const Value& val);
+	bool textureValue(const Value& val);
+	bool materialValue(const Value& val);
+	bool nodeValue(const Value& val);
+	bool sceneValue(const Value& val);
+
+	// The key of the member being read in the object at the given depth
+	const std::string& keyAt(size_t depth) const { return path[depth].key; }
+	// Report a value of the wrong type and stop the parse
+	bool unexpected(const char* expected);
+};
+
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+// A fast 64-bit content hash (the XXH64 algorithm), chain calls by passing the previous hash as the seed
+uint64_t hash64(const void* data, size_t size, uint64_t seed = 0);
+
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <memory>
+#include <optional>
+#include <string>
+
+// Image data used to create a texture, referred to by a URI or stored in a buffer view
+struct Image {
+	std::string uri;                       // The URI (or data URI) of the image
+	std::string mimeType;                  // The image's media type, required when bufferView is used
+	std::optional<unsigned int> bufferView; // The index of the buffer view that contains the image
+};
+
+// Frees pixels allocated by the image decoder
+struct PixelDeleter {
+	void operator()(unsigned char* pixels) const;
+};
+
+// The decoded pixels of an image, 8 bits per channel and rows stored top to bottom
+struct ImagePixels {
+	int width = 0;                                          // The width of the image in pixels
+	int height = 0;                                         // The height of the image in pixels
+	int channels = 0;                                       // The number of channels per pixel, 1 to 4
+	std::unique_ptr<unsigned char[], PixelDeleter> pixels;  // The pixels, null if the image could not be decoded
+};
+
+#endif
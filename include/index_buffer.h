@@ -0,0 +1,46 @@
+#ifndef INDEX_BUFFER_H
+#define INDEX_BUFFER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "accessor.h"
+
+
+// The most vertices 16-bit indices can address. glTF forbids index 65535, the primitive restart index, so the
+// largest index is 65534.
+const size_t MAX_16BIT_VERTICES = 65535;
+
+// The smallest and largest index of an index stream, the range glDrawRangeElements is given
+struct IndexRange {
+	uint32_t min = 0;
+	uint32_t max = 0;
+};
+
+// A part of an index stream that 16-bit indices can address
+struct IndexChunk {
+	std::vector<uint32_t> vertices;  // The source vertex of every vertex of the chunk
+	std::vector<uint16_t> indices;   // The indices into vertices
+};
+
+// Scan packed GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT indices for their smallest and largest value
+// with the widest kernels the CPU supports. An empty stream or an unknown type gives { 0, 0 }.
+IndexRange getIndexRange(const unsigned char* indices, size_t count, GLenum indexType);
+
+// Widen packed indices of any index type to 32 bits
+void readIndices(const unsigned char* in, size_t count, GLenum indexType, uint32_t* out);
+
+// Store 32-bit indices packed in an index type, every index must fit in it
+void writeIndices(const uint32_t* in, size_t count, GLenum indexType, unsigned char* out);
+
+// Narrow packed 32-bit indices that all fit in 16 bits to 16-bit ones, out may be the same as in
+void narrowIndices(const unsigned char* in, size_t count, unsigned char* out);
+
+// Cut a list of points, lines or triangles with 32-bit indices into chunks of at most maxVertices vertices,
+// never splitting a primitive. Returns false for strips, fans and loops, which cannot be cut without
+// changing them, and when an index is not below vertexCount.
+bool splitIndices(const unsigned char* indices, size_t count, size_t vertexCount, GLenum mode, size_t maxVertices,
+	std::vector<IndexChunk>& chunks);
+
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef LOAD_PROGRESS_H
+#define LOAD_PROGRESS_H
+
+#include <atomic>
+#include <cstddef>
+
+
+// The stages of loading a model, in the order they finish
+enum LoadStage {
+	LOAD_PARSE,    // The JSON document, counted in bytes
+	LOAD_BUFFERS,  // The buffers, counted in bytes
+	LOAD_IMAGES,   // The images, counted one by one
+	LOAD_GPU,      // The meshes uploaded by the application, counted one by one
+	LOAD_STAGE_COUNT
+};
+
+// Progress and cancellation shared between a loading model and the threads waiting for it.
+// Totals may still grow while a stage runs, e.g. buffers are counted as the parser finds them.
+class LoadProgress {
+public:
+	LoadProgress() {
+		for (unsigned int stage = 0; stage != LOAD_STAGE_COUNT; ++stage) {
+			done[stage].store(0, std::memory_order_relaxed);
+			total[stage].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	void AddTotal(LoadStage stage, size_t amount) { total[stage].fetch_add(amount, std::memory_order_relaxed); }
+	void Advance(LoadStage stage, size_t amount = 1) { done[stage].fetch_add(amount, std::memory_order_relaxed); }
+
+	size_t Done(LoadStage stage) const { return done[stage].load(std::memory_order_relaxed); }
+	size_t Total(LoadStage stage) const { return total[stage].load(std::memory_order_relaxed); }
+	// The finished part of a stage between 0 and 1, a stage with nothing to do counts as finished
+	float Fraction(LoadStage stage) const {
+		const size_t stageTotal = Total(stage);
+		if (stageTotal == 0) {
+			return 1.0f;
+		}
+		const size_t stageDone = Done(stage);
+		return stageDone >= stageTotal ? 1.0f : static_cast<float>(stageDone) / static_cast<float>(stageTotal);
+	}
+
+	// Ask the load to stop, it stops at the next buffer, image or table element
+	void Cancel() { cancelled.store(true, std::memory_order_relaxed); }
+	bool Cancelled() const { return cancelled.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<size_t> done[LOAD_STAGE_COUNT];
+	std::atomic<size_t> total[LOAD_STAGE_COUNT];
+	std::atomic<bool> cancelled{ false };
+};
+
+
+#endif
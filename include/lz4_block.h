@@ -0,0 +1,17 @@
+#ifndef LZ4_BLOCK_H
+#define LZ4_BLOCK_H
+
+#include <cstddef>
+
+
+// The largest compressed size of a block of the given size
+size_t lz4CompressBound(size_t size);
+
+// Compress a block in the LZ4 block format, returns the compressed size or 0 if it does not fit in capacity
+size_t lz4Compress(const unsigned char* source, size_t size, unsigned char* destination, size_t capacity);
+
+// Decompress an LZ4 block that expands to exactly rawSize bytes, returns false if it is malformed
+bool lz4Decompress(const unsigned char* source, size_t size, unsigned char* destination, size_t rawSize);
+
+
+#endif
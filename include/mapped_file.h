@@ -0,0 +1,40 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+
+
+// A whole file mapped read-only into the address space of the process
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// Map the file at the given path, returns false if it cannot be opened or mapped
+	bool Open(const std::string& path);
+	// Unmap the file and release its handles
+	void Close();
+
+	// Ask the OS to start reading the given byte range before it is touched
+	void WillNeed(size_t offset, size_t size) const;
+
+	const unsigned char* Data() const { return bytes; }
+	size_t Size() const { return length; }
+	bool IsOpen() const { return opened; }
+
+private:
+	const unsigned char* bytes = nullptr; // The first byte of the mapping
+	size_t length = 0;                    // The length of the mapping in bytes
+	bool opened = false;                  // Whether a file is currently mapped
+#ifdef _WIN32
+	void* fileHandle = nullptr;           // The handle of the mapped file
+	void* mappingHandle = nullptr;        // The handle of the file mapping object
+#endif
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glm/glm.hpp>
+
+#include <optional>
+#include <string>
+
+// The material appearance of a primitive, only the metallic-roughness base color is used for now
+struct Material {
+	std::string name;                                 // The user-defined name of this material
+	glm::vec4 baseColorFactor = glm::vec4(1.0f);     // The factors for the base color of the material
+	std::optional<unsigned int> baseColorTexture;    // The index of the base color texture
+	unsigned int baseColorTexCoord = 0;               // The set index of the base color texture's TEXCOORD attribute
+	bool doubleSided = false;                         // Whether back faces are drawn too instead of culled
+};
+
+#endif
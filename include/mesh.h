@@ -3,22 +3,50 @@
 
 #include <glad/glad.h>
 
-#include <string>
-#include <map>
+#include <optional>
+#include <vector>
 
+// Every attribute semantic a primitive can carry, indexed sets are capped at the counts below
 enum Attribute {
-	NORMAL,
 	POSITION,
+	NORMAL,
+	TANGENT,
 	TEXCOORD_0,
-	COLOR_0
+	TEXCOORD_1,
+	TEXCOORD_2,
+	TEXCOORD_3,
+	COLOR_0,
+	COLOR_1,
+	JOINTS_0,
+	JOINTS_1,
+	WEIGHTS_0,
+	WEIGHTS_1,
+	ATTRIBUTE_COUNT
 };
 
+// The number of TEXCOORD_n, COLOR_n, JOINTS_n and WEIGHTS_n sets that fit in a primitive
+const unsigned int MAX_TEXCOORD_SETS = 4;
+const unsigned int MAX_COLOR_SETS = 2;
+const unsigned int MAX_JOINT_SETS = 2;
+
+// Marks an attribute the primitive does not have
+const unsigned int NO_ACCESSOR = 0xFFFFFFFF;
+
 // Geometry to be rendered within the given material
 struct Mesh_Primitive {
-	std::map<Attribute, unsigned int> attributes; // A collection of pairs where each key corresponds to a mesh attribute semantic and each value is the index of the accessor containing attribute's data
-	unsigned int  indices = 0; // The index of the accessor that contains the vertex indices
-	unsigned int material; // The index of the material to apply to this primitive when rendering
-	GLenum mode;           // Type of primitive to render
+	unsigned int attributes[ATTRIBUTE_COUNT]; // For each attribute semantic, the index of the accessor containing the attribute's data, or NO_ACCESSOR
+	std::optional<unsigned int> indices;  // The index of the accessor that contains the vertex indices
+	std::optional<unsigned int> material; // The index of the material to apply to this primitive when rendering
+	GLenum mode = GL_TRIANGLES;           // Type of primitive to render
+
+	Mesh_Primitive() {
+		for (unsigned int& attribute : attributes) {
+			attribute = NO_ACCESSOR;
+		}
+	}
+
+	// Whether the primitive has data for the given semantic
+	bool has(Attribute attribute) const { return attributes[attribute] != NO_ACCESSOR; }
 };
 
 // A set of primitives to be rendered
@@ -26,4 +54,4 @@ struct Mesh {
 	std::vector<Mesh_Primitive> primitives; // A collection of primitives, each defining geometry to be rendered
     
 };
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,96 @@
+#ifndef MESH_OPTIMIZE_H
+#define MESH_OPTIMIZE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// The entries of the post-transform cache the optimizer plans for and the analysis simulates
+const size_t VERTEX_CACHE_SIZE = 16;
+
+// How often a triangle list makes the GPU transform a vertex, counts add up over several lists
+struct VertexCacheStats {
+	size_t triangles = 0;   // The triangles drawn
+	size_t vertices = 0;    // The distinct vertices they use
+	size_t transforms = 0;  // The vertices shaded, every cache miss
+
+	// Average cache miss ratio, the vertices shaded per triangle, 0.5 at best and 3 at worst
+	double acmr() const { return triangles != 0 ? static_cast<double>(transforms) / triangles : 0.0; }
+	// Average transform to vertex ratio, the times each vertex is shaded, 1 at best
+	double atvr() const { return vertices != 0 ? static_cast<double>(transforms) / vertices : 0.0; }
+
+	void add(const VertexCacheStats& other) {
+		triangles += other.triangles;
+		vertices += other.vertices;
+		transforms += other.transforms;
+	}
+};
+
+// How much a triangle list overdraws, counts add up over several lists
+struct OverdrawStats {
+	size_t covered = 0;     // The pixels any triangle covers
+	size_t shaded = 0;      // The fragments that passed the depth test, every one of them shaded
+
+	// The times each covered pixel is shaded, 1 at best
+	double overdraw() const { return covered != 0 ? static_cast<double>(shaded) / covered : 0.0; }
+
+	void add(const OverdrawStats& other) {
+		covered += other.covered;
+		shaded += other.shaded;
+	}
+};
+
+// One attribute weldVertices compares vertices by
+struct WeldAttribute {
+	const unsigned char* data = nullptr;  // The value of the first vertex
+	size_t stride = 0;        // The distance in bytes between the values of consecutive vertices
+	size_t size = 0;          // The bytes of one value
+	float tolerance = 0.0f;   // When above 0, the value is floats snapped to a grid this fine instead of compared bit for bit
+};
+
+// Simulate a FIFO post-transform cache of cacheSize entries drawing a triangle list
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t count, size_t vertexCount, size_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorder the triangles of a triangle list so consecutive triangles share vertices still in the post-transform
+// cache, with Forsyth's linear-speed scoring. The triangles and their winding are kept. Every index must be
+// below vertexCount.
+void optimizeVertexCache(uint32_t* indices, size_t count, size_t vertexCount);
+
+// Rasterize a triangle list on the CPU from the six axis-aligned views of its bounds, drawing triangles in order
+// with a depth test and back faces culled, and count the fragments shaded. positions holds three floats per vertex.
+OverdrawStats analyzeOverdraw(const uint32_t* indices, size_t count, const float* positions, size_t vertexCount);
+
+// Reorder a triangle list already ordered for the vertex cache so it overdraws less from outside, after Sander et al.
+// The list is cut into clusters where the cache order restarts, and again wherever the miss ratio of a cluster so far
+// drops to threshold times the miss ratio of its whole run. Clusters facing out of the mesh are then drawn first.
+// Larger thresholds cut smaller clusters, trading cache hits for less overdraw; 1.05 costs about 5% more misses.
+void optimizeOverdraw(uint32_t* indices, size_t count, const float* positions, size_t vertexCount, float threshold);
+
+// Renumber the vertices in the order the indices first use them, so vertex fetches walk memory forward.
+// remap receives the new place of every old vertex, vertices no index uses keep their order after the rest.
+// Returns the number of vertices the indices use.
+size_t optimizeVertexFetch(uint32_t* indices, size_t count, size_t vertexCount, std::vector<uint32_t>& remap);
+
+
+// Find the distinct vertices of a vertex stream with an open addressing hash table. remap receives, for every vertex,
+// the index of its distinct vertex, and unique the first vertex of each distinct one in order of appearance. Values
+// compared with a tolerance are equal when they snap to the same grid point, so values closer than the tolerance can
+// still stay apart across a grid line. Returns the number of distinct vertices.
+size_t weldVertices(const WeldAttribute* attributes, size_t attributeCount, size_t vertexCount,
+	std::vector<uint32_t>& remap, std::vector<uint32_t>& unique);
+
+// Simplify a triangle list by collapsing edges in the order of their quadric error, after Garland and Heckbert, into
+// out, which holds count indices. Vertices only ever move onto their neighbours, so the result indexes the same
+// vertices. Vertices sharing a position move together: where two of them split an attribute seam, they slide along
+// the seam, while open borders, edges of more than two triangles and corners where seams meet stay where they are.
+// Collapses that would turn a triangle over or pinch the surface into a non-manifold shape are skipped.
+// normals, three floats per vertex, may be null; when given, how far the interpolated normals change adds to the
+// error. lockedVertices, one flag per vertex, may be null; flagged vertices stay where they are too. Stops at
+// targetCount indices or when the next collapse would move the surface by more than maxError. error receives the
+// distance the surface moved, in the units of the positions. Returns the number of indices written.
+size_t simplifyMesh(const uint32_t* indices, size_t count, const float* positions, const float* normals, size_t vertexCount,
+	size_t targetCount, float maxError, uint32_t* out, float& error, const unsigned char* lockedVertices = nullptr);
+
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+
+// The most distinct vertices and triangles of a meshlet, the sizes mesh shading hardware is tuned for
+const size_t MESHLET_MAX_VERTICES = 64;
+const size_t MESHLET_MAX_TRIANGLES = 124;
+
+// A run of consecutive triangles of a primitive's index stream, small enough to be culled on its own.
+// Stored in cache files as is.
+struct Meshlet {
+	uint32_t firstIndex = 0;    // The first index of the run, counted from the primitive's first index
+	uint32_t indexCount = 0;    // The indices of the run, three per triangle
+	float center[3] = {};       // The bounding sphere of the triangles, in the primitive's space
+	float radius = 0.0f;
+	float coneAxis[3] = {};     // The average direction the triangles face
+	float coneCutoff = 1.0f;    // The sine of the angle the triangle normals spread around the axis, 1 when the cone cannot cull
+};
+
+// A cluster of a hierarchy of ever coarser clusters over one surface, after Nanite. Clusters are simplified in groups,
+// and every group is replaced by the clusters its simplified triangles are cut into. Stored in cache files as is.
+struct ClusterLod {
+	uint32_t firstIndex = 0;     // The first index of the cluster, counted from the primitive's first index
+	uint32_t indexCount = 0;     // The indices of the cluster, three per triangle
+	float center[3] = {};        // The sphere the cluster's error is seen from, shared with the clusters built alongside it
+	float radius = 0.0f;
+	float error = 0.0f;          // How far the cluster strays from the full surface, 0 on the finest level
+	float parentCenter[3] = {};  // The sphere and error of the group that replaces the cluster and its siblings
+	float parentRadius = 0.0f;
+	float parentError = FLT_MAX; // FLT_MAX when nothing replaces it
+};
+
+// A range of a primitive's indices to draw
+struct IndexRun {
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+};
+
+// What meshlet culling kept, counts add up over several primitives and frames
+struct MeshletCullStats {
+	size_t meshlets = 0;          // The meshlets tested
+	size_t triangles = 0;         // Their triangles
+	size_t culledMeshlets = 0;    // The meshlets outside the frustum or facing away
+	size_t culledTriangles = 0;   // Their triangles
+
+	// The share of the triangles that was skipped
+	double culled() const { return triangles != 0 ? static_cast<double>(culledTriangles) / triangles : 0.0; }
+
+	void add(const MeshletCullStats& other) {
+		meshlets += other.meshlets;
+		triangles += other.triangles;
+		culledMeshlets += other.culledMeshlets;
+		culledTriangles += other.culledTriangles;
+	}
+};
+
+// Cut a triangle list into meshlets of at most maxVertices distinct vertices and maxTriangles triangles. The triangle
+// order is kept, so the list still draws as before and a cache-optimized order gives compact meshlets. positions holds
+// three floats per vertex and every index must be below vertexCount. The meshlets are appended, returns their number.
+size_t buildMeshlets(const uint32_t* indices, size_t count, const float* positions, size_t vertexCount, std::vector<Meshlet>& meshlets,
+	size_t maxVertices = MESHLET_MAX_VERTICES, size_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+// Whether every triangle of a meshlet can be skipped, its bounds are outside one of the six frustum planes or its
+// triangles all face away from eye. The planes point inwards and, like eye, are in the primitive's space. glTF flips
+// the front face with a mirroring transform, so the triangles that face eye are the same either way. Only cull a
+// single-sided surface with the cone, and cull its back faces on the GPU too; double-sided ones bake coneCutoff 1.
+bool cullMeshlet(const Meshlet& meshlet, const glm::vec4* planes, const glm::vec3& eye);
+
+// How many pixels an error of the given size covers at the point of a sphere nearest to eye, seen through a vertical
+// field of view of fovY radians on a viewport viewportHeight pixels high. world places the sphere and scales the
+// error. 0 for no error, FLT_MAX when eye is inside the sphere.
+float getScreenError(float error, const glm::vec3& center, float radius, const glm::mat4& world, const glm::vec3& eye,
+	float fovY, float viewportHeight);
+
+// Build a cluster hierarchy over a triangle list. The finest clusters are its meshlets, which index the list itself.
+// Then neighbouring clusters are grouped up to four clusters' worth of triangles, a lone leftover cluster joining the
+// group it shares most vertices with, and every group is simplified to half its triangles with its borders locked
+// and cut into new clusters of about equal size, so the next level groups across the old borders. This goes on level
+// after level until one cluster is left or no group simplifies any more.
+// The triangles of every coarser cluster are appended to extraIndices, their firstIndex counts on from the end of
+// the list. positions and normals hold three floats per vertex, normals may be null. Returns the number of levels.
+size_t buildClusterLod(const uint32_t* indices, size_t count, const float* positions, const float* normals, size_t vertexCount,
+	std::vector<ClusterLod>& clusters, std::vector<uint32_t>& extraIndices);
+
+// Pick the clusters of a hierarchy to draw: those whose error covers at most pixelError pixels while the error of the
+// group replacing them covers more. Siblings share both errors, so the cut never leaves cracks. Clusters outside the
+// frustum are skipped, the index runs of the rest replace runs, merging runs that follow each other.
+// Returns the number of triangles picked.
+size_t selectClusters(const ClusterLod* clusters, size_t count, const glm::mat4& world, const glm::mat4& viewProjection,
+	const glm::vec3& eye, float fovY, float viewportHeight, float pixelError, std::vector<IndexRun>& runs);
+
+// Cull the meshlets of a primitive drawn with the world transform from a camera at eye, in world space, and replace
+// runs by the index runs left to draw, merging runs that follow each other. Counts what was culled into stats when given.
+void cullMeshlets(const Meshlet* meshlets, size_t count, const glm::mat4& world, const glm::mat4& viewProjection, const glm::vec3& eye,
+	std::vector<IndexRun>& runs, MeshletCullStats* stats = nullptr);
+
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef MESHOPT_DECODE_H
+#define MESHOPT_DECODE_H
+
+#include <cstddef>
+
+#include "bufferView.h"
+
+
+// Decoders for the codecs of EXT_meshopt_compression. Each one writes exactly count * byteStride bytes
+// and returns false if the data is malformed, the output is then left partially written.
+
+// Decode elements of byteStride bytes, a multiple of 4 up to 256, compressed by the attribute codec
+bool decodeMeshoptAttributes(unsigned char* out, size_t count, size_t byteStride, const unsigned char* data, size_t size);
+
+// Decode a triangle list of 2 or 4 byte indices compressed by the triangle codec, count is a multiple of 3
+bool decodeMeshoptTriangles(unsigned char* out, size_t count, size_t indexSize, const unsigned char* data, size_t size);
+
+// Decode a sequence of 2 or 4 byte indices compressed by the index sequence codec
+bool decodeMeshoptIndices(unsigned char* out, size_t count, size_t indexSize, const unsigned char* data, size_t size);
+
+// Undo the filter of decoded attribute data in place
+bool unfilterMeshopt(unsigned char* data, size_t count, size_t byteStride, Meshopt_Filter filter);
+
+// Decode a whole buffer view: the codec of its mode followed by its filter
+bool decodeMeshoptView(const Meshopt_Compression& compression, const unsigned char* data, unsigned char* out);
+
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef NODE_H
+#define NODE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <optional>
+#include <vector>
+
+// A node in the node hierarchy, its transform is a matrix or a translation, rotation and scale
+struct Node {
+	std::optional<unsigned int> mesh;     // The index of the mesh in this node
+	std::vector<unsigned int> children;   // The indices of this node's children
+	glm::mat4 matrix = glm::mat4(1.0f);   // The local transform, already combined from translation, rotation and scale
+	glm::vec3 translation = glm::vec3(0.0f); // The node's translation along the x, y and z axes
+	glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f); // The node's unit quaternion rotation
+	glm::vec3 scale = glm::vec3(1.0f);       // The node's non-uniform scale
+};
+
+#endif
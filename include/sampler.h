@@ -0,0 +1,14 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <glad/glad.h>
+
+// Texture sampler properties for filtering and wrapping modes
+struct Sampler {
+	GLint magFilter = GL_LINEAR;               // Magnification filter
+	GLint minFilter = GL_LINEAR_MIPMAP_LINEAR; // Minification filter
+	GLint wrapS = GL_REPEAT;                   // S (U) wrapping mode
+	GLint wrapT = GL_REPEAT;                   // T (V) wrapping mode
+};
+
+#endif
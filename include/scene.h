@@ -0,0 +1,11 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <vector>
+
+// The root nodes of a scene
+struct Scene {
+	std::vector<unsigned int> nodes; // The indices of each root node
+};
+
+#endif
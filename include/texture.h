@@ -0,0 +1,12 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <optional>
+
+// A texture and its sampler
+struct Texture {
+	std::optional<unsigned int> sampler; // The index of the sampler used by this texture, repeat and auto filtering when undefined
+	std::optional<unsigned int> source;  // The index of the image used by this texture
+};
+
+#endif
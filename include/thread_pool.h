@@ -0,0 +1,72 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// A fixed set of worker threads running queued tasks in submission order
+class ThreadPool {
+public:
+	// 0 workers means one per hardware thread
+	explicit ThreadPool(unsigned int workers = 0);
+	// Runs every task already queued, then joins the workers
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Queue a task, the future reports its completion and rethrows its exception
+	std::future<void> Submit(std::function<void()> task);
+
+	unsigned int Size() const { return static_cast<unsigned int>(threads.size()); }
+
+private:
+	std::vector<std::thread> threads;
+	std::deque<std::packaged_task<void()>> queue;
+	std::mutex mutex;
+	std::condition_variable ready;
+	bool stopping = false;
+
+	void work();
+};
+
+// Caps the number of bytes being read or decoded at the same time
+class ByteBudget {
+public:
+	// 0 bytes means no limit
+	explicit ByteBudget(size_t capacity);
+
+	// Block until the bytes fit, a single request larger than the whole budget waits until it runs alone
+	void Acquire(size_t bytes);
+	void Release(size_t bytes);
+
+private:
+	size_t capacity;
+	size_t inFlight = 0;
+	std::mutex mutex;
+	std::condition_variable released;
+};
+
+// Holds bytes of a ByteBudget until it goes out of scope
+class ByteReservation {
+public:
+	ByteReservation(ByteBudget& budget, size_t bytes) : budget(budget), bytes(bytes) { budget.Acquire(bytes); }
+	~ByteReservation() { budget.Release(bytes); }
+
+	ByteReservation(const ByteReservation&) = delete;
+	ByteReservation& operator=(const ByteReservation&) = delete;
+
+private:
+	ByteBudget& budget;
+	size_t bytes;
+};
+
+
+#endif
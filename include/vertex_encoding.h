@@ -0,0 +1,53 @@
+#ifndef VERTEX_ENCODING_H
+#define VERTEX_ENCODING_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+// What the compact vertex encodings saved and how far they moved the values, counts add up and errors take the
+// largest over several primitives
+struct VertexEncodingStats {
+	size_t bytesBefore = 0;       // The vertices of the encoded primitives before encoding
+	size_t bytesAfter = 0;        // The same vertices once encoded
+	float positionError = 0.0f;   // The farthest a quantized position moved, in the units of its primitive
+	float normalError = 0.0f;     // The largest angle between a normal and its decoded value, in degrees
+	float tangentError = 0.0f;    // The same for tangents, a lost bitangent sign counts as 180
+	float texcoordError = 0.0f;   // The largest change of a texture coordinate stored as half float
+	size_t floatTexcoords = 0;    // The primitives whose texture coordinates stayed float, as halves would move them too far
+
+	void add(const VertexEncodingStats& other) {
+		bytesBefore += other.bytesBefore;
+		bytesAfter += other.bytesAfter;
+		positionError = positionError > other.positionError ? positionError : other.positionError;
+		normalError = normalError > other.normalError ? normalError : other.normalError;
+		tangentError = tangentError > other.tangentError ? tangentError : other.tangentError;
+		texcoordError = texcoordError > other.texcoordError ? texcoordError : other.texcoordError;
+		floatTexcoords += other.floatTexcoords;
+	}
+};
+
+// Encode a unit vector as the two components of its octahedral map, snorm integers of bits bits, 8 or 16. Of the
+// four roundings of the components the one that decodes closest to the vector is kept, after Cigolle et al.
+void encodeOctahedral(const float* vector, unsigned int bits, int32_t* encoded);
+
+// The unit vector two octahedral snorm components decode to, with the GPU's snorm conversion
+void decodeOctahedral(const int32_t* encoded, unsigned int bits, float* vector);
+
+// Encode a tangent with the sign of its bitangent in w as two octahedral snorm components. The second component is
+// remapped to [0, 1] and its sign is the bitangent's, so it keeps one bit less than the first.
+void encodeTangent(const float* tangent, unsigned int bits, int32_t* encoded);
+
+// The tangent and bitangent sign two components written by encodeTangent decode to
+void decodeTangent(const int32_t* encoded, unsigned int bits, float* tangent);
+
+// The float a half float stands for, exactly
+float halfToFloat(uint16_t half);
+
+// GLSL functions decoding the attributes above once the GPU has mapped their snorm components to [-1, 1]:
+// vec3 decodeOctahedral(vec2) and vec4 decodeTangent(vec2), which needs the first
+extern const char* const OCTAHEDRAL_DECODE_GLSL;
+extern const char* const TANGENT_DECODE_GLSL;
+
+
+#endif
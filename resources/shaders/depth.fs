@@ -0,0 +1,5 @@
+#version 330 core
+
+void main(){
+  // Depth only, the color writes are masked
+}
\ No newline at end of file
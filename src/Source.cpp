@@ -1,14 +1,30 @@
+#include <algorithm>
+#include <cstring>
 #include <iostream>
-
-#include "stb_image.h"
+#include <optional>
 
 #include "../include/glTF_loader.h"
+#include "../include/async_loader.h"
 #include "../include/shader.h"
 #include "../include/camera.h"
+#include "../include/index_buffer.h"
 
 // Settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+// Upload the buffer views of the file as they are and point the attributes into them, instead of baking the vertices first
+const bool UPLOAD_BUFFER_VIEWS = false;
+// The most pixels a coarser level may be off by on screen before a finer one is drawn
+const float LOD_PIXEL_ERROR = 1.0f;
+// Draw a cut through a cluster hierarchy instead of a level of the chain of coarser levels with its meshlets culled.
+// A primitive with clusters draws only those, so the other two are not built alongside them.
+const bool CLUSTER_LOD = true;
+// Give every batch of interleaved vertices a tight copy of its positions and every primitive a vertex array reading
+// positions only, for the passes that need nothing else
+const bool POSITION_STREAMS = true;
+// Fill the depth buffer with positions only before shading, so every pixel is shaded once. The shading pass tests
+// GL_LEQUAL against it, its vertex shader has to compute gl_Position exactly like depth.vs.
+const bool DEPTH_PREPASS = false;
 
 // Process input
 void processInput(GLFWwindow* window);
@@ -30,49 +46,81 @@ float lastFrame = 0.0f;
 // Light position
 glm::vec3 lightPos = glm::vec3(-0.6f, 4.0f, 1.0f);
 
-size_t getNumComponents(const std::string& type) {
-	if (type == "VEC2")
-		return 2;
-	if (type == "VEC3")
-		return 3;
-	if (type == "VEC4")
-		return 4;
-}
-
-
-size_t getComponentTypeSize(GLenum componentType) {
-	switch (componentType) {
-	case GL_BYTE:           return sizeof(int8_t);
-	case GL_UNSIGNED_BYTE:  return sizeof(uint8_t);
-	case GL_SHORT:          return sizeof(int16_t);
-	case GL_UNSIGNED_SHORT: return sizeof(uint16_t);
-	case GL_INT:            return sizeof(int32_t);
-	case GL_UNSIGNED_INT:   return sizeof(uint32_t);
-	case GL_FLOAT:          return sizeof(float);
-	default:
-		std::cerr << "Unsupported component type: " << componentType << std::endl;
-		return 0;
-	}
-}
+// Primitives whose vertices are laid out alike share one vertex array,
+// their vertices and indices packed one after another into one buffer each
+struct LayoutBatch {
+	unsigned int VAO = 0;
+	unsigned int VBO = 0;
+	unsigned int EBO = 0;
+	unsigned int positionVAO = 0; // Reads positions only, from positionVBO or from the position stream of split vertices
+	unsigned int positionVBO = 0; // The positions of interleaved vertices copied into one tight stream, 0 for split ones
+	BakedPrimitive layout;      // The first primitive of the batch, every other one has the same layout
+	size_t vertexCount = 0;     // The vertices of every primitive in the batch
+	size_t indexBytes = 0;      // The index bytes of every primitive in the batch
+};
 
-struct Vertex {
-	glm::vec3 Position;
-	glm::vec3 Normal;
-	glm::vec3 Color;
-	glm::vec2 TexCoord;
+// Where the vertices and indices of a primitive are in its batch
+struct BatchRange {
+	unsigned int batch = 0;
+	size_t firstVertex = 0;
+	size_t indexOffset = 0;     // In bytes, a multiple of 4
 };
 
-std::vector<unsigned int> VAOs;
-std::vector<unsigned int> VBOs;
-std::vector<unsigned int> EBOs;
-std::unordered_map<unsigned int, std::vector<unsigned char>> indices;
-std::unordered_map<unsigned int, GLenum> modes;
-std::vector<unsigned int> Textures;
-std::vector<size_t> vertices_count;
+// Everything needed to draw one primitive, whichever way its data was uploaded
+struct PrimitiveDraw {
+	unsigned int VAO = 0;
+	unsigned int positionVAO = 0; // Reads the same vertices' positions only with the same indices, 0 to fall back to VAO
+	unsigned int texture = 0;
+	GLenum mode = GL_TRIANGLES;
+	bool doubleSided = false;   // Drawn with back faces, otherwise they are culled like meshlet culling culls them
+	bool indexed = false;
+	GLenum indexType = GL_UNSIGNED_SHORT;
+	GLuint minIndex = 0;        // The smallest and largest index, before firstVertex is added
+	GLuint maxIndex = 0;
+	GLsizei count = 0;          // The indices, or the vertices when not indexed
+	size_t indexOffset = 0;     // Where the indices start in the element buffer, in bytes
+	GLint firstVertex = 0;      // Added to every index, or the first vertex drawn when not indexed
+	size_t firstMeshlet = 0;    // The primitive's meshlets in meshlets, culled before every draw
+	size_t meshletCount = 0;
+	size_t firstLod = 0;        // The primitive's coarser levels in lods, chosen by their error on screen
+	size_t lodCount = 0;
+	size_t firstCluster = 0;    // The primitive's cluster hierarchy in clusters, cut by the error of every cluster on screen
+	size_t clusterCount = 0;
+	glm::vec4 bounds = glm::vec4(0.0f); // The bounding sphere the levels are chosen by, radius in w
+	glm::mat4 positionTransform = glm::mat4(1.0f); // Undoes quantized positions, applied before the node's transform
+};
 
-void Draw(Shader& shader);
-void setUpMesh(Mesh& mesh, glTFloader& loader);
-void ProcessMesh(glTFloader& loader);
+std::vector<LayoutBatch> batches;
+std::vector<BatchRange> ranges;   // Indexed like primitives
+std::vector<PrimitiveDraw> draws; // Indexed like primitives
+// The buffers and vertex arrays that belong to no batch, created when uploading buffer views
+std::vector<unsigned int> buffers;
+std::vector<unsigned int> vertexArrays;
+// The meshes and scene of the uploaded model, primitives are indexed like the model's
+std::vector<BakedMesh> meshes;
+std::vector<BakedNode> nodes;
+// The meshlets of every primitive, the index runs that survive culling and how many triangles it skipped
+std::vector<Meshlet> meshlets;
+std::vector<IndexRun> visibleRuns;
+MeshletCullStats cullStats;
+// The coarser levels of every primitive
+std::vector<BakedLod> lods;
+// The cluster hierarchies of every primitive
+std::vector<ClusterLod> clusters;
+
+void Draw(Shader& shader, const glm::mat4& viewProjection, bool positionsOnly = false);
+void DrawPrimitive(Shader& shader, unsigned int i, const glm::mat4& world, const glm::mat4& viewProjection, bool positionsOnly);
+unsigned int setUpTexture(int image, const BakedImage& pixels, const Sampler& sampler);
+void setUpBatches(const BakedModel& model);
+void setUpLayout(LayoutBatch& batch);
+void setUpPositionLayout(LayoutBatch& batch);
+void setUpMesh(const BakedMesh& mesh, const BakedModel& model);
+void ProcessMesh(const BakedModel& model, LoadProgress& progress);
+unsigned int getViewBuffer(const glTFloader& loader, unsigned int bufferView, std::vector<unsigned int>& viewBuffers);
+bool bindAccessor(const glTFloader& loader, unsigned int accessor, std::vector<unsigned int>& viewBuffers,
+	unsigned int& buffer, size_t& offset, size_t& stride, IndexRange* indexRange = nullptr);
+void setUpPrimitive(const Mesh_Primitive& primitive, const glTFloader& loader, std::vector<unsigned int>& viewBuffers);
+void ProcessModel(const glTFloader& loader, LoadProgress& progress);
 
 int main() {
 	glfwInit();
@@ -104,13 +152,82 @@ int main() {
 
 	// Create a shader
 	Shader shader("resources/shaders/textured_cube.vs", "resources/shaders/textured_cube.fs");
+	// Writes depth only, reading nothing but positions
+	Shader depthShader("resources/shaders/depth.vs", "resources/shaders/depth.fs");
 
 	const std::string modelPath = "resources/models/BoxTextured/glTF/BoxTextured.gltf";
 	const std::string directory = "resources/models/BoxTextured/glTF/";
-	glTFloader loader(modelPath, directory);
-	ProcessMesh(loader);
+	// Processed models are cached next to their source, a current cache is mapped instead of parsed
+	const std::string cachePath = modelPath + ".cache";
+	// The model loads in the background, the window keeps drawing until it can be uploaded
+	std::optional<LoadHandle<BakedModel>> bakedLoad;
+	std::optional<LoadHandle<glTFloader>> sourceLoad;
+	if (UPLOAD_BUFFER_VIEWS) {
+		sourceLoad.emplace(LoadModelAsync(modelPath, directory));
+	}
+	else {
+		// Optimized once when the cache is built, a current cache already holds the reordered streams
+		BakeOptions bakeOptions;
+		bakeOptions.weldVertices = true;
+		bakeOptions.optimizeVertexCache = true;
+		bakeOptions.optimizeOverdraw = true;
+		bakeOptions.buildMeshlets = !CLUSTER_LOD;
+		bakeOptions.lodLevels = CLUSTER_LOD ? 0 : 4;
+		bakeOptions.buildClusterLod = CLUSTER_LOD;
+		// Quantized positions and half texture coordinates reach the shader as floats. Normals stay float, as
+		// octahedral ones need the decoder of getVertexDecodeGLSL in the shader.
+		bakeOptions.quantizePositions = true;
+		bakeOptions.halfTexcoords = true;
+		bakedLoad.emplace(LoadBakedModelAsync(modelPath, directory, cachePath, LoaderOptions(), CacheOptions(), bakeOptions));
+	}
+	bool uploaded = false;
 
 	while (!glfwWindowShouldClose(window)) {
+		// Upload the model on the GL thread once it is ready
+		if (!uploaded && bakedLoad && bakedLoad->Ready()) {
+			std::shared_ptr<BakedModel> model = bakedLoad->GetModel().get();
+			if (model) {
+				const BakeReport& report = model->Report;
+				if (report.weldedVerticesBefore != 0) {
+					std::cout << "Welded " << report.weldedVerticesBefore << " vertices into " << report.weldedVerticesAfter << std::endl;
+				}
+				if (report.vertexCacheBefore.triangles != 0) {
+					std::cout << "Vertex cache ACMR " << report.vertexCacheBefore.acmr() << " -> " << report.vertexCacheAfter.acmr()
+						<< ", ATVR " << report.vertexCacheBefore.atvr() << " -> " << report.vertexCacheAfter.atvr()
+						<< ", overdraw " << report.overdrawBefore.overdraw() << " -> " << report.overdrawAfter.overdraw() << std::endl;
+				}
+				if (report.storedOrderKept != 0) {
+					std::cout << report.storedOrderKept << " primitives kept their stored triangle order" << std::endl;
+				}
+				if (report.meshlets != 0) {
+					std::cout << report.meshletTriangles << " triangles in " << report.meshlets << " meshlets" << std::endl;
+				}
+				if (report.lodLevels != 0) {
+					std::cout << report.lodTriangles << " triangles in " << report.lodLevels << " coarser levels" << std::endl;
+				}
+				if (report.encoding.bytesBefore != 0) {
+					std::cout << "Vertex encoding " << report.encoding.bytesBefore << " -> " << report.encoding.bytesAfter << " bytes, position error "
+						<< report.encoding.positionError << ", texcoord error " << report.encoding.texcoordError << std::endl;
+				}
+				if (report.clusters != 0) {
+					std::cout << report.clusters << " clusters over " << report.clusterLevels << " levels, "
+						<< report.clusterTriangles << " triangles coarser than the meshlets" << std::endl;
+				}
+				if (report.cacheSaveFailed) {
+					std::cout << "Failed to write the cache " << cachePath << ", the model is baked again next time" << std::endl;
+				}
+				ProcessMesh(*model, bakedLoad->Progress());
+			}
+			uploaded = true;
+		}
+		if (!uploaded && sourceLoad && sourceLoad->Ready()) {
+			std::shared_ptr<glTFloader> model = sourceLoad->GetModel().get();
+			if (model) {
+				ProcessModel(*model, sourceLoad->Progress());
+			}
+			uploaded = true;
+		}
+
 		// Per-frame time logic
 	   // --------------------
 		float currentFrame = static_cast<float>(glfwGetTime());
@@ -130,6 +247,17 @@ int main() {
 		glm::mat4 view = camera.GetViewMatrix();
 		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), static_cast<float>(SCR_WIDTH) / static_cast<float>(SCR_HEIGHT), 0.1f, 100.0f);
 
+		if (DEPTH_PREPASS) {
+			depthShader.Use();
+			depthShader.SetMatrix4f("view", view);
+			depthShader.SetMatrix4f("projection", projection);
+			glDepthFunc(GL_LESS);
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			Draw(depthShader, projection * view, true);
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			glDepthFunc(GL_LEQUAL);
+		}
+
 		// Use shader program
 		shader.Use();
 
@@ -138,28 +266,47 @@ int main() {
 		shader.SetMatrix4f("view", view);
 		shader.SetMatrix4f("projection", projection);
 		
-		Draw(shader);
+		Draw(shader, projection * view);
 
 
 		glfwSwapBuffers(window);
 	}
+	// Stop loading if the window closed first
+	if (bakedLoad) {
+		bakedLoad->Cancel();
+	}
+	if (sourceLoad) {
+		sourceLoad->Cancel();
+	}
+
 	// De-allocate resources
-	for (unsigned int& VBO : VBOs) {
-		glDeleteBuffers(1, &VBO);
+	for (LayoutBatch& batch : batches) {
+		glDeleteBuffers(1, &batch.VBO);
+		glDeleteBuffers(1, &batch.EBO);
+		glDeleteVertexArrays(1, &batch.VAO);
+		glDeleteBuffers(1, &batch.positionVBO);
+		glDeleteVertexArrays(1, &batch.positionVAO);
+	}
+	batches.clear();
+	ranges.clear();
+	for (unsigned int& buffer : buffers) {
+		glDeleteBuffers(1, &buffer);
 	}
-	VBOs.clear();
-	for (unsigned int& EBO : EBOs) {
-		glDeleteBuffers(1, &EBO);
+	buffers.clear();
+	for (unsigned int& vertexArray : vertexArrays) {
+		glDeleteVertexArrays(1, &vertexArray);
 	}
-	EBOs.clear();
-	for (unsigned int& VAO : VAOs) {
-		glDeleteVertexArrays(1, &VAO);
+	vertexArrays.clear();
+	for (PrimitiveDraw& draw : draws) {
+		glDeleteTextures(1, &draw.texture);
 	}
-	VAOs.clear();
-	for (unsigned int& texture : Textures) {
-		glDeleteTextures(1, &texture);
+	draws.clear();
+	meshlets.clear();
+	lods.clear();
+	clusters.clear();
+	if (cullStats.triangles != 0) {
+		std::cout << "Meshlet culling skipped " << cullStats.culled() * 100.0 << "% of the triangles" << std::endl;
 	}
-	Textures.clear();
 
 	glfwDestroyWindow(window);
 
@@ -223,148 +370,447 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 	camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
 
-void Draw(Shader& shader) {
+void Draw(Shader& shader, const glm::mat4& viewProjection, bool positionsOnly) {
 	shader.Use();
-	for (int i = 0; i != VAOs.size(); ++i) {
-		glBindVertexArray(VAOs[i]);
-		glBindTexture(GL_TEXTURE_2D, Textures[i]);
-		if (!indices.empty()) {
-			glDrawElements(modes[i], indices[i].size(), GL_UNSIGNED_SHORT, 0);
+	// A model without a scene draws every primitive once, in place
+	if (nodes.empty()) {
+		for (unsigned int i = 0; i != draws.size(); ++i) {
+			DrawPrimitive(shader, i, glm::mat4(1.0f), viewProjection, positionsOnly);
 		}
-		else {
-			glDrawArrays(modes[i], 0, vertices_count[i]);
+		return;
+	}
+	// Otherwise every node draws its mesh with its world transform, which also undoes quantized positions
+	for (const BakedNode& node : nodes) {
+		if (node.mesh < 0 || node.mesh >= static_cast<int>(meshes.size())) {
+			continue;
+		}
+		const BakedMesh& mesh = meshes[node.mesh];
+		for (unsigned int p = 0; p != mesh.primitiveCount; ++p) {
+			DrawPrimitive(shader, mesh.firstPrimitive + p, node.world, viewProjection, positionsOnly);
+		}
+	}
+}
+
+void DrawPrimitive(Shader& shader, unsigned int i, const glm::mat4& world, const glm::mat4& viewProjection, bool positionsOnly) {
+	if (i >= draws.size()) {
+		return;
+	}
+	const PrimitiveDraw& draw = draws[i];
+	// Culling and levels work in the primitive's space, only the shader sees the stored positions
+	shader.SetMatrix4f("model", world * draw.positionTransform);
+	// Depth, shadow and picking passes fetch positions only. Both passes pick the same indices, so their depths agree.
+	if (positionsOnly && draw.positionVAO != 0) {
+		glBindVertexArray(draw.positionVAO);
+	}
+	else {
+		glBindVertexArray(draw.VAO);
+	}
+	if (!positionsOnly) {
+		glBindTexture(GL_TEXTURE_2D, draw.texture);
+	}
+	// Meshlets facing away are skipped on the CPU, so the GPU has to cull the back faces of the rest too or the
+	// surface would lose them in patches. A mirroring transform turns the winding of the front faces around.
+	if (draw.doubleSided) {
+		glDisable(GL_CULL_FACE);
+	}
+	else {
+		glEnable(GL_CULL_FACE);
+		glFrontFace(glm::determinant(glm::mat3(world)) < 0.0f ? GL_CW : GL_CCW);
+	}
+	if (draw.clusterCount != 0) {
+		// The cut through the hierarchy changes cluster by cluster, finer near the camera and coarser away from it
+		selectClusters(clusters.data() + draw.firstCluster, draw.clusterCount, world, viewProjection, camera.Position,
+			glm::radians(camera.Zoom), static_cast<float>(SCR_HEIGHT), LOD_PIXEL_ERROR, visibleRuns);
+		const size_t indexSize = getComponentTypeSize(draw.indexType);
+		for (const IndexRun& run : visibleRuns) {
+			glDrawRangeElementsBaseVertex(draw.mode, draw.minIndex, draw.maxIndex, run.indexCount, draw.indexType,
+				reinterpret_cast<void*>(draw.indexOffset + run.firstIndex * indexSize), draw.firstVertex);
 		}
 		glBindVertexArray(0);
+		return;
+	}
+	const unsigned int level = draw.lodCount != 0 ? selectLod(lods.data() + draw.firstLod, draw.lodCount, glm::vec3(draw.bounds), draw.bounds.w,
+		world, camera.Position, glm::radians(camera.Zoom), static_cast<float>(SCR_HEIGHT), LOD_PIXEL_ERROR) : 0;
+	if (level != 0) {
+		// Coarser levels share the primitive's vertices, only their indices differ
+		const BakedLod& lod = lods[draw.firstLod + level - 1];
+		glDrawRangeElementsBaseVertex(draw.mode, draw.minIndex, draw.maxIndex, lod.indexCount, draw.indexType,
+			reinterpret_cast<void*>(draw.indexOffset + lod.firstIndex * getComponentTypeSize(draw.indexType)), draw.firstVertex);
+	}
+	else if (draw.meshletCount != 0) {
+		// Only the meshlets inside the frustum and facing the camera are drawn, neighbours in one call
+		cullMeshlets(meshlets.data() + draw.firstMeshlet, draw.meshletCount, world, viewProjection, camera.Position, visibleRuns,
+			positionsOnly ? nullptr : &cullStats);
+		const size_t indexSize = getComponentTypeSize(draw.indexType);
+		for (const IndexRun& run : visibleRuns) {
+			glDrawRangeElementsBaseVertex(draw.mode, draw.minIndex, draw.maxIndex, run.indexCount, draw.indexType,
+				reinterpret_cast<void*>(draw.indexOffset + run.firstIndex * indexSize), draw.firstVertex);
+		}
+	}
+	else if (draw.indexed) {
+		// The range tells the driver which vertices the indices can reach without it having to scan them
+		glDrawRangeElementsBaseVertex(draw.mode, draw.minIndex, draw.maxIndex, draw.count, draw.indexType,
+			reinterpret_cast<void*>(draw.indexOffset), draw.firstVertex);
 	}
+	else {
+		glDrawArrays(draw.mode, draw.firstVertex, draw.count);
+	}
+	glBindVertexArray(0);
+}
+
+unsigned int setUpTexture(int image, const BakedImage& pixels, const Sampler& sampler) {
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	if (image >= 0) {
+		if (pixels.pixels) {
+			const GLenum format = pixels.channels == 4 ? GL_RGBA : GL_RGB;
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrapS);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrapT);
+			glTexImage2D(GL_TEXTURE_2D, 0, format, pixels.width, pixels.height, 0, format, GL_UNSIGNED_BYTE, pixels.pixels);
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+		else {
+			std::cout << "failed to load texture" << std::endl;
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return texture;
 }
 
+void setUpBatches(const BakedModel& model) {
+	// Place every primitive in the batch of its layout, there are only ever a few distinct layouts
+	ranges.resize(model.Primitives.size());
+	draws.resize(model.Primitives.size());
+	for (size_t i = 0; i != model.Primitives.size(); ++i) {
+		const BakedPrimitive& primitive = model.Primitives[i];
+		BatchRange& range = ranges[i];
+		range.batch = 0;
+		while (range.batch != batches.size() && !sameVertexLayout(batches[range.batch].layout, primitive)) {
+			++range.batch;
+		}
+		if (range.batch == batches.size()) {
+			batches.emplace_back();
+			batches.back().layout = primitive;
+		}
+		LayoutBatch& batch = batches[range.batch];
+		range.firstVertex = batch.vertexCount;
+		batch.vertexCount += primitive.vertexCount;
+		range.indexOffset = (batch.indexBytes + 3) & ~size_t(3);
+		batch.indexBytes = range.indexOffset + (primitive.indices ? primitive.storedIndexCount() * getComponentTypeSize(primitive.indexType) : 0);
+	}
+
+	// Allocate the buffers of every batch, the meshes fill them in as they are set up
+	for (LayoutBatch& batch : batches) {
+		glGenVertexArrays(1, &batch.VAO);
+		glGenBuffers(1, &batch.VBO);
+		glGenBuffers(1, &batch.EBO);
+		glBindVertexArray(batch.VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, batch.VBO);
+		glBufferData(GL_ARRAY_BUFFER, batch.vertexCount * batch.layout.vertexSize, nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, batch.indexBytes, nullptr, GL_STATIC_DRAW);
+		setUpLayout(batch);
+		if (POSITION_STREAMS) {
+			setUpPositionLayout(batch);
+		}
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// Attributes a primitive lacks are read from the current value instead, glTF draws a missing color as white
+	glVertexAttrib4f(LOCATION_COLOR, 1.0f, 1.0f, 1.0f, 1.0f);
+}
 
-void setUpMesh(Mesh& mesh, glTFloader& loader) {
-	unsigned int i = 0;
-	for (auto& primitive : mesh.primitives) {
-		VAOs.resize(i + 1);
-		VBOs.resize(i + 1);
-		EBOs.resize(i + 1);
-
-		glGenVertexArrays(1, &VAOs[i]);
-		glBindVertexArray(VAOs[i]);
-
-		glGenBuffers(1, &VBOs[i]);
-		glGenBuffers(1, &EBOs[i]);
-
-		std::vector<float> positions;
-		std::vector<float> normals;
-		std::vector<float> colors;
-		std::vector<float> texCoords;
-		std::vector<Vertex> vertices;
-		unsigned int numVertices;
-
-		if (primitive.attributes.count(POSITION)) {
-			Accessor posAccessor = loader.Accessors[primitive.attributes[POSITION]];
-			numVertices = posAccessor.count;
-			std::vector<unsigned char> posData = loader.GetData(posAccessor);
-			size_t elementCount = posAccessor.count * getNumComponents(posAccessor.type);
-			positions.resize(elementCount);
-			memcpy(positions.data(), posData.data(), elementCount * sizeof(float));
+void setUpLayout(LayoutBatch& batch) {
+	// Quantized attributes stay in their integer type and the GPU converts them, normalizing them if the file says so.
+	// Split streams of a batch are each as long as the whole batch.
+	const BakedPrimitive& layout = batch.layout;
+	const bool attribBinding = GLAD_GL_VERSION_4_3 != 0;
+	for (unsigned int location = 0; location != LOCATION_COUNT; ++location) {
+		const BakedAttribute& attribute = layout.attributes[location];
+		if (!attribute.present()) {
+			glDisableVertexAttribArray(location);
+			continue;
 		}
-		if (primitive.attributes.count(NORMAL)) {
-			Accessor normAccessor = loader.Accessors[primitive.attributes[NORMAL]];
-			std::vector<unsigned char> normData = loader.GetData(normAccessor);
-			size_t elementCount = normAccessor.count * getNumComponents(normAccessor.type);
-			normals.resize(elementCount);
-			memcpy(normals.data(), normData.data(), elementCount * getComponentTypeSize(normAccessor.componentType));
+		glEnableVertexAttribArray(location);
+		const GLboolean normalized = attribute.normalized ? GL_TRUE : GL_FALSE;
+		const size_t start = layout.interleaved ? attribute.offset : attribute.offset * batch.vertexCount;
+		if (attribBinding) {
+			// The format is separate from the buffer, interleaved attributes share binding 0
+			const unsigned int binding = layout.interleaved ? 0 : location;
+			glVertexAttribFormat(location, attribute.components, attribute.componentType, normalized, layout.interleaved ? attribute.offset : 0);
+			glVertexAttribBinding(location, binding);
+			glBindVertexBuffer(binding, batch.VBO, layout.interleaved ? 0 : start, layout.attributeStride(location));
 		}
-		if (primitive.attributes.count(TEXCOORD_0)) {
-			Accessor texCoordAccessor = loader.Accessors[primitive.attributes[TEXCOORD_0]];
-			std::vector<unsigned char> texCoordData = loader.GetData(texCoordAccessor);
-			size_t elementCount = texCoordAccessor.count * getNumComponents(texCoordAccessor.type);
-			texCoords.resize(elementCount);
-			memcpy(texCoords.data(), texCoordData.data(), elementCount * getComponentTypeSize(texCoordAccessor.componentType));
+		else {
+			glVertexAttribPointer(location, attribute.components, attribute.componentType, normalized,
+				layout.attributeStride(location), reinterpret_cast<void*>(start));
 		}
-		if (primitive.attributes.count(COLOR_0)) {
-			Accessor colorAccessor = loader.Accessors[primitive.attributes[COLOR_0]];
-			std::vector<unsigned char> colorData = loader.GetData(colorAccessor);
-			size_t elementCount = colorAccessor.count * getNumComponents(colorAccessor.type);
-			colors.resize(elementCount);
-			memcpy(colors.data(), colorData.data(), elementCount * getComponentTypeSize(colorAccessor.componentType));
+	}
+}
+
+void setUpPositionLayout(LayoutBatch& batch) {
+	// Split vertices already hold their positions in one tight stream of the batch buffer, interleaved ones
+	// get a copy of theirs in a buffer of its own. The element buffer is shared with the shading vertex array.
+	const BakedPrimitive& layout = batch.layout;
+	const BakedAttribute& position = layout.attributes[LOCATION_POSITION];
+	if (!position.present()) {
+		return;
+	}
+	glGenVertexArrays(1, &batch.positionVAO);
+	glBindVertexArray(batch.positionVAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.EBO);
+	if (layout.interleaved) {
+		glGenBuffers(1, &batch.positionVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, batch.positionVBO);
+		glBufferData(GL_ARRAY_BUFFER, batch.vertexCount * position.size(), nullptr, GL_STATIC_DRAW);
+	}
+	else {
+		glBindBuffer(GL_ARRAY_BUFFER, batch.VBO);
+	}
+	glEnableVertexAttribArray(LOCATION_POSITION);
+	glVertexAttribPointer(LOCATION_POSITION, position.components, position.componentType, position.normalized ? GL_TRUE : GL_FALSE,
+		position.size(), reinterpret_cast<void*>(layout.interleaved ? 0 : position.offset * batch.vertexCount));
+}
+
+void setUpMesh(const BakedMesh& mesh, const BakedModel& model) {
+	for (unsigned int p = 0; p != mesh.primitiveCount; ++p) {
+		const size_t i = mesh.firstPrimitive + p;
+		const BakedPrimitive& primitive = model.Primitives[i];
+		const BatchRange& range = ranges[i];
+		const LayoutBatch& batch = batches[range.batch];
+
+		// The vertices are already laid out, copy them into their range of the batch as they are
+		glBindVertexArray(batch.VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, batch.VBO);
+		if (primitive.interleaved) {
+			glBufferSubData(GL_ARRAY_BUFFER, range.firstVertex * primitive.vertexSize, primitive.vertexCount * primitive.vertexSize, primitive.vertices);
 		}
-		for (int j = 0; j != numVertices; ++j) {
-			Vertex vertex;
-			if (!positions.empty()) {
-				vertex.Position.x = positions[j * 3 + 0];
-				vertex.Position.y = positions[j * 3 + 1];
-				vertex.Position.z = positions[j * 3 + 2];
-			}
-			if (!normals.empty()) {
-				vertex.Normal.x = normals[j * 3 + 0];
-				vertex.Normal.y = normals[j * 3 + 1];
-				vertex.Normal.z = normals[j * 3 + 2];
-			}
-			if (!colors.empty()) {
-				vertex.Color.x = colors[j * 3 + 0];
-				vertex.Color.y = colors[j * 3 + 1];
-				vertex.Color.z = colors[j * 3 + 2];
-			}
-			if (!texCoords.empty()) {
-				vertex.TexCoord.x = texCoords[j * 2 + 0];
-				vertex.TexCoord.y = texCoords[j * 2 + 1];
+		else {
+			for (unsigned int location = 0; location != LOCATION_COUNT; ++location) {
+				const BakedAttribute& attribute = primitive.attributes[location];
+				if (attribute.present()) {
+					glBufferSubData(GL_ARRAY_BUFFER, attribute.offset * batch.vertexCount + range.firstVertex * attribute.size(),
+						primitive.vertexCount * attribute.size(), primitive.vertices + primitive.attributeOffset(location));
+				}
 			}
-			vertices.push_back(vertex);
 		}
-		glBindBuffer(GL_ARRAY_BUFFER, VBOs[i]);
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Color));
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoord));
+		if (batch.positionVBO != 0) {
+			std::vector<unsigned char> positions(primitive.vertexCount * primitive.attributes[LOCATION_POSITION].size());
+			copyPositions(primitive, positions.data());
+			glBindBuffer(GL_ARRAY_BUFFER, batch.positionVBO);
+			glBufferSubData(GL_ARRAY_BUFFER, range.firstVertex * primitive.attributes[LOCATION_POSITION].size(), positions.size(), positions.data());
+		}
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	    // Indices
 		if (primitive.indices) {
-			Accessor indicesAccessor = loader.Accessors[*(primitive.indices)];
-			indices[i] = loader.GetData(indicesAccessor);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOs[i]);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices[i].size() * getComponentTypeSize(indicesAccessor.componentType), indices[i].data(), GL_STATIC_DRAW);
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, range.indexOffset, primitive.storedIndexCount() * getComponentTypeSize(primitive.indexType), primitive.indices);
 		}
-		// Primitive's type
-		modes[i] = primitive.mode;
-
-		// Texture set up
-		unsigned int texture;
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		if (primitive.material) {
-			unsigned int material = *(primitive.material);
-			Image image = loader.Images[loader.Textures[material].source];
-			Sampler sampler = loader.Samplers[loader.Textures[material].sampler];
-			int width, height, nrChannels;
-			unsigned char* data = stbi_load(image.uri.c_str(), &width, &height, &nrChannels, 0);
-			if (data) {
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrapS);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrapT);
-				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-				glGenerateMipmap(GL_TEXTURE_2D);
-				glBindTexture(GL_TEXTURE_2D, 0);
-
-				stbi_image_free(data);
-			}
-			else {
-				std::cout << "failed to load texture" << std::endl;
-			}
+		glBindVertexArray(0);
+
+		PrimitiveDraw& draw = draws[i];
+		draw.VAO = batch.VAO;
+		draw.positionVAO = batch.positionVAO;
+		draw.mode = primitive.mode;
+		draw.doubleSided = primitive.doubleSided;
+		draw.indexed = primitive.indices != nullptr;
+		draw.indexType = primitive.indexType;
+		draw.minIndex = primitive.minIndex;
+		draw.maxIndex = primitive.maxIndex;
+		draw.count = static_cast<GLsizei>(primitive.indices ? primitive.indexCount : primitive.vertexCount);
+		draw.indexOffset = range.indexOffset;
+		draw.firstVertex = static_cast<GLint>(range.firstVertex);
+		draw.firstMeshlet = meshlets.size();
+		draw.meshletCount = primitive.meshletCount;
+		meshlets.insert(meshlets.end(), primitive.meshlets, primitive.meshlets + primitive.meshletCount);
+		draw.firstLod = lods.size();
+		draw.lodCount = primitive.lodCount;
+		draw.bounds = glm::vec4(primitive.boundsCenter[0], primitive.boundsCenter[1], primitive.boundsCenter[2], primitive.boundsRadius);
+		draw.positionTransform = primitive.positionTransform();
+		lods.insert(lods.end(), primitive.lods, primitive.lods + primitive.lodCount);
+		draw.firstCluster = clusters.size();
+		draw.clusterCount = primitive.clusterCount;
+		clusters.insert(clusters.end(), primitive.clusters, primitive.clusters + primitive.clusterCount);
+
+		// Decoded by the loader or mapped from the cache
+		const BakedImage& image = primitive.image >= 0 && primitive.image < static_cast<int>(model.Images.size()) ? model.Images[primitive.image] : BakedImage();
+		draw.texture = setUpTexture(primitive.image, image, primitive.sampler);
+	}
+}
+void ProcessMesh(const BakedModel& model, LoadProgress& progress) {
+	meshes = model.Meshes;
+	nodes = model.Nodes;
+	setUpBatches(model);
+	progress.AddTotal(LOAD_GPU, model.Meshes.size());
+	for (const BakedMesh& mesh : model.Meshes) {
+		setUpMesh(mesh, model);
+		progress.Advance(LOAD_GPU);
+	}
+}
+
+unsigned int getViewBuffer(const glTFloader& loader, unsigned int bufferView, std::vector<unsigned int>& viewBuffers) {
+	if (bufferView >= viewBuffers.size()) {
+		return 0;
+	}
+	// Every view is uploaded once, the first time an accessor needs it, however many accessors point into it
+	if (viewBuffers[bufferView] == 0) {
+		const unsigned char* data;
+		size_t size;
+		if (!loader.GetBufferViewBytes(bufferView, data, size)) {
+			return 0;
+		}
+		glGenBuffers(1, &viewBuffers[bufferView]);
+		buffers.push_back(viewBuffers[bufferView]);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, viewBuffers[bufferView]);
+		glBufferData(GL_COPY_WRITE_BUFFER, size, data, GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+	return viewBuffers[bufferView];
+}
+
+bool bindAccessor(const glTFloader& loader, unsigned int accessor, std::vector<unsigned int>& viewBuffers,
+	unsigned int& buffer, size_t& offset, size_t& stride, IndexRange* indexRange) {
+	const AccessorView& view = loader.GetView(accessor);
+	if (view.empty()) {
+		return false;
+	}
+	// Most accessors are read where they are, in the buffer of their view
+	const Accessor& source = loader.Accessors[accessor];
+	const bool packed = indexRange != nullptr;
+	if (source.bufferView && !source.sparse && (view.packed() || !packed)) {
+		if (indexRange) {
+			*indexRange = getIndexRange(view.data, view.count, view.componentType);
+		}
+		buffer = getViewBuffer(loader, *source.bufferView, viewBuffers);
+		offset = source.byteOffset;
+		stride = view.stride;
+		return buffer != 0;
+	}
+	// Sparse accessors and accessors without a view only exist expanded in memory, and indices have to be
+	// tightly packed, those get a buffer of their own
+	std::vector<unsigned char> copy;
+	const unsigned char* data = view.data;
+	if (!view.packed()) {
+		copy.resize(view.count * view.elementSize);
+		for (size_t i = 0; i != view.count; ++i) {
+			std::memcpy(copy.data() + i * view.elementSize, view[i], view.elementSize);
+		}
+		data = copy.data();
+	}
+	if (indexRange) {
+		*indexRange = getIndexRange(data, view.count, view.componentType);
+	}
+	glGenBuffers(1, &buffer);
+	buffers.push_back(buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, view.count * view.elementSize, data, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	offset = 0;
+	stride = view.elementSize;
+	return true;
+}
+
+void setUpPrimitive(const Mesh_Primitive& primitive, const glTFloader& loader, std::vector<unsigned int>& viewBuffers) {
+	PrimitiveDraw draw;
+	draw.mode = primitive.mode;
+	draw.doubleSided = isDoubleSided(loader, primitive);
+	glGenVertexArrays(1, &draw.VAO);
+	vertexArrays.push_back(draw.VAO);
+	glBindVertexArray(draw.VAO);
+
+	// Every attribute points into its buffer view in the type the file stores it in, the GPU converts it
+	unsigned int positionBuffer = 0;
+	size_t positionOffset = 0, positionStride = 0;
+	for (unsigned int location = 0; location != LOCATION_COUNT; ++location) {
+		const Attribute semantic = LOCATION_SEMANTICS[location];
+		unsigned int buffer;
+		size_t offset, stride;
+		if (!primitive.has(semantic) || !bindAccessor(loader, primitive.attributes[semantic], viewBuffers, buffer, offset, stride)) {
+			glDisableVertexAttribArray(location);
+			continue;
 		}
-		glBindTexture(GL_TEXTURE_2D, 0);
-		Textures.push_back(texture);
-		vertices_count.push_back(vertices.size());
-		i++;
+		const AccessorView& view = loader.GetView(primitive.attributes[semantic]);
+		const GLint components = static_cast<GLint>(std::min<size_t>(view.numComponents, LOCATION_COMPONENTS[location]));
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, components, view.componentType, view.normalized ? GL_TRUE : GL_FALSE,
+			static_cast<GLsizei>(stride), reinterpret_cast<void*>(offset));
+		if (location == LOCATION_POSITION) {
+			draw.count = static_cast<GLsizei>(view.count);
+			positionBuffer = buffer;
+			positionOffset = offset;
+			positionStride = stride;
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// The element buffer binding is part of the vertex array
+	unsigned int buffer;
+	size_t offset, stride;
+	IndexRange range;
+	if (primitive.indices && bindAccessor(loader, *primitive.indices, viewBuffers, buffer, offset, stride, &range)) {
+		const AccessorView& view = loader.GetView(*primitive.indices);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+		draw.indexed = true;
+		draw.indexType = view.componentType;
+		draw.minIndex = range.min;
+		draw.maxIndex = range.max;
+		draw.count = static_cast<GLsizei>(view.count);
+		draw.indexOffset = offset;
 	}
+	glBindVertexArray(0);
+
+	// Positions only, read where the shading vertex array reads them. The element buffer is shared too.
+	if (POSITION_STREAMS && positionBuffer != 0) {
+		const AccessorView& view = loader.GetView(primitive.attributes[POSITION]);
+		glGenVertexArrays(1, &draw.positionVAO);
+		vertexArrays.push_back(draw.positionVAO);
+		glBindVertexArray(draw.positionVAO);
+		glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+		glEnableVertexAttribArray(LOCATION_POSITION);
+		glVertexAttribPointer(LOCATION_POSITION, static_cast<GLint>(std::min<size_t>(view.numComponents, LOCATION_COMPONENTS[LOCATION_POSITION])),
+			view.componentType, view.normalized ? GL_TRUE : GL_FALSE, static_cast<GLsizei>(positionStride), reinterpret_cast<void*>(positionOffset));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		if (draw.indexed) {
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+		}
+		glBindVertexArray(0);
+	}
+
+	int image = -1;
+	Sampler sampler;
+	getBaseColorTexture(loader, primitive, image, sampler);
+	BakedImage pixels;
+	if (image >= 0) {
+		const ImagePixels& decoded = loader.GetImagePixels(image);
+		pixels.width = decoded.width;
+		pixels.height = decoded.height;
+		pixels.channels = decoded.pixels ? decoded.channels : 0;
+		pixels.pixels = decoded.pixels.get();
+	}
+	draw.texture = setUpTexture(image, pixels, sampler);
+	draws.push_back(draw);
 }
-void ProcessMesh(glTFloader& loader) {
-	for (auto& mesh : loader.Meshes) {
-		setUpMesh(mesh.second, loader);
+
+void ProcessModel(const glTFloader& loader, LoadProgress& progress) {
+	// The loader's meshes map onto contiguous ranges of primitives, like the meshes of a baked model
+	nodes = flattenScene(loader);
+	std::vector<unsigned int> viewBuffers(loader.BufferViews.size(), 0);
+	progress.AddTotal(LOAD_GPU, loader.Meshes.size());
+	for (const Mesh& mesh : loader.Meshes) {
+		BakedMesh range;
+		range.firstPrimitive = static_cast<unsigned int>(draws.size());
+		range.primitiveCount = static_cast<unsigned int>(mesh.primitives.size());
+		meshes.push_back(range);
+		for (const Mesh_Primitive& primitive : mesh.primitives) {
+			setUpPrimitive(primitive, loader, viewBuffers);
+		}
+		progress.Advance(LOAD_GPU);
 	}
+
+	// Attributes a primitive lacks are read from the current value instead, glTF draws a missing color as white
+	glVertexAttrib4f(LOCATION_COLOR, 1.0f, 1.0f, 1.0f, 1.0f);
 }
@@ -0,0 +1,553 @@
+#include "../include/accessor_decode.h"
+#include "../include/cpu_features.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(GLTF_X86)
+#include <immintrin.h>
+#endif
+
+
+// The elements converted per step when the input or output is staged through a packed copy
+const size_t DECODE_BLOCK = 256;
+// The floats converted per step on the way to half floats
+const size_t HALF_BLOCK = 1024;
+
+// Converts n tightly packed components of one type into one format
+typedef void (*ConvertFunction)(const unsigned char* in, size_t n, void* out);
+
+template<typename T>
+static inline T load(const unsigned char* bytes)
+{
+	T value;
+	std::memcpy(&value, bytes, sizeof(T));
+	return value;
+}
+
+// Normalized integers are divided by the largest value of their type, as the glTF specification defines
+template<typename T>
+static inline float normalizer()
+{
+	return static_cast<float>(std::numeric_limits<T>::max());
+}
+
+template<typename T, bool Normalized>
+static void toFloatScalar(const unsigned char* in, size_t n, float* out)
+{
+	for (size_t i = 0; i != n; ++i) {
+		float value = static_cast<float>(load<T>(in + i * sizeof(T)));
+		if constexpr (Normalized) {
+			value /= normalizer<T>();
+			if constexpr (std::is_signed<T>::value) {
+				value = std::max(value, -1.0f);
+			}
+		}
+		out[i] = value;
+	}
+}
+
+template<typename T>
+static void toIntegerScalar(const unsigned char* in, size_t n, uint32_t* out)
+{
+	for (size_t i = 0; i != n; ++i) {
+		if constexpr (std::is_same<T, float>::value) {
+			// Out of range values and NaN become INT32_MIN, as the SIMD conversions do
+			const float value = load<float>(in + i * sizeof(float));
+			const bool inRange = value > -2147483904.0f && value < 2147483648.0f;
+			out[i] = inRange ? static_cast<uint32_t>(static_cast<int32_t>(value)) : 0x80000000u;
+		}
+		else {
+			out[i] = static_cast<uint32_t>(load<T>(in + i * sizeof(T)));
+		}
+	}
+}
+
+// Round a float to the nearest half float, ties to even, keeping subnormals
+static inline uint16_t toHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	const uint32_t sign = bits & 0x80000000u;
+	bits ^= sign;
+
+	uint32_t half;
+	if (bits >= (127u + 16) << 23) {
+		// Too large for a half, or infinity or NaN already
+		half = bits > 0x7F800000u ? 0x7E00 : 0x7C00;
+	}
+	else if (bits < (127u - 14) << 23) {
+		// A subnormal half: adding the magic value lines the 10 mantissa bits up at the bottom and rounds them
+		const uint32_t magicBits = (127u - 15 + 23 - 10 + 1) << 23;
+		float magic;
+		std::memcpy(&magic, &magicBits, sizeof(magic));
+		float shifted;
+		std::memcpy(&shifted, &bits, sizeof(shifted));
+		shifted += magic;
+		std::memcpy(&half, &shifted, sizeof(half));
+		half -= magicBits;
+	}
+	else {
+		// Rebias the exponent and round the 13 dropped mantissa bits to even
+		const uint32_t odd = (bits >> 13) & 1;
+		half = (bits + ((15u - 127) << 23) + 0xFFF + odd) >> 13;
+	}
+	return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+static void toHalfScalar(const unsigned char* in, size_t n, uint16_t* out)
+{
+	for (size_t i = 0; i != n; ++i) {
+		out[i] = toHalf(load<float>(in + i * sizeof(float)));
+	}
+}
+
+#if defined(GLTF_X86)
+
+// Four components widened to 32-bit lanes
+template<typename T>
+GLTF_TARGET("sse4.1")
+static inline __m128i widen4(const unsigned char* in)
+{
+	if constexpr (sizeof(T) == 1) {
+		const __m128i bytes = _mm_cvtsi32_si128(load<int32_t>(in));
+		if constexpr (std::is_signed<T>::value) {
+			return _mm_cvtepi8_epi32(bytes);
+		}
+		else {
+			return _mm_cvtepu8_epi32(bytes);
+		}
+	}
+	else if constexpr (sizeof(T) == 2) {
+		const __m128i shorts = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in));
+		if constexpr (std::is_signed<T>::value) {
+			return _mm_cvtepi16_epi32(shorts);
+		}
+		else {
+			return _mm_cvtepu16_epi32(shorts);
+		}
+	}
+	else {
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+	}
+}
+
+// Unsigned 32-bit lanes are converted in two exact halves, so only their sum rounds
+template<typename T>
+GLTF_TARGET("sse4.1")
+static inline __m128 toFloat4(__m128i lanes)
+{
+	if constexpr (std::is_same<T, uint32_t>::value) {
+		const __m128 high = _mm_cvtepi32_ps(_mm_srli_epi32(lanes, 16));
+		const __m128 low = _mm_cvtepi32_ps(_mm_and_si128(lanes, _mm_set1_epi32(0xFFFF)));
+		return _mm_add_ps(_mm_mul_ps(high, _mm_set1_ps(65536.0f)), low);
+	}
+	else {
+		return _mm_cvtepi32_ps(lanes);
+	}
+}
+
+template<typename T, bool Normalized>
+GLTF_TARGET("sse4.1")
+static size_t toFloatSSE41(const unsigned char* in, size_t n, float* out)
+{
+	const __m128 divisor = _mm_set1_ps(normalizer<T>());
+	const __m128 minusOne = _mm_set1_ps(-1.0f);
+	size_t done = 0;
+	for (; done + 4 <= n; done += 4) {
+		__m128 values = toFloat4<T>(widen4<T>(in + done * sizeof(T)));
+		if constexpr (Normalized) {
+			values = _mm_div_ps(values, divisor);
+			if constexpr (std::is_signed<T>::value) {
+				values = _mm_max_ps(values, minusOne);
+			}
+		}
+		_mm_storeu_ps(out + done, values);
+	}
+	return done;
+}
+
+template<typename T>
+GLTF_TARGET("sse4.1")
+static size_t toIntegerSSE41(const unsigned char* in, size_t n, uint32_t* out)
+{
+	size_t done = 0;
+	for (; done + 4 <= n; done += 4) {
+		__m128i values;
+		if constexpr (std::is_same<T, float>::value) {
+			values = _mm_cvttps_epi32(_mm_loadu_ps(reinterpret_cast<const float*>(in + done * sizeof(float))));
+		}
+		else {
+			values = widen4<T>(in + done * sizeof(T));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + done), values);
+	}
+	return done;
+}
+
+// Eight components widened to 32-bit lanes
+template<typename T>
+GLTF_TARGET("avx2")
+static inline __m256i widen8(const unsigned char* in)
+{
+	if constexpr (sizeof(T) == 1) {
+		const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in));
+		if constexpr (std::is_signed<T>::value) {
+			return _mm256_cvtepi8_epi32(bytes);
+		}
+		else {
+			return _mm256_cvtepu8_epi32(bytes);
+		}
+	}
+	else if constexpr (sizeof(T) == 2) {
+		const __m128i shorts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+		if constexpr (std::is_signed<T>::value) {
+			return _mm256_cvtepi16_epi32(shorts);
+		}
+		else {
+			return _mm256_cvtepu16_epi32(shorts);
+		}
+	}
+	else {
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+	}
+}
+
+template<typename T>
+GLTF_TARGET("avx2")
+static inline __m256 toFloat8(__m256i lanes)
+{
+	if constexpr (std::is_same<T, uint32_t>::value) {
+		const __m256 high = _mm256_cvtepi32_ps(_mm256_srli_epi32(lanes, 16));
+		const __m256 low = _mm256_cvtepi32_ps(_mm256_and_si256(lanes, _mm256_set1_epi32(0xFFFF)));
+		return _mm256_add_ps(_mm256_mul_ps(high, _mm256_set1_ps(65536.0f)), low);
+	}
+	else {
+		return _mm256_cvtepi32_ps(lanes);
+	}
+}
+
+template<typename T, bool Normalized>
+GLTF_TARGET("avx2")
+static size_t toFloatAVX2(const unsigned char* in, size_t n, float* out)
+{
+	const __m256 divisor = _mm256_set1_ps(normalizer<T>());
+	const __m256 minusOne = _mm256_set1_ps(-1.0f);
+	size_t done = 0;
+	for (; done + 8 <= n; done += 8) {
+		__m256 values = toFloat8<T>(widen8<T>(in + done * sizeof(T)));
+		if constexpr (Normalized) {
+			values = _mm256_div_ps(values, divisor);
+			if constexpr (std::is_signed<T>::value) {
+				values = _mm256_max_ps(values, minusOne);
+			}
+		}
+		_mm256_storeu_ps(out + done, values);
+	}
+	return done;
+}
+
+template<typename T>
+GLTF_TARGET("avx2")
+static size_t toIntegerAVX2(const unsigned char* in, size_t n, uint32_t* out)
+{
+	size_t done = 0;
+	for (; done + 8 <= n; done += 8) {
+		__m256i values;
+		if constexpr (std::is_same<T, float>::value) {
+			values = _mm256_cvttps_epi32(_mm256_loadu_ps(reinterpret_cast<const float*>(in + done * sizeof(float))));
+		}
+		else {
+			values = widen8<T>(in + done * sizeof(T));
+		}
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + done), values);
+	}
+	return done;
+}
+
+GLTF_TARGET("avx,f16c")
+static size_t toHalfF16C(const unsigned char* in, size_t n, uint16_t* out)
+{
+	size_t done = 0;
+	for (; done + 8 <= n; done += 8) {
+		const __m256 values = _mm256_loadu_ps(reinterpret_cast<const float*>(in + done * sizeof(float)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + done), _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT));
+	}
+	return done;
+}
+
+// Sixteen components widened to 32-bit lanes
+template<typename T>
+GLTF_TARGET("avx512f")
+static inline __m512i widen16(const unsigned char* in)
+{
+	if constexpr (sizeof(T) == 1) {
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+		if constexpr (std::is_signed<T>::value) {
+			return _mm512_cvtepi8_epi32(bytes);
+		}
+		else {
+			return _mm512_cvtepu8_epi32(bytes);
+		}
+	}
+	else if constexpr (sizeof(T) == 2) {
+		const __m256i shorts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+		if constexpr (std::is_signed<T>::value) {
+			return _mm512_cvtepi16_epi32(shorts);
+		}
+		else {
+			return _mm512_cvtepu16_epi32(shorts);
+		}
+	}
+	else {
+		return _mm512_loadu_si512(in);
+	}
+}
+
+template<typename T, bool Normalized>
+GLTF_TARGET("avx512f")
+static size_t toFloatAVX512(const unsigned char* in, size_t n, float* out)
+{
+	const __m512 divisor = _mm512_set1_ps(normalizer<T>());
+	const __m512 minusOne = _mm512_set1_ps(-1.0f);
+	size_t done = 0;
+	for (; done + 16 <= n; done += 16) {
+		const __m512i lanes = widen16<T>(in + done * sizeof(T));
+		__m512 values;
+		if constexpr (std::is_same<T, uint32_t>::value) {
+			values = _mm512_cvtepu32_ps(lanes);
+		}
+		else {
+			values = _mm512_cvtepi32_ps(lanes);
+		}
+		if constexpr (Normalized) {
+			values = _mm512_div_ps(values, divisor);
+			if constexpr (std::is_signed<T>::value) {
+				values = _mm512_max_ps(values, minusOne);
+			}
+		}
+		_mm512_storeu_ps(out + done, values);
+	}
+	return done;
+}
+
+template<typename T>
+GLTF_TARGET("avx512f")
+static size_t toIntegerAVX512(const unsigned char* in, size_t n, uint32_t* out)
+{
+	size_t done = 0;
+	for (; done + 16 <= n; done += 16) {
+		__m512i values;
+		if constexpr (std::is_same<T, float>::value) {
+			values = _mm512_cvttps_epi32(_mm512_loadu_ps(in + done * sizeof(float)));
+		}
+		else {
+			values = widen16<T>(in + done * sizeof(T));
+		}
+		_mm512_storeu_si512(out + done, values);
+	}
+	return done;
+}
+
+GLTF_TARGET("avx512f")
+static size_t toHalfAVX512(const unsigned char* in, size_t n, uint16_t* out)
+{
+	size_t done = 0;
+	for (; done + 16 <= n; done += 16) {
+		const __m512 values = _mm512_loadu_ps(in + done * sizeof(float));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + done), _mm512_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT));
+	}
+	return done;
+}
+
+#endif
+
+// Convert packed components to float with the widest kernels the CPU supports, the scalar loop takes the rest
+template<typename T, bool Normalized>
+static void toFloat(const unsigned char* in, size_t n, float* out)
+{
+	size_t done = 0;
+#if defined(GLTF_X86)
+	const CpuFeatures& features = getCpuFeatures();
+	if (features.avx512) {
+		done = toFloatAVX512<T, Normalized>(in, n, out);
+	}
+	if (features.avx2) {
+		done += toFloatAVX2<T, Normalized>(in + done * sizeof(T), n - done, out + done);
+	}
+	if (features.sse41) {
+		done += toFloatSSE41<T, Normalized>(in + done * sizeof(T), n - done, out + done);
+	}
+#endif
+	toFloatScalar<T, Normalized>(in + done * sizeof(T), n - done, out + done);
+}
+
+template<typename T>
+static void toInteger(const unsigned char* in, size_t n, uint32_t* out)
+{
+	size_t done = 0;
+#if defined(GLTF_X86)
+	const CpuFeatures& features = getCpuFeatures();
+	if (features.avx512) {
+		done = toIntegerAVX512<T>(in, n, out);
+	}
+	if (features.avx2) {
+		done += toIntegerAVX2<T>(in + done * sizeof(T), n - done, out + done);
+	}
+	if (features.sse41) {
+		done += toIntegerSSE41<T>(in + done * sizeof(T), n - done, out + done);
+	}
+#endif
+	toIntegerScalar<T>(in + done * sizeof(T), n - done, out + done);
+}
+
+static void toHalf(const unsigned char* in, size_t n, uint16_t* out)
+{
+	size_t done = 0;
+#if defined(GLTF_X86)
+	const CpuFeatures& features = getCpuFeatures();
+	if (features.avx512) {
+		done = toHalfAVX512(in, n, out);
+	}
+	if (features.f16c) {
+		done += toHalfF16C(in + done * sizeof(float), n - done, out + done);
+	}
+#endif
+	toHalfScalar(in + done * sizeof(float), n - done, out + done);
+}
+
+template<typename T, bool Normalized, DecodeFormat Format>
+static void convert(const unsigned char* in, size_t n, void* out)
+{
+	if constexpr (Format == DECODE_FLOAT) {
+		if constexpr (std::is_same<T, float>::value) {
+			std::memcpy(out, in, n * sizeof(float));
+		}
+		else {
+			toFloat<T, Normalized>(in, n, static_cast<float*>(out));
+		}
+	}
+	else if constexpr (Format == DECODE_HALF) {
+		uint16_t* halves = static_cast<uint16_t*>(out);
+		if constexpr (std::is_same<T, float>::value) {
+			toHalf(in, n, halves);
+		}
+		else {
+			// Through a float block small enough to stay in the cache
+			float block[HALF_BLOCK];
+			for (size_t first = 0; first < n; first += HALF_BLOCK) {
+				const size_t count = std::min(HALF_BLOCK, n - first);
+				toFloat<T, Normalized>(in + first * sizeof(T), count, block);
+				toHalf(reinterpret_cast<const unsigned char*>(block), count, halves + first);
+			}
+		}
+	}
+	else {
+		if constexpr (sizeof(T) == sizeof(uint32_t) && !std::is_same<T, float>::value) {
+			std::memcpy(out, in, n * sizeof(uint32_t));
+		}
+		else {
+			toInteger<T>(in, n, static_cast<uint32_t*>(out));
+		}
+	}
+}
+
+template<typename T>
+static ConvertFunction selectConversion(bool normalized, DecodeFormat format)
+{
+	// Floats are never normalized
+	normalized = normalized && !std::is_same<T, float>::value;
+	switch (format) {
+	case DECODE_FLOAT:   return normalized ? convert<T, true, DECODE_FLOAT> : convert<T, false, DECODE_FLOAT>;
+	case DECODE_HALF:    return normalized ? convert<T, true, DECODE_HALF> : convert<T, false, DECODE_HALF>;
+	case DECODE_INTEGER: return convert<T, false, DECODE_INTEGER>;
+	default:             return nullptr;
+	}
+}
+
+static ConvertFunction selectConversion(GLenum componentType, bool normalized, DecodeFormat format)
+{
+	switch (componentType) {
+	case GL_BYTE:           return selectConversion<int8_t>(normalized, format);
+	case GL_UNSIGNED_BYTE:  return selectConversion<uint8_t>(normalized, format);
+	case GL_SHORT:          return selectConversion<int16_t>(normalized, format);
+	case GL_UNSIGNED_SHORT: return selectConversion<uint16_t>(normalized, format);
+	case GL_INT:            return selectConversion<int32_t>(normalized, format);
+	case GL_UNSIGNED_INT:   return selectConversion<uint32_t>(normalized, format);
+	case GL_FLOAT:          return selectConversion<float>(normalized, format);
+	default:                return nullptr;
+	}
+}
+
+
+bool decodeAccessor(const AccessorView& view, DecodeFormat format, void* out, size_t components, size_t outStride)
+{
+	const ConvertFunction convert = selectConversion(view.componentType, view.normalized, format);
+	const size_t componentSize = getComponentTypeSize(view.componentType);
+	if (convert == nullptr || view.numComponents == 0) {
+		return false;
+	}
+	if (components == 0 || components > view.numComponents) {
+		components = view.numComponents;
+	}
+	const size_t outSize = getDecodeFormatSize(format);
+	const size_t outElementSize = components * outSize;
+	if (outStride == 0) {
+		outStride = outElementSize;
+	}
+	if (view.empty()) {
+		return true;
+	}
+	unsigned char* destination = static_cast<unsigned char*>(out);
+
+	// The columns of MAT2 and MAT3 with 1 or 2 byte components are padded to 4 bytes, decode them one by one
+	if (view.elementSize != view.numComponents * componentSize) {
+		const size_t rows = view.numComponents == 4 ? 2 : 3;
+		const size_t columnSize = (rows * componentSize + 3) & ~size_t(3);
+		for (size_t column = 0; column * rows < components; ++column) {
+			AccessorView columnView = view;
+			columnView.data = view.data + column * columnSize;
+			columnView.numComponents = rows;
+			columnView.elementSize = rows * componentSize;
+			const size_t columnComponents = std::min(rows, components - column * rows);
+			decodeAccessor(columnView, format, destination + column * rows * outSize, columnComponents, outStride);
+		}
+		return true;
+	}
+
+	// One pass over the whole stream when both sides are tightly packed
+	const size_t inElementSize = components * componentSize;
+	const bool packedIn = view.stride == inElementSize;
+	const bool packedOut = outStride == outElementSize;
+	if (packedIn && packedOut) {
+		convert(view.data, view.count * components, destination);
+		return true;
+	}
+
+	// Otherwise gather and scatter blocks of elements through packed copies, so the kernels always see contiguous components
+	unsigned char input[DECODE_BLOCK * MAX_COMPONENTS * sizeof(uint32_t)];
+	unsigned char output[DECODE_BLOCK * MAX_COMPONENTS * sizeof(uint32_t)];
+	for (size_t first = 0; first < view.count; first += DECODE_BLOCK) {
+		const size_t count = std::min(DECODE_BLOCK, view.count - first);
+
+		const unsigned char* source = view[first];
+		if (!packedIn) {
+			for (size_t i = 0; i != count; ++i) {
+				std::memcpy(input + i * inElementSize, source + i * view.stride, inElementSize);
+			}
+			source = input;
+		}
+
+		unsigned char* target = packedOut ? destination + first * outStride : output;
+		convert(source, count * components, target);
+
+		if (!packedOut) {
+			for (size_t i = 0; i != count; ++i) {
+				std::memcpy(destination + (first + i) * outStride, output + i * outElementSize, outElementSize);
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,40 @@
+#include "../include/async_loader.h"
+
+
+LoadHandle<glTFloader> LoadModelAsync(const std::string& modelPath, const std::string& directory, LoaderOptions options)
+{
+	if (!options.progress) {
+		options.progress = std::make_shared<LoadProgress>();
+	}
+	std::shared_ptr<LoadProgress> progress = options.progress;
+
+	// The future of std::async waits for the load when the last handle goes away, so no thread outlives it
+	std::shared_future<std::shared_ptr<glTFloader>> model = std::async(std::launch::async, [modelPath, directory, options]() {
+		std::shared_ptr<glTFloader> loader = std::make_shared<glTFloader>(modelPath, directory, options);
+		if (options.progress->Cancelled()) {
+			loader.reset();
+		}
+		return loader;
+	}).share();
+
+	return LoadHandle<glTFloader>(std::move(model), std::move(progress));
+}
+
+LoadHandle<BakedModel> LoadBakedModelAsync(const std::string& modelPath, const std::string& directory, const std::string& cachePath,
+	LoaderOptions options, const CacheOptions& cacheOptions, const BakeOptions& bakeOptions)
+{
+	if (!options.progress) {
+		options.progress = std::make_shared<LoadProgress>();
+	}
+	std::shared_ptr<LoadProgress> progress = options.progress;
+
+	std::shared_future<std::shared_ptr<BakedModel>> model = std::async(std::launch::async, [modelPath, directory, cachePath, options, cacheOptions, bakeOptions]() {
+		std::shared_ptr<BakedModel> baked = std::make_shared<BakedModel>();
+		if (!LoadBakedModel(modelPath, directory, cachePath, *baked, options, cacheOptions, bakeOptions) || options.progress->Cancelled()) {
+			baked.reset();
+		}
+		return baked;
+	}).share();
+
+	return LoadHandle<BakedModel>(std::move(model), std::move(progress));
+}
@@ -0,0 +1,1547 @@
+#include "../include/baked_model.h"
+#include "../include/accessor_decode.h"
+#include "../include/base64.h"
+#include "../include/hash.h"
+#include "../include/index_buffer.h"
+#include "../include/lz4_block.h"
+#include "../include/mesh_optimize.h"
+#include "../include/meshlet.h"
+#include "../include/thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+
+
+// "GLTB"
+const uint32_t BAKED_MAGIC = 0x42544C47;
+// Every section starts at a multiple of this, so its records can be read in place
+const size_t SECTION_ALIGNMENT = 16;
+
+// The sections of a cache file, always all present and in this order
+enum BakedSection : uint32_t {
+	SECTION_DEPENDENCIES,  // The dependency paths, each followed by a 0, never compressed
+	SECTION_MESHES,        // BakedMesh records
+	SECTION_PRIMITIVES,    // FilePrimitive records
+	SECTION_VERTICES,      // The interleaved vertices of every primitive, each starting at a multiple of 4 bytes
+	SECTION_INDICES,       // The index stream of every primitive, each starting at a multiple of 4 bytes
+	SECTION_IMAGES,        // FileImage records
+	SECTION_PIXELS,        // The pixels of every image
+	SECTION_NODES,         // FileNode records
+	SECTION_MESHLETS,      // The Meshlet records of every primitive
+	SECTION_LODS,          // The BakedLod records of every primitive
+	SECTION_CLUSTERS,      // The ClusterLod records of every primitive
+	SECTION_COUNT
+};
+
+// The first bytes of a cache file, followed by the section table
+struct FileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceHash;    // The hash of the sources the cache was built from
+	uint64_t optionsHash;   // The hash of the BakeOptions the cache was built with
+	uint32_t sectionCount;
+	uint32_t reserved;
+};
+
+struct FileSection {
+	uint32_t type;
+	uint32_t compressed;    // Whether the section is an LZ4 block
+	uint64_t offset;        // Where the section starts in the file
+	uint64_t size;          // The size of the section in the file
+	uint64_t rawSize;       // The size of the section once decompressed
+};
+
+// A BakedPrimitive with its pointers stored as offsets into the stream sections
+struct FilePrimitive {
+	uint64_t vertexOffset;
+	uint64_t vertexCount;
+	uint32_t vertexSize;
+	uint32_t interleaved;
+	BakedAttribute attributes[LOCATION_COUNT];
+	uint64_t indexOffset;
+	uint64_t indexCount;
+	uint32_t indexType;
+	uint32_t minIndex;
+	uint32_t maxIndex;
+	uint32_t mode;
+	int32_t image;
+	uint32_t hasIndices;
+	int32_t magFilter;
+	int32_t minFilter;
+	int32_t wrapS;
+	int32_t wrapT;
+	uint32_t doubleSided;
+	uint64_t meshletOffset; // The first of the primitive's records in the meshlet section
+	uint64_t meshletCount;
+	uint64_t lodOffset;     // The first of the primitive's records in the level section
+	uint64_t lodCount;
+	uint64_t clusterOffset; // The first of the primitive's records in the cluster section
+	uint64_t clusterCount;
+	uint64_t clusterIndexCount;
+	float boundsCenter[3];
+	float boundsRadius;
+	float positionOffset[3];
+	float positionScale[3];
+};
+
+struct FileImage {
+	int32_t width;
+	int32_t height;
+	int32_t channels;
+	int32_t reserved;
+	uint64_t pixelOffset;
+	uint64_t pixelSize;
+};
+
+struct FileNode {
+	int32_t mesh;
+	int32_t parent;
+	float world[16];
+};
+
+static_assert(sizeof(BakedAttribute) == 8, "BakedAttribute is stored without padding");
+static_assert(sizeof(BakedMesh) == 2 * sizeof(unsigned int), "BakedMesh is stored without padding");
+static_assert(sizeof(Meshlet) == 10 * sizeof(uint32_t), "Meshlet is stored without padding");
+static_assert(sizeof(BakedLod) == 3 * sizeof(uint32_t), "BakedLod is stored without padding");
+static_assert(sizeof(ClusterLod) == 12 * sizeof(uint32_t), "ClusterLod is stored without padding");
+
+static void append(std::vector<unsigned char>& section, const void* data, size_t size)
+{
+	if (size != 0) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		section.insert(section.end(), bytes, bytes + size);
+	}
+}
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// Read the records of a section, fails if the section is not a whole number of them
+template<typename T>
+static bool readRecords(const unsigned char* data, size_t size, std::vector<T>& records)
+{
+	if (size % sizeof(T) != 0) {
+		return false;
+	}
+	records.resize(size / sizeof(T));
+	if (size != 0) {
+		std::memcpy(records.data(), data, size);
+	}
+	return true;
+}
+
+// Whether the vertex shader can read components of this type straight from the vertex buffer
+static bool isQuantizedType(GLenum componentType)
+{
+	return componentType == GL_BYTE || componentType == GL_UNSIGNED_BYTE ||
+		componentType == GL_SHORT || componentType == GL_UNSIGNED_SHORT;
+}
+
+// Lay out the attributes a primitive has, each value starting on a 4 byte boundary. Attributes the primitive
+// lacks take no space, the shader reads their default instead. Returns the bytes one vertex takes.
+static unsigned int layoutVertex(const AccessorView* const* views, const BakeOptions& options, BakedAttribute* attributes)
+{
+	unsigned int offset = 0;
+	for (unsigned int location = 0; location != LOCATION_COUNT; ++location) {
+		const AccessorView& view = *views[location];
+		BakedAttribute& attribute = attributes[location];
+		attribute = BakedAttribute();
+		if (view.empty()) {
+			continue;
+		}
+		attribute.components = static_cast<uint8_t>(std::min<size_t>(view.numComponents, LOCATION_COMPONENTS[location]));
+		if (options.keepQuantized && isQuantizedType(view.componentType)) {
+			attribute.componentType = view.componentType;
+			attribute.normalized = view.normalized;
+		}
+		attribute.offset = static_cast<uint16_t>(offset);
+		offset += attribute.size();
+	}
+	return offset;
+}
+
+// Write up to count elements of an attribute into its place in a primitive's vertices, in the attribute's layout
+static void interleave(const AccessorView& attribute, size_t count, const BakedAttribute& layout, unsigned char* member, size_t stride)
+{
+	AccessorView view = attribute;
+	view.count = std::min(view.count, count);
+	if (layout.componentType == GL_FLOAT) {
+		decodeAccessor(view, DECODE_FLOAT, member, layout.components, stride);
+		return;
+	}
+	// Quantized components are copied as they are, the GPU converts them when it fetches the vertex
+	const size_t size = std::min<size_t>(layout.components, view.numComponents) * getComponentTypeSize(layout.componentType);
+	for (size_t i = 0; i != view.count; ++i) {
+		std::memcpy(member + i * stride, view[i], size);
+	}
+}
+
+// The hash a cache is keyed by alongside its sources
+static uint64_t hashBakeOptions(const BakeOptions& options)
+{
+	const uint8_t settings[] = { options.keepQuantized, options.interleaveVertices, options.narrowIndices, options.splitLargeMeshes,
+		options.optimizeVertexCache, options.optimizeOverdraw, options.weldVertices, options.buildMeshlets,
+		options.buildClusterLod, options.quantizePositions, options.encodeNormals, options.halfTexcoords };
+	const float thresholds[] = { options.overdrawThreshold, options.weldPositionTolerance, options.weldNormalTolerance,
+		options.lodRatio, options.lodMaxError, options.texcoordTolerance };
+	const uint32_t counts[] = { options.lodLevels, options.normalBits };
+	return hash64(counts, sizeof(counts), hash64(thresholds, sizeof(thresholds), hash64(settings, sizeof(settings), BAKED_MODEL_VERSION)));
+}
+
+// Copy vertices of one primitive into another of the same layout, vertex j of out is vertex order[j] of source
+static void gatherVertices(const BakedPrimitive& from, const unsigned char* source, const uint32_t* order,
+	const BakedPrimitive& to, unsigned char* out)
+{
+	for (unsigned int location = 0; location != LOCATION_COUNT; ++location) {
+		if (!to.attributes[location].present()) {
+			continue;
+		}
+		const size_t size = to.attributes[location].size();
+		const unsigned char* read = source + from.attributeOffset(location);
+		unsigned char* write = out + to.attributeOffset(location);
+		for (size_t j = 0; j != to.vertexCount; ++j) {
+			std::memcpy(write + j * to.attributeStride(location), read + order[j] * from.attributeStride(location), size);
+		}
+	}
+}
+
+// Replace a primitive whose streams were just written at the ends of the streams by one primitive per chunk
+static void splitPrimitive(const BakedPrimitive& whole, const std::vector<IndexChunk>& chunks, std::vector<unsigned char>& vertices,
+	std::vector<unsigned char>& indices, std::vector<size_t>& vertexOffsets, std::vector<size_t>& indexOffsets, std::vector<BakedPrimitive>& primitives)
+{
+	const std::vector<unsigned char> source(vertices.begin() + vertexOffsets.back(), vertices.end());
+	vertices.resize(vertexOffsets.back());
+	indices.resize(indexOffsets.back());
+	vertexOffsets.pop_back();
+	indexOffsets.pop_back();
+
+	for (const IndexChunk& chunk : chunks) {
+		BakedPrimitive part = whole;
+		part.vertexCount = chunk.vertices.size();
+		vertexOffsets.push_back(vertices.size());
+		vertices.resize(vertices.size() + part.vertexCount * part.vertexSize, 0);
+		gatherVertices(whole, source.data(), chunk.vertices.data(), part, vertices.data() + vertexOffsets.back());
+
+		indices.resize(alignUp(indices.size(), 4));
+		indexOffsets.push_back(indices.size());
+		append(indices, chunk.indices.data(), chunk.indices.size() * sizeof(uint16_t));
+		part.indexCount = chunk.indices.size();
+		part.indexType = GL_UNSIGNED_SHORT;
+		// Every vertex of a chunk is used, in order of first use
+		part.minIndex = 0;
+		part.maxIndex = static_cast<uint32_t>(chunk.vertices.size() - 1);
+		primitives.push_back(part);
+	}
+}
+
+// A primitive drawn without indices rebuilt from its distinct vertices
+struct WeldedPrimitive {
+	size_t vertexCount = 0;
+	std::vector<unsigned char> vertices;     // The distinct vertices in the primitive's layout
+	std::vector<uint32_t> indices;           // The distinct vertex of every original vertex
+};
+
+// Find the distinct vertices of a primitive, comparing the values as baked
+static void weldPrimitive(const BakedPrimitive& primitive, const unsigned char* vertexData, const BakeOptions& options, WeldedPrimitive& welded)
+{
+	WeldAttribute attributes[LOCATION_COUNT];
+	size_t attributeCount = 0;
+	for (unsigned int location = 0; location != LOCATION_COUNT; ++location) {
+		const BakedAttribute& attribute = primitive.attributes[location];
+		if (!attribute.present()) {
+			continue;
+		}
+		WeldAttribute& weld = attributes[attributeCount++];
+		weld.data = vertexData + primitive.attributeOffset(location);
+		weld.stride = primitive.attributeStride(location);
+		weld.size = attribute.size();
+		// Quantized values already sit on a grid, they are compared exactly
+		if (attribute.componentType == GL_FLOAT) {
+			weld.tolerance = location == LOCATION_POSITION ? options.weldPositionTolerance :
+				location == LOCATION_NORMAL ? options.weldNormalTolerance : 0.0f;
+		}
+	}
+	std::vector<uint32_t> unique;
+	welded.vertexCount = weldVertices(attributes, attributeCount, primitive.vertexCount, welded.indices, unique);
+
+	BakedPrimitive layout = primitive;
+	layout.vertexCount = welded.vertexCount;
+	welded.vertices.resize(layout.vertexCount * layout.vertexSize);
+	gatherVertices(primitive, vertexData, unique.data(), layout, welded.vertices.data());
+}
+
+// One attribute of a primitive's vertices as an accessor would see it
+static AccessorView attributeView(const BakedPrimitive& primitive, const unsigned char* vertexData, unsigned int location)
+{
+	const BakedAttribute& attribute = primitive.attributes[location];
+	AccessorView view;
+	view.data = vertexData + primitive.attributeOffset(location);
+	view.count = primitive.vertexCount;
+	view.stride = primitive.attributeStride(location);
+	view.numComponents = attribute.components;
+	view.componentType = attribute.componentType;
+	view.normalized = attribute.normalized != 0;
+	view.elementSize = attribute.components * getComponentTypeSize(attribute.componentType);
+	return view;
+}
+
+// An attribute of a primitive as components floats per vertex, whatever type it is stored in. Components the
+// attribute lacks are 0.
+static std::vector<float> decodeAttribute(const BakedPrimitive& primitive, const unsigned char* vertexData, unsigned int location,
+	unsigned int components = 3)
+{
+	std::vector<float> values(primitive.vertexCount * components, 0.0f);
+	decodeAccessor(attributeView(primitive, vertexData, location), DECODE_FLOAT, values.data(), components, components * sizeof(float));
+	return values;
+}
+
+// Reorder the triangles of an indexed triangle list for the post-transform cache and, if asked, against overdraw,
+// then its vertices in the order the triangles use them. Both streams are rewritten in place.
+static void optimizePrimitive(BakedPrimitive& primitive, unsigned char* vertexData, unsigned char* indexData,
+	const BakeOptions& options, BakeReport& report)
+{
+	std::vector<uint32_t> order(primitive.indexCount);
+	readIndices(indexData, primitive.indexCount, primitive.indexType, order.data());
+	report.vertexCacheBefore = analyzeVertexCache(order.data(), order.size(), primitive.vertexCount);
+	const bool overdraw = options.optimizeOverdraw && primitive.attributes[LOCATION_POSITION].present();
+	std::vector<float> positions;
+	if (overdraw) {
+		positions = decodeAttribute(primitive, vertexData, LOCATION_POSITION);
+		report.overdrawBefore = analyzeOverdraw(order.data(), order.size(), positions.data(), primitive.vertexCount);
+	}
+
+	// An order that already suits the cache is kept when the reordered one would shade as many vertices or more
+	const std::vector<uint32_t> stored = order;
+	optimizeVertexCache(order.data(), order.size(), primitive.vertexCount);
+	if (analyzeVertexCache(order.data(), order.size(), primitive.vertexCount).transforms >= report.vertexCacheBefore.transforms) {
+		order = stored;
+		report.storedOrderKept = 1;
+	}
+	if (overdraw) {
+		optimizeOverdraw(order.data(), order.size(), positions.data(), primitive.vertexCount, options.overdrawThreshold);
+		report.overdrawAfter = analyzeOverdraw(order.data(), order.size(), positions.data(), primitive.vertexCount);
+	}
+	std::vector<uint32_t> remap;
+	const size_t used = optimizeVertexFetch(order.data(), order.size(), primitive.vertexCount, remap);
+	report.vertexCacheAfter = analyzeVertexCache(order.data(), order.size(), primitive.vertexCount);
+	// Renumbering only lowers the largest index, the indices still fit their type
+	writeIndices(order.data(), order.size(), primitive.indexType, indexData);
+	primitive.minIndex = 0;
+	primitive.maxIndex = static_cast<uint32_t>(used - 1);
+
+	std::vector<uint32_t> source(primitive.vertexCount);
+	for (size_t vertex = 0; vertex != remap.size(); ++vertex) {
+		source[remap[vertex]] = static_cast<uint32_t>(vertex);
+	}
+	const std::vector<unsigned char> copy(vertexData, vertexData + primitive.vertexCount * primitive.vertexSize);
+	gatherVertices(primitive, copy.data(), source.data(), primitive, vertexData);
+}
+
+// Cut the triangles of an indexed triangle list into meshlets in the order they are drawn
+static void meshletPrimitive(const BakedPrimitive& primitive, const unsigned char* vertexData, const unsigned char* indexData,
+	std::vector<Meshlet>& meshlets)
+{
+	std::vector<uint32_t> order(primitive.indexCount);
+	readIndices(indexData, primitive.indexCount, primitive.indexType, order.data());
+	const std::vector<float> positions = decodeAttribute(primitive, vertexData, LOCATION_POSITION);
+	const size_t first = meshlets.size();
+	buildMeshlets(order.data(), order.size(), positions.data(), primitive.vertexCount, meshlets);
+	// Back faces of a double-sided primitive are drawn, so only the frustum may cull its meshlets
+	if (primitive.doubleSided) {
+		for (size_t m = first; m != meshlets.size(); ++m) {
+			meshlets[m].coneCutoff = 1.0f;
+		}
+	}
+}
+
+// The coarser levels of a primitive, each an index list over the primitive's own vertices
+struct PrimitiveLods {
+	std::vector<std::vector<uint32_t>> levels;
+	std::vector<float> errors;
+	float center[3] = {};
+	float radius = 0.0f;
+};
+
+// Simplify an indexed triangle list into ever coarser levels. Every level is simplified from the full list,
+// so its error is measured against the full surface.
+static void lodPrimitive(const BakedPrimitive& primitive, const unsigned char* vertexData, const unsigned char* indexData,
+	const BakeOptions& options, PrimitiveLods& lods)
+{
+	std::vector<uint32_t> source(primitive.indexCount);
+	readIndices(indexData, primitive.indexCount, primitive.indexType, source.data());
+	const std::vector<float> positions = decodeAttribute(primitive, vertexData, LOCATION_POSITION);
+	std::vector<float> normals;
+	if (primitive.attributes[LOCATION_NORMAL].present()) {
+		normals = decodeAttribute(primitive, vertexData, LOCATION_NORMAL);
+	}
+
+	// The sphere around the middle of the box of the vertices the list uses
+	glm::vec3 low(positions[source[0] * 3], positions[source[0] * 3 + 1], positions[source[0] * 3 + 2]);
+	glm::vec3 high = low;
+	for (uint32_t vertex : source) {
+		const glm::vec3 point(positions[vertex * 3], positions[vertex * 3 + 1], positions[vertex * 3 + 2]);
+		low = glm::min(low, point);
+		high = glm::max(high, point);
+	}
+	const glm::vec3 center = (low + high) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t vertex : source) {
+		radius = std::max(radius, glm::length(glm::vec3(positions[vertex * 3], positions[vertex * 3 + 1], positions[vertex * 3 + 2]) - center));
+	}
+	for (int component = 0; component != 3; ++component) {
+		lods.center[component] = center[component];
+	}
+	lods.radius = radius;
+
+	if (options.lodRatio <= 0.0f || options.lodRatio >= 1.0f) {
+		return;
+	}
+	size_t previous = source.size();
+	float target = static_cast<float>(source.size());
+	float previousError = 0.0f;
+	for (unsigned int level = 0; level != options.lodLevels; ++level) {
+		target *= options.lodRatio;
+		std::vector<uint32_t> simplified(source.size());
+		float error = 0.0f;
+		const size_t count = simplifyMesh(source.data(), source.size(), positions.data(), normals.empty() ? nullptr : normals.data(),
+			primitive.vertexCount, static_cast<size_t>(target), options.lodMaxError * radius, simplified.data(), error);
+		// A level that barely shrinks is not worth its indices, and the ones after it would be no smaller
+		if (count == 0 || count * 10 > previous * 9) {
+			break;
+		}
+		simplified.resize(count);
+		if (options.optimizeVertexCache) {
+			optimizeVertexCache(simplified.data(), count, primitive.vertexCount);
+		}
+		previousError = std::max(previousError, error);
+		lods.levels.push_back(std::move(simplified));
+		lods.errors.push_back(previousError);
+		previous = count;
+	}
+}
+
+// The cluster hierarchy of a primitive, the indices of its coarser clusters counted on from the end of its own
+struct PrimitiveClusters {
+	std::vector<ClusterLod> clusters;
+	std::vector<uint32_t> indices;
+	size_t levels = 0;
+};
+
+// Build a cluster hierarchy over the final triangles of an indexed triangle list
+static void clusterPrimitive(const BakedPrimitive& primitive, const unsigned char* vertexData, const unsigned char* indexData,
+	PrimitiveClusters& clusters)
+{
+	std::vector<uint32_t> source(primitive.indexCount);
+	readIndices(indexData, primitive.indexCount, primitive.indexType, source.data());
+	const std::vector<float> positions = decodeAttribute(primitive, vertexData, LOCATION_POSITION);
+	std::vector<float> normals;
+	if (primitive.attributes[LOCATION_NORMAL].present()) {
+		normals = decodeAttribute(primitive, vertexData, LOCATION_NORMAL);
+	}
+	clusters.levels = buildClusterLod(source.data(), source.size(), positions.data(), normals.empty() ? nullptr : normals.data(),
+		primitive.vertexCount, clusters.clusters, clusters.indices);
+}
+
+// The bounds positions are quantized over, the accessor's when it has them so the chunks of a split mesh share one grid
+struct PositionBounds {
+	float min[3] = {};
+	float max[3] = {};
+	bool given = false;
+};
+
+// A primitive's vertices in the compact encodings, no vertices when none applies
+struct EncodedPrimitive {
+	std::vector<unsigned char> vertices;
+	BakedAttribute attributes[LOCATION_COUNT];
+	unsigned int vertexSize = 0;
+	float positionOffset[3] = {};
+	float positionScale[3] = { 1.0f, 1.0f, 1.0f };
+	VertexEncodingStats stats;
+};
+
+template<typename T>
+static void storeComponents(const int32_t* values, size_t count, unsigned char* out)
+{
+	for (size_t i = 0; i != count; ++i) {
+		const T value = static_cast<T>(values[i]);
+		std::memcpy(out + i * sizeof(T), &value, sizeof(T));
+	}
+}
+
+// Store the attributes of a primitive in the compact encodings the options ask for, measuring how far every value
+// moves. The other passes read the vertices as floats, so this one comes last.
+static void encodePrimitive(const BakedPrimitive& primitive, const unsigned char* vertexData, const PositionBounds& bounds,
+	const BakeOptions& options, EncodedPrimitive& encoded)
+{
+	const unsigned int bits = options.normalBits == 8 ? 8 : 16;
+	BakedPrimitive layout = primitive;
+	BakedAttribute* attributes = layout.attributes;
+	bool changed = false;
+
+	// Texture coordinates become halves only when every one of them survives the rounding
+	std::vector<uint16_t> halves;
+	const BakedAttribute& texcoord = primitive.attributes[LOCATION_TEXCOORD];
+	if (options.halfTexcoords && texcoord.present() && texcoord.componentType == GL_FLOAT) {
+		const std::vector<float> values = decodeAttribute(primitive, vertexData, LOCATION_TEXCOORD, texcoord.components);
+		halves.resize(values.size());
+		decodeAccessor(attributeView(primitive, vertexData, LOCATION_TEXCOORD), DECODE_HALF, halves.data());
+		float error = 0.0f;
+		for (size_t i = 0; i != values.size(); ++i) {
+			error = std::max(error, std::fabs(halfToFloat(halves[i]) - values[i]));
+		}
+		// NaN and infinite coordinates compare false and stay float too
+		if (error <= options.texcoordTolerance) {
+			encoded.stats.texcoordError = error;
+			attributes[LOCATION_TEXCOORD].componentType = GL_HALF_FLOAT;
+			attributes[LOCATION_TEXCOORD].normalized = 0;
+			changed = true;
+		}
+		else {
+			halves.clear();
+			encoded.stats.floatTexcoords = 1;
+		}
+	}
+	if (options.quantizePositions && attributes[LOCATION_POSITION].present() && attributes[LOCATION_POSITION].componentType == GL_FLOAT) {
+		attributes[LOCATION_POSITION].componentType = GL_UNSIGNED_SHORT;
+		attributes[LOCATION_POSITION].normalized = 1;
+		changed = true;
+	}
+	for (unsigned int location : { LOCATION_NORMAL, LOCATION_TANGENT }) {
+		if (options.encodeNormals && attributes[location].present()) {
+			attributes[location].componentType = bits == 8 ? GL_BYTE : GL_SHORT;
+			attributes[location].components = 2;
+			attributes[location].normalized = 1;
+			changed = true;
+		}
+	}
+	if (!changed || primitive.vertexCount == 0) {
+		return;
+	}
+
+	// The same layout as layoutVertex, with the new sizes
+	unsigned int offset = 0;
+	for (unsigned int location = 0; location != LOCATION_COUNT; ++location) {
+		if (attributes[location].present()) {
+			attributes[location].offset = static_cast<uint16_t>(offset);
+			offset += attributes[location].size();
+		}
+	}
+	layout.vertexSize = offset;
+	encoded.vertices.assign(layout.vertexCount * layout.vertexSize, 0);
+
+	for (unsigned int location = 0; location != LOCATION_COUNT; ++location) {
+		const BakedAttribute& from = primitive.attributes[location];
+		const BakedAttribute& to = attributes[location];
+		if (!to.present()) {
+			continue;
+		}
+		unsigned char* out = encoded.vertices.data() + layout.attributeOffset(location);
+		const size_t stride = layout.attributeStride(location);
+		if (from.componentType == to.componentType && from.components == to.components) {
+			const unsigned char* in = vertexData + primitive.attributeOffset(location);
+			for (size_t vertex = 0; vertex != primitive.vertexCount; ++vertex) {
+				std::memcpy(out + vertex * stride, in + vertex * primitive.attributeStride(location), to.size());
+			}
+		}
+		else if (location == LOCATION_POSITION) {
+			// One scale for every axis, so the transform undoing it keeps normals perpendicular
+			const std::vector<float> positions = decodeAttribute(primitive, vertexData, LOCATION_POSITION);
+			float low[3];
+			float high[3];
+			for (int axis = 0; axis != 3; ++axis) {
+				low[axis] = bounds.given ? bounds.min[axis] : positions[axis];
+				high[axis] = bounds.given ? bounds.max[axis] : positions[axis];
+			}
+			for (size_t i = 0; i != positions.size(); ++i) {
+				low[i % 3] = std::min(low[i % 3], positions[i]);
+				high[i % 3] = std::max(high[i % 3], positions[i]);
+			}
+			float scale = std::max(high[0] - low[0], std::max(high[1] - low[1], high[2] - low[2]));
+			scale = scale > 0.0f ? scale : 1.0f;
+			for (int axis = 0; axis != 3; ++axis) {
+				encoded.positionOffset[axis] = low[axis];
+				encoded.positionScale[axis] = scale;
+			}
+			for (size_t vertex = 0; vertex != primitive.vertexCount; ++vertex) {
+				int32_t stored[3];
+				float moved = 0.0f;
+				for (int axis = 0; axis != 3; ++axis) {
+					const float value = positions[vertex * 3 + axis];
+					stored[axis] = static_cast<int32_t>(std::lround(std::clamp((value - low[axis]) / scale, 0.0f, 1.0f) * 65535.0f));
+					const float decoded = low[axis] + scale * (static_cast<float>(stored[axis]) / 65535.0f);
+					moved += (decoded - value) * (decoded - value);
+				}
+				encoded.stats.positionError = std::max(encoded.stats.positionError, std::sqrt(moved));
+				storeComponents<uint16_t>(stored, 3, out + vertex * stride);
+			}
+		}
+		else if (location == LOCATION_NORMAL || location == LOCATION_TANGENT) {
+			const bool tangent = location == LOCATION_TANGENT;
+			const std::vector<float> vectors = decodeAttribute(primitive, vertexData, location, tangent ? 4 : 3);
+			float& error = tangent ? encoded.stats.tangentError : encoded.stats.normalError;
+			for (size_t vertex = 0; vertex != primitive.vertexCount; ++vertex) {
+				const float* vector = vectors.data() + vertex * (tangent ? 4 : 3);
+				int32_t stored[2];
+				float decoded[4];
+				if (tangent) {
+					encodeTangent(vector, bits, stored);
+					decodeTangent(stored, bits, decoded);
+				}
+				else {
+					encodeOctahedral(vector, bits, stored);
+					decodeOctahedral(stored, bits, decoded);
+				}
+				// Zero vectors have no direction to keep
+				const float length = std::sqrt(vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2]);
+				if (length > 0.0f) {
+					const float cosine = (vector[0] * decoded[0] + vector[1] * decoded[1] + vector[2] * decoded[2]) / length;
+					const bool flipped = tangent && (vector[3] < 0.0f) != (decoded[3] < 0.0f);
+					error = std::max(error, flipped ? 180.0f : glm::degrees(std::acos(std::clamp(cosine, -1.0f, 1.0f))));
+				}
+				if (bits == 8) {
+					storeComponents<int8_t>(stored, 2, out + vertex * stride);
+				}
+				else {
+					storeComponents<int16_t>(stored, 2, out + vertex * stride);
+				}
+			}
+		}
+		else if (location == LOCATION_TEXCOORD) {
+			for (size_t vertex = 0; vertex != primitive.vertexCount; ++vertex) {
+				std::memcpy(out + vertex * stride, halves.data() + vertex * to.components, to.components * sizeof(uint16_t));
+			}
+		}
+	}
+
+	std::copy(std::begin(layout.attributes), std::end(layout.attributes), encoded.attributes);
+	encoded.vertexSize = layout.vertexSize;
+	encoded.stats.bytesBefore = primitive.vertexCount * primitive.vertexSize;
+	encoded.stats.bytesAfter = layout.vertexCount * layout.vertexSize;
+}
+
+bool sameVertexLayout(const BakedPrimitive& a, const BakedPrimitive& b)
+{
+	if (a.vertexSize != b.vertexSize || a.interleaved != b.interleaved) {
+		return false;
+	}
+	for (unsigned int location = 0; location != LOCATION_COUNT; ++location) {
+		const BakedAttribute& first = a.attributes[location];
+		const BakedAttribute& second = b.attributes[location];
+		if (first.componentType != second.componentType || first.components != second.components ||
+			first.normalized != second.normalized || first.offset != second.offset) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void copyPositions(const BakedPrimitive& primitive, unsigned char* out)
+{
+	const BakedAttribute& position = primitive.attributes[LOCATION_POSITION];
+	const unsigned char* source = primitive.vertices + primitive.attributeOffset(LOCATION_POSITION);
+	if (!primitive.interleaved) {
+		// A split primitive already stores them as one tight stream
+		std::memcpy(out, source, primitive.vertexCount * position.size());
+		return;
+	}
+	for (size_t v = 0; v != primitive.vertexCount; ++v) {
+		std::memcpy(out + v * position.size(), source + v * primitive.vertexSize, position.size());
+	}
+}
+
+unsigned int selectLod(const BakedLod* lods, size_t lodCount, const glm::vec3& center, float radius, const glm::mat4& world,
+	const glm::vec3& eye, float fovY, float viewportHeight, float pixelError)
+{
+	// The largest scale of the transform stretches both the bounds and the errors
+	const float scale = std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+	const float distance = glm::length(glm::vec3(world * glm::vec4(center, 1.0f)) - eye) - radius * scale;
+	if (distance <= 0.0f) {
+		return 0;
+	}
+	// Pixels per unit at that distance
+	const float pixelsPerUnit = viewportHeight / (2.0f * std::tan(fovY * 0.5f) * distance);
+	for (size_t level = lodCount; level != 0; --level) {
+		if (lods[level - 1].error * scale * pixelsPerUnit <= pixelError) {
+			return static_cast<unsigned int>(level);
+		}
+	}
+	return 0;
+}
+
+std::string getVertexDecodeGLSL(const BakedPrimitive& primitive)
+{
+	// Indexed by location: the input's name, the decoder's signature and the value of an attribute the primitive lacks
+	static const char* const names[LOCATION_COUNT] = { "aPosition", "aNormal", "aColor", "aTexCoord", "aTangent" };
+	static const char* const decoders[LOCATION_COUNT] = {
+		"vec3 vertexPosition()", "vec3 vertexNormal()", "vec4 vertexColor()", "vec2 vertexTexcoord()", "vec4 vertexTangent()" };
+	static const char* const defaults[LOCATION_COUNT] = {
+		"vec3(0.0)", "vec3(0.0, 0.0, 1.0)", "vec4(1.0)", "vec2(0.0)", "vec4(1.0, 0.0, 0.0, 1.0)" };
+
+	std::string inputs;
+	std::string functions;
+	bool octahedral = false;
+	bool tangent = false;
+	for (unsigned int location = 0; location != LOCATION_COUNT; ++location) {
+		const BakedAttribute& attribute = primitive.attributes[location];
+		std::string value = defaults[location];
+		if (attribute.present()) {
+			// Integer components reach the shader as floats either way, normalized or not
+			const std::string name = names[location];
+			inputs += "layout (location = " + std::to_string(location) + ") in " +
+				(attribute.components == 1 ? std::string("float") : "vec" + std::to_string(attribute.components)) + " " + name + ";\n";
+			if ((location == LOCATION_NORMAL || location == LOCATION_TANGENT) && attribute.components == 2) {
+				octahedral = true;
+				tangent |= location == LOCATION_TANGENT;
+				value = (location == LOCATION_TANGENT ? "decodeTangent(" : "decodeOctahedral(") + name + ")";
+			}
+			else if (location == LOCATION_COLOR && attribute.components == 3) {
+				value = "vec4(" + name + ", 1.0)";
+			}
+			else {
+				value = name;
+			}
+		}
+		functions += std::string(decoders[location]) + "\n{\n\treturn " + value + ";\n}\n";
+	}
+	std::string source = "// Generated for the baked vertex layout, quantized positions are undone by the model transform\n" + inputs + "\n";
+	if (octahedral) {
+		source += OCTAHEDRAL_DECODE_GLSL;
+	}
+	if (tangent) {
+		source += TANGENT_DECODE_GLSL;
+	}
+	return source + functions;
+}
+
+
+void BakedModel::Build(const glTFloader& loader, const BakeOptions& options)
+{
+	clear();
+	optionsHash = hashBakeOptions(options);
+
+	// Offsets into the streams, turned into pointers once the streams stop growing
+	std::vector<size_t> vertexOffsets;
+	std::vector<size_t> indexOffsets;
+	std::vector<size_t> pixelOffsets;
+	std::vector<PositionBounds> positionBounds;
+	std::vector<IndexChunk> chunks;
+
+	for (const Mesh& mesh : loader.Meshes) {
+		BakedMesh bakedMesh;
+		bakedMesh.firstPrimitive = static_cast<unsigned int>(Primitives.size());
+		Meshes.push_back(bakedMesh);
+
+		for (const Mesh_Primitive& primitive : mesh.primitives) {
+			BakedPrimitive baked;
+
+			// Interleave every attribute, quantized ones keep their type and the rest are decoded to float
+			const AccessorView none;
+			const AccessorView* views[LOCATION_COUNT];
+			for (unsigned int location = 0; location != LOCATION_COUNT; ++location) {
+				const Attribute semantic = LOCATION_SEMANTICS[location];
+				views[location] = primitive.has(semantic) ? &loader.GetView(primitive.attributes[semantic]) : &none;
+			}
+			const AccessorView& positions = *views[LOCATION_POSITION];
+			PositionBounds bounds;
+			if (primitive.has(POSITION)) {
+				const Accessor& accessor = loader.Accessors[primitive.attributes[POSITION]];
+				bounds.given = accessor.hasMin && accessor.hasMax && accessor.componentType == GL_FLOAT;
+				std::copy(accessor.min, accessor.min + 3, bounds.min);
+				std::copy(accessor.max, accessor.max + 3, bounds.max);
+			}
+			baked.vertexSize = layoutVertex(views, options, baked.attributes);
+			baked.interleaved = options.interleaveVertices;
+
+			vertexOffsets.push_back(vertices.size());
+			baked.vertexCount = positions.count;
+			vertices.resize(vertices.size() + positions.count * baked.vertexSize, 0);
+			if (positions.count != 0) {
+				unsigned char* out = vertices.data() + vertexOffsets.back();
+				for (unsigned int location = 0; location != LOCATION_COUNT; ++location) {
+					if (baked.attributes[location].present()) {
+						interleave(*views[location], positions.count, baked.attributes[location],
+							out + baked.attributeOffset(location), baked.attributeStride(location));
+					}
+				}
+			}
+
+			// Indices keep their glTF width, each range starts on a 4 byte boundary
+			indices.resize(alignUp(indices.size(), 4));
+			indexOffsets.push_back(indices.size());
+			if (primitive.indices) {
+				const AccessorView& view = loader.GetView(*(primitive.indices));
+				baked.indexCount = view.count;
+				baked.indexType = view.componentType;
+				if (view.packed()) {
+					append(indices, view.data, view.count * view.elementSize);
+				}
+				else {
+					for (size_t j = 0; j != view.count; ++j) {
+						append(indices, view[j], view.elementSize);
+					}
+				}
+				unsigned char* stored = indices.data() + indexOffsets.back();
+				const IndexRange range = getIndexRange(stored, baked.indexCount, baked.indexType);
+				baked.minIndex = range.min;
+				baked.maxIndex = range.max;
+				// 32-bit indices that would fit in 16 bits, below the restart index, only cost bandwidth
+				if (options.narrowIndices && baked.indexType == GL_UNSIGNED_INT && range.max < MAX_16BIT_VERTICES) {
+					narrowIndices(stored, baked.indexCount, stored);
+					baked.indexType = GL_UNSIGNED_SHORT;
+					indices.resize(indexOffsets.back() + baked.indexCount * sizeof(uint16_t));
+				}
+			}
+
+			baked.mode = primitive.mode;
+			getBaseColorTexture(loader, primitive, baked.image, baked.sampler);
+			baked.doubleSided = isDoubleSided(loader, primitive);
+
+			// The rest of the 32-bit indices address more vertices than 16 bits can, cut their primitive into chunks that do
+			if (options.splitLargeMeshes && baked.indexType == GL_UNSIGNED_INT && baked.maxIndex >= MAX_16BIT_VERTICES &&
+				splitIndices(indices.data() + indexOffsets.back(), baked.indexCount, baked.vertexCount, baked.mode, MAX_16BIT_VERTICES, chunks)) {
+				splitPrimitive(baked, chunks, vertices, indices, vertexOffsets, indexOffsets, Primitives);
+				positionBounds.resize(Primitives.size(), bounds);
+				continue;
+			}
+			Primitives.push_back(baked);
+			positionBounds.push_back(bounds);
+		}
+		Meshes.back().primitiveCount = static_cast<unsigned int>(Primitives.size()) - bakedMesh.firstPrimitive;
+	}
+
+	for (unsigned int image = 0; image != loader.Images.size(); ++image) {
+		const ImagePixels& source = loader.GetImagePixels(image);
+		BakedImage baked;
+		pixelOffsets.push_back(pixels.size());
+		if (source.pixels) {
+			baked.width = source.width;
+			baked.height = source.height;
+			baked.channels = source.channels;
+			append(pixels, source.pixels.get(), static_cast<size_t>(source.width) * source.height * source.channels);
+		}
+		Images.push_back(baked);
+	}
+
+	Nodes = flattenScene(loader);
+
+	// The passes over finished primitives run every primitive on its own worker
+	const bool reorder = options.optimizeVertexCache || options.optimizeOverdraw;
+	const bool encode = options.quantizePositions || options.encodeNormals || options.halfTexcoords;
+	std::unique_ptr<ThreadPool> pool;
+	if (options.weldVertices || reorder || options.buildMeshlets || options.lodLevels != 0 || options.buildClusterLod || encode) {
+		pool = std::make_unique<ThreadPool>(options.workerCount);
+	}
+
+	// Primitives drawn without indices get indices over their distinct vertices, the streams are rebuilt around them
+	if (options.weldVertices) {
+		std::vector<WeldedPrimitive> welded(Primitives.size());
+		std::vector<std::future<void>> tasks;
+		for (size_t i = 0; i != Primitives.size(); ++i) {
+			if (Primitives[i].indexCount != 0 || Primitives[i].vertexCount == 0) {
+				continue;
+			}
+			tasks.push_back(pool->Submit([this, i, &options, &vertexOffsets, &welded]() {
+				weldPrimitive(Primitives[i], vertices.data() + vertexOffsets[i], options, welded[i]);
+			}));
+		}
+		for (std::future<void>& task : tasks) {
+			task.get();
+		}
+
+		std::vector<unsigned char> weldedVertices;
+		std::vector<unsigned char> weldedIndices;
+		for (size_t i = 0; i != Primitives.size(); ++i) {
+			BakedPrimitive& primitive = Primitives[i];
+			const unsigned char* vertexData = vertices.data() + vertexOffsets[i];
+			const unsigned char* indexData = indices.data() + indexOffsets[i];
+			vertexOffsets[i] = weldedVertices.size();
+			weldedIndices.resize(alignUp(weldedIndices.size(), 4));
+			indexOffsets[i] = weldedIndices.size();
+			const WeldedPrimitive& weld = welded[i];
+			if (weld.indices.empty()) {
+				append(weldedVertices, vertexData, primitive.vertexCount * primitive.vertexSize);
+				append(weldedIndices, indexData, primitive.indexCount * getComponentTypeSize(primitive.indexType));
+				continue;
+			}
+			Report.weldedVerticesBefore += primitive.vertexCount;
+			Report.weldedVerticesAfter += weld.vertexCount;
+			append(weldedVertices, weld.vertices.data(), weld.vertices.size());
+			primitive.vertexCount = weld.vertexCount;
+			primitive.indexCount = weld.indices.size();
+			// The largest welded index is vertexCount - 1, 16 bits hold it while it stays below the restart index 65535
+			primitive.indexType = weld.vertexCount <= MAX_16BIT_VERTICES ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+			primitive.minIndex = 0;
+			primitive.maxIndex = static_cast<uint32_t>(weld.vertexCount - 1);
+			weldedIndices.resize(indexOffsets[i] + primitive.indexCount * getComponentTypeSize(primitive.indexType));
+			writeIndices(weld.indices.data(), primitive.indexCount, primitive.indexType, weldedIndices.data() + indexOffsets[i]);
+		}
+		vertices.swap(weldedVertices);
+		indices.swap(weldedIndices);
+	}
+
+	// The streams of different primitives do not overlap, so they are rewritten in place.
+	// Overdraw ordering starts from the cache order, so it implies the cache pass.
+	if (reorder) {
+		std::vector<BakeReport> reports(Primitives.size());
+		std::vector<std::future<void>> tasks;
+		for (size_t i = 0; i != Primitives.size(); ++i) {
+			const BakedPrimitive& primitive = Primitives[i];
+			if (primitive.mode != GL_TRIANGLES || primitive.indexCount < 3 || primitive.maxIndex >= primitive.vertexCount) {
+				continue;
+			}
+			tasks.push_back(pool->Submit([this, i, &options, &vertexOffsets, &indexOffsets, &reports]() {
+				optimizePrimitive(Primitives[i], vertices.data() + vertexOffsets[i], indices.data() + indexOffsets[i], options, reports[i]);
+			}));
+		}
+		for (std::future<void>& task : tasks) {
+			task.get();
+		}
+		for (const BakeReport& report : reports) {
+			Report.vertexCacheBefore.add(report.vertexCacheBefore);
+			Report.vertexCacheAfter.add(report.vertexCacheAfter);
+			Report.overdrawBefore.add(report.overdrawBefore);
+			Report.overdrawAfter.add(report.overdrawAfter);
+			Report.storedOrderKept += report.storedOrderKept;
+		}
+	}
+
+	// Meshlets are cut from the final triangle order, every primitive's on its own worker
+	std::vector<size_t> meshletOffsets(Primitives.size(), 0);
+	if (options.buildMeshlets) {
+		std::vector<std::vector<Meshlet>> built(Primitives.size());
+		std::vector<std::future<void>> tasks;
+		for (size_t i = 0; i != Primitives.size(); ++i) {
+			const BakedPrimitive& primitive = Primitives[i];
+			if (primitive.mode != GL_TRIANGLES || primitive.indexCount < 3 || primitive.maxIndex >= primitive.vertexCount ||
+				!primitive.attributes[LOCATION_POSITION].present()) {
+				continue;
+			}
+			tasks.push_back(pool->Submit([this, i, &vertexOffsets, &indexOffsets, &built]() {
+				meshletPrimitive(Primitives[i], vertices.data() + vertexOffsets[i], indices.data() + indexOffsets[i], built[i]);
+			}));
+		}
+		for (std::future<void>& task : tasks) {
+			task.get();
+		}
+		for (size_t i = 0; i != Primitives.size(); ++i) {
+			meshletOffsets[i] = meshlets.size();
+			Primitives[i].meshletCount = built[i].size();
+			meshlets.insert(meshlets.end(), built[i].begin(), built[i].end());
+			Report.meshlets += built[i].size();
+			Report.meshletTriangles += built[i].empty() ? 0 : Primitives[i].indexCount / 3;
+		}
+	}
+
+	// Levels are simplified from the final triangles, every primitive's on its own worker. Their indices follow
+	// the primitive's own in the index stream, which is rebuilt around them.
+	std::vector<size_t> lodOffsets(Primitives.size(), 0);
+	if (options.lodLevels != 0) {
+		std::vector<PrimitiveLods> built(Primitives.size());
+		std::vector<std::future<void>> tasks;
+		for (size_t i = 0; i != Primitives.size(); ++i) {
+			const BakedPrimitive& primitive = Primitives[i];
+			if (primitive.mode != GL_TRIANGLES || primitive.indexCount < 3 || primitive.maxIndex >= primitive.vertexCount ||
+				!primitive.attributes[LOCATION_POSITION].present()) {
+				continue;
+			}
+			tasks.push_back(pool->Submit([this, i, &options, &vertexOffsets, &indexOffsets, &built]() {
+				lodPrimitive(Primitives[i], vertices.data() + vertexOffsets[i], indices.data() + indexOffsets[i], options, built[i]);
+			}));
+		}
+		for (std::future<void>& task : tasks) {
+			task.get();
+		}
+
+		std::vector<unsigned char> leveledIndices;
+		for (size_t i = 0; i != Primitives.size(); ++i) {
+			BakedPrimitive& primitive = Primitives[i];
+			const size_t indexSize = getComponentTypeSize(primitive.indexType);
+			const unsigned char* own = indices.data() + indexOffsets[i];
+			leveledIndices.resize(alignUp(leveledIndices.size(), 4));
+			indexOffsets[i] = leveledIndices.size();
+			append(leveledIndices, own, primitive.indexCount * indexSize);
+
+			const PrimitiveLods& levels = built[i];
+			std::copy(std::begin(levels.center), std::end(levels.center), primitive.boundsCenter);
+			primitive.boundsRadius = levels.radius;
+			primitive.lodCount = levels.levels.size();
+			lodOffsets[i] = lods.size();
+			uint32_t firstIndex = static_cast<uint32_t>(primitive.indexCount);
+			for (size_t level = 0; level != levels.levels.size(); ++level) {
+				BakedLod lod;
+				lod.firstIndex = firstIndex;
+				lod.indexCount = static_cast<uint32_t>(levels.levels[level].size());
+				lod.error = levels.errors[level];
+				lods.push_back(lod);
+				leveledIndices.resize(leveledIndices.size() + lod.indexCount * indexSize);
+				writeIndices(levels.levels[level].data(), lod.indexCount, primitive.indexType,
+					leveledIndices.data() + indexOffsets[i] + firstIndex * indexSize);
+				firstIndex += lod.indexCount;
+				Report.lodTriangles += lod.indexCount / 3;
+			}
+			Report.lodLevels += levels.levels.size();
+		}
+		indices.swap(leveledIndices);
+	}
+
+	// Cluster hierarchies are built from the final triangles too. The indices of the coarser clusters follow those
+	// of the levels, so their firstIndex moves past the levels.
+	std::vector<size_t> clusterOffsets(Primitives.size(), 0);
+	if (options.buildClusterLod) {
+		std::vector<PrimitiveClusters> built(Primitives.size());
+		std::vector<std::future<void>> tasks;
+		for (size_t i = 0; i != Primitives.size(); ++i) {
+			const BakedPrimitive& primitive = Primitives[i];
+			if (primitive.mode != GL_TRIANGLES || primitive.indexCount < 3 || primitive.maxIndex >= primitive.vertexCount ||
+				!primitive.attributes[LOCATION_POSITION].present()) {
+				continue;
+			}
+			tasks.push_back(pool->Submit([this, i, &vertexOffsets, &indexOffsets, &built]() {
+				clusterPrimitive(Primitives[i], vertices.data() + vertexOffsets[i], indices.data() + indexOffsets[i], built[i]);
+			}));
+		}
+		for (std::future<void>& task : tasks) {
+			task.get();
+		}
+
+		std::vector<unsigned char> clusteredIndices;
+		for (size_t i = 0; i != Primitives.size(); ++i) {
+			BakedPrimitive& primitive = Primitives[i];
+			const size_t indexSize = getComponentTypeSize(primitive.indexType);
+			// The levels are not pointed to yet, their indices end where the last one does
+			const size_t levelEnd = primitive.lodCount != 0 ?
+				lods[lodOffsets[i] + primitive.lodCount - 1].firstIndex + lods[lodOffsets[i] + primitive.lodCount - 1].indexCount : primitive.indexCount;
+			const unsigned char* own = indices.data() + indexOffsets[i];
+			clusteredIndices.resize(alignUp(clusteredIndices.size(), 4));
+			indexOffsets[i] = clusteredIndices.size();
+			append(clusteredIndices, own, levelEnd * indexSize);
+
+			const PrimitiveClusters& hierarchy = built[i];
+			clusterOffsets[i] = clusters.size();
+			primitive.clusterCount = hierarchy.clusters.size();
+			primitive.clusterIndexCount = hierarchy.indices.size();
+			for (ClusterLod cluster : hierarchy.clusters) {
+				if (cluster.firstIndex >= primitive.indexCount) {
+					cluster.firstIndex += static_cast<uint32_t>(levelEnd - primitive.indexCount);
+					Report.clusterTriangles += cluster.indexCount / 3;
+				}
+				clusters.push_back(cluster);
+			}
+			clusteredIndices.resize(clusteredIndices.size() + hierarchy.indices.size() * indexSize);
+			writeIndices(hierarchy.indices.data(), hierarchy.indices.size(), primitive.indexType,
+				clusteredIndices.data() + indexOffsets[i] + levelEnd * indexSize);
+			Report.clusters += hierarchy.clusters.size();
+			Report.clusterLevels = std::max(Report.clusterLevels, hierarchy.levels);
+		}
+		indices.swap(clusteredIndices);
+	}
+
+	// The compact encodings come last, the vertex stream is rebuilt around the smaller vertices
+	if (encode) {
+		std::vector<EncodedPrimitive> encoded(Primitives.size());
+		std::vector<std::future<void>> tasks;
+		for (size_t i = 0; i != Primitives.size(); ++i) {
+			tasks.push_back(pool->Submit([this, i, &options, &vertexOffsets, &positionBounds, &encoded]() {
+				encodePrimitive(Primitives[i], vertices.data() + vertexOffsets[i], positionBounds[i], options, encoded[i]);
+			}));
+		}
+		for (std::future<void>& task : tasks) {
+			task.get();
+		}
+
+		std::vector<unsigned char> encodedVertices;
+		for (size_t i = 0; i != Primitives.size(); ++i) {
+			BakedPrimitive& primitive = Primitives[i];
+			const unsigned char* vertexData = vertices.data() + vertexOffsets[i];
+			vertexOffsets[i] = encodedVertices.size();
+			const EncodedPrimitive& encoding = encoded[i];
+			Report.encoding.add(encoding.stats);
+			if (encoding.vertices.empty()) {
+				append(encodedVertices, vertexData, primitive.vertexCount * primitive.vertexSize);
+				continue;
+			}
+			append(encodedVertices, encoding.vertices.data(), encoding.vertices.size());
+			std::copy(std::begin(encoding.attributes), std::end(encoding.attributes), primitive.attributes);
+			primitive.vertexSize = encoding.vertexSize;
+			std::copy(std::begin(encoding.positionOffset), std::end(encoding.positionOffset), primitive.positionOffset);
+			std::copy(std::begin(encoding.positionScale), std::end(encoding.positionScale), primitive.positionScale);
+		}
+		vertices.swap(encodedVertices);
+	}
+
+	// Point into the finished streams
+	for (size_t i = 0; i != Primitives.size(); ++i) {
+		BakedPrimitive& primitive = Primitives[i];
+		primitive.vertices = vertices.data() + vertexOffsets[i];
+		primitive.indices = primitive.indexCount != 0 ? indices.data() + indexOffsets[i] : nullptr;
+		primitive.meshlets = primitive.meshletCount != 0 ? meshlets.data() + meshletOffsets[i] : nullptr;
+		primitive.lods = primitive.lodCount != 0 ? lods.data() + lodOffsets[i] : nullptr;
+		primitive.clusters = primitive.clusterCount != 0 ? clusters.data() + clusterOffsets[i] : nullptr;
+	}
+	for (size_t i = 0; i != Images.size(); ++i) {
+		Images[i].pixels = Images[i].channels != 0 ? pixels.data() + pixelOffsets[i] : nullptr;
+	}
+}
+
+bool BakedModel::Save(const std::string& path, uint64_t sourceHash, const std::vector<std::string>& dependencies, const CacheOptions& options) const
+{
+	// Gather every section, pointers become offsets into the stream sections
+	std::vector<unsigned char> sections[SECTION_COUNT];
+
+	for (const std::string& dependency : dependencies) {
+		append(sections[SECTION_DEPENDENCIES], dependency.c_str(), dependency.size() + 1);
+	}
+
+	append(sections[SECTION_MESHES], Meshes.data(), Meshes.size() * sizeof(BakedMesh));
+
+	for (const BakedPrimitive& primitive : Primitives) {
+		FilePrimitive record = {};
+		record.vertexOffset = sections[SECTION_VERTICES].size();
+		record.vertexCount = primitive.vertexCount;
+		record.vertexSize = primitive.vertexSize;
+		record.interleaved = primitive.interleaved;
+		std::copy(std::begin(primitive.attributes), std::end(primitive.attributes), record.attributes);
+		append(sections[SECTION_VERTICES], primitive.vertices, primitive.vertexCount * primitive.vertexSize);
+
+		std::vector<unsigned char>& indexSection = sections[SECTION_INDICES];
+		indexSection.resize(alignUp(indexSection.size(), 4));
+		record.indexOffset = indexSection.size();
+		record.indexCount = primitive.indexCount;
+		record.hasIndices = primitive.indices != nullptr;
+		append(indexSection, primitive.indices, primitive.indices ? primitive.storedIndexCount() * getComponentTypeSize(primitive.indexType) : 0);
+
+		record.indexType = primitive.indexType;
+		record.minIndex = primitive.minIndex;
+		record.maxIndex = primitive.maxIndex;
+		record.mode = primitive.mode;
+		record.image = primitive.image;
+		record.magFilter = primitive.sampler.magFilter;
+		record.minFilter = primitive.sampler.minFilter;
+		record.wrapS = primitive.sampler.wrapS;
+		record.wrapT = primitive.sampler.wrapT;
+		record.doubleSided = primitive.doubleSided;
+		record.meshletOffset = sections[SECTION_MESHLETS].size() / sizeof(Meshlet);
+		record.meshletCount = primitive.meshletCount;
+		append(sections[SECTION_MESHLETS], primitive.meshlets, primitive.meshletCount * sizeof(Meshlet));
+		record.lodOffset = sections[SECTION_LODS].size() / sizeof(BakedLod);
+		record.lodCount = primitive.lodCount;
+		append(sections[SECTION_LODS], primitive.lods, primitive.lodCount * sizeof(BakedLod));
+		record.clusterOffset = sections[SECTION_CLUSTERS].size() / sizeof(ClusterLod);
+		record.clusterCount = primitive.clusterCount;
+		record.clusterIndexCount = primitive.clusterIndexCount;
+		append(sections[SECTION_CLUSTERS], primitive.clusters, primitive.clusterCount * sizeof(ClusterLod));
+		std::copy(std::begin(primitive.boundsCenter), std::end(primitive.boundsCenter), record.boundsCenter);
+		record.boundsRadius = primitive.boundsRadius;
+		std::copy(std::begin(primitive.positionOffset), std::end(primitive.positionOffset), record.positionOffset);
+		std::copy(std::begin(primitive.positionScale), std::end(primitive.positionScale), record.positionScale);
+		append(sections[SECTION_PRIMITIVES], &record, sizeof(record));
+	}
+
+	for (const BakedImage& image : Images) {
+		FileImage record = {};
+		record.width = image.width;
+		record.height = image.height;
+		record.channels = image.channels;
+		record.pixelOffset = sections[SECTION_PIXELS].size();
+		record.pixelSize = image.pixels ? static_cast<size_t>(image.width) * image.height * image.channels : 0;
+		append(sections[SECTION_PIXELS], image.pixels, record.pixelSize);
+		append(sections[SECTION_IMAGES], &record, sizeof(record));
+	}
+
+	for (const BakedNode& node : Nodes) {
+		FileNode record = {};
+		record.mesh = node.mesh;
+		record.parent = node.parent;
+		std::memcpy(record.world, &node.world[0][0], sizeof(record.world));
+		append(sections[SECTION_NODES], &record, sizeof(record));
+	}
+
+	// Compress the large sections that actually get smaller
+	FileSection table[SECTION_COUNT];
+	std::vector<unsigned char> compressed[SECTION_COUNT];
+	size_t offset = alignUp(sizeof(FileHeader) + sizeof(table), SECTION_ALIGNMENT);
+	for (uint32_t type = 0; type != SECTION_COUNT; ++type) {
+		const std::vector<unsigned char>& raw = sections[type];
+		FileSection& section = table[type];
+		section.type = type;
+		section.compressed = 0;
+		section.offset = offset;
+		section.size = raw.size();
+		section.rawSize = raw.size();
+		if (options.compress && type != SECTION_DEPENDENCIES && raw.size() >= options.compressThreshold) {
+			compressed[type].resize(lz4CompressBound(raw.size()));
+			const size_t size = lz4Compress(raw.data(), raw.size(), compressed[type].data(), compressed[type].size());
+			if (size != 0 && size < raw.size()) {
+				compressed[type].resize(size);
+				section.compressed = 1;
+				section.size = size;
+			}
+			else {
+				compressed[type].clear();
+			}
+		}
+		offset = alignUp(offset + section.size, SECTION_ALIGNMENT);
+	}
+
+	FileHeader header = {};
+	header.magic = BAKED_MAGIC;
+	header.version = BAKED_MODEL_VERSION;
+	header.sourceHash = sourceHash;
+	header.optionsHash = optionsHash;
+	header.sectionCount = SECTION_COUNT;
+
+	// Write next to the destination and swap it in, a reader never sees a partial cache
+	const std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open()) {
+			return false;
+		}
+		const char padding[SECTION_ALIGNMENT] = {};
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(table), sizeof(table));
+		size_t written = sizeof(header) + sizeof(table);
+		for (uint32_t type = 0; type != SECTION_COUNT; ++type) {
+			out.write(padding, table[type].offset - written);
+			const std::vector<unsigned char>& payload = table[type].compressed ? compressed[type] : sections[type];
+			out.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+			written = table[type].offset + payload.size();
+		}
+		if (!out) {
+			out.close();
+			std::remove(temporaryPath.c_str());
+			return false;
+		}
+	}
+	std::remove(path.c_str());
+	return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
+
+bool BakedModel::Open(const std::string& path, const std::string& modelPath, const std::string& directory, const BakeOptions& options)
+{
+	clear();
+	if (!file.Open(path)) {
+		return false;
+	}
+	const unsigned char* bytes = file.Data();
+	const size_t size = file.Size();
+
+	FileHeader header;
+	FileSection table[SECTION_COUNT];
+	if (size < sizeof(header) + sizeof(table)) {
+		clear();
+		return false;
+	}
+	std::memcpy(&header, bytes, sizeof(header));
+	std::memcpy(table, bytes + sizeof(header), sizeof(table));
+	if (header.magic != BAKED_MAGIC || header.version != BAKED_MODEL_VERSION || header.sectionCount != SECTION_COUNT ||
+		header.optionsHash != hashBakeOptions(options)) {
+		clear();
+		return false;
+	}
+	for (uint32_t type = 0; type != SECTION_COUNT; ++type) {
+		const FileSection& section = table[type];
+		if (section.type != type || section.offset > size || section.size > size - section.offset ||
+			(section.compressed && type == SECTION_DEPENDENCIES)) {
+			clear();
+			return false;
+		}
+	}
+
+	// A cache is only used while it matches the current sources
+	std::vector<std::string> dependencies;
+	const char* names = reinterpret_cast<const char*>(bytes + table[SECTION_DEPENDENCIES].offset);
+	const size_t namesLength = table[SECTION_DEPENDENCIES].size;
+	if (namesLength != 0 && names[namesLength - 1] != '\0') {
+		clear();
+		return false;
+	}
+	for (size_t start = 0; start < namesLength; start += dependencies.back().size() + 1) {
+		dependencies.emplace_back(names + start);
+	}
+	if (hashModelSources(modelPath, directory, dependencies) != header.sourceHash) {
+		clear();
+		return false;
+	}
+
+	// Sections are used in place unless they were compressed
+	const unsigned char* data[SECTION_COUNT];
+	size_t sizes[SECTION_COUNT];
+	for (uint32_t type = 0; type != SECTION_COUNT; ++type) {
+		const FileSection& section = table[type];
+		if (section.compressed) {
+			decompressed.emplace_back(section.rawSize);
+			if (!lz4Decompress(bytes + section.offset, section.size, decompressed.back().data(), section.rawSize)) {
+				clear();
+				return false;
+			}
+			data[type] = decompressed.back().data();
+			sizes[type] = section.rawSize;
+		}
+		else {
+			data[type] = bytes + section.offset;
+			sizes[type] = section.size;
+		}
+	}
+
+	std::vector<FilePrimitive> primitives;
+	std::vector<FileImage> images;
+	std::vector<FileNode> nodes;
+	if (!readRecords(data[SECTION_MESHES], sizes[SECTION_MESHES], Meshes) ||
+		!readRecords(data[SECTION_PRIMITIVES], sizes[SECTION_PRIMITIVES], primitives) ||
+		!readRecords(data[SECTION_IMAGES], sizes[SECTION_IMAGES], images) ||
+		!readRecords(data[SECTION_NODES], sizes[SECTION_NODES], nodes) ||
+		!readRecords(data[SECTION_MESHLETS], sizes[SECTION_MESHLETS], meshlets) ||
+		!readRecords(data[SECTION_LODS], sizes[SECTION_LODS], lods) ||
+		!readRecords(data[SECTION_CLUSTERS], sizes[SECTION_CLUSTERS], clusters)) {
+		clear();
+		return false;
+	}
+
+	// Turn offsets back into pointers, checking every range against its section
+	bool valid = true;
+	for (const BakedMesh& mesh : Meshes) {
+		valid &= mesh.firstPrimitive <= primitives.size() && mesh.primitiveCount <= primitives.size() - mesh.firstPrimitive;
+	}
+	Primitives.resize(primitives.size());
+	for (size_t i = 0; i != primitives.size() && valid; ++i) {
+		const FilePrimitive& record = primitives[i];
+		BakedPrimitive& primitive = Primitives[i];
+		const size_t indexSize = getComponentTypeSize(record.indexType);
+		// The levels follow the primitive's own indices, in order
+		valid &= record.lodOffset <= lods.size() && record.lodCount <= lods.size() - record.lodOffset && (record.lodCount == 0 || record.hasIndices);
+		uint64_t storedIndexCount = record.indexCount;
+		for (size_t level = 0; level != record.lodCount && valid; ++level) {
+			const BakedLod& lod = lods[record.lodOffset + level];
+			valid &= lod.firstIndex == storedIndexCount;
+			storedIndexCount += lod.indexCount;
+		}
+		// The finest clusters draw the primitive's own indices, the coarser ones those after the levels
+		valid &= record.clusterOffset <= clusters.size() && record.clusterCount <= clusters.size() - record.clusterOffset &&
+			(record.clusterCount == 0 || record.hasIndices) && record.clusterIndexCount <= UINT32_MAX;
+		for (size_t c = 0; c != record.clusterCount && valid; ++c) {
+			const ClusterLod& cluster = clusters[record.clusterOffset + c];
+			const uint64_t end = static_cast<uint64_t>(cluster.firstIndex) + cluster.indexCount;
+			valid &= end <= record.indexCount || (cluster.firstIndex >= storedIndexCount && end <= storedIndexCount + record.clusterIndexCount);
+		}
+		storedIndexCount += record.clusterIndexCount;
+		for (const BakedAttribute& attribute : record.attributes) {
+			valid &= attribute.components <= 4 && getComponentTypeSize(attribute.componentType) != 0 &&
+				attribute.offset + attribute.size() <= record.vertexSize;
+		}
+		valid &= record.vertexSize % 4 == 0 && record.vertexOffset % 4 == 0 &&
+			record.vertexOffset <= sizes[SECTION_VERTICES] &&
+			(record.vertexSize == 0 ? record.vertexCount == 0 : record.vertexCount <= (sizes[SECTION_VERTICES] - record.vertexOffset) / record.vertexSize) &&
+			record.indexOffset <= sizes[SECTION_INDICES] && record.minIndex <= record.maxIndex &&
+			(record.vertexCount == 0 || record.maxIndex < record.vertexCount) &&
+			(!record.hasIndices || (indexSize != 0 && storedIndexCount <= (sizes[SECTION_INDICES] - record.indexOffset) / indexSize)) &&
+			record.meshletOffset <= meshlets.size() && record.meshletCount <= meshlets.size() - record.meshletOffset;
+		for (size_t m = 0; m != record.meshletCount && valid; ++m) {
+			const Meshlet& meshlet = meshlets[record.meshletOffset + m];
+			valid &= record.hasIndices && static_cast<uint64_t>(meshlet.firstIndex) + meshlet.indexCount <= record.indexCount;
+		}
+		// Ranged draws trust minIndex and maxIndex, so the stored indices, levels and clusters included, must keep to them
+		if (valid && record.hasIndices && record.vertexCount != 0 && storedIndexCount != 0) {
+			const IndexRange range = getIndexRange(data[SECTION_INDICES] + record.indexOffset, storedIndexCount, record.indexType);
+			valid &= range.min >= record.minIndex && range.max <= record.maxIndex;
+		}
+		if (!valid) {
+			break;
+		}
+		primitive.vertices = data[SECTION_VERTICES] + record.vertexOffset;
+		primitive.vertexCount = record.vertexCount;
+		primitive.vertexSize = record.vertexSize;
+		primitive.interleaved = record.interleaved != 0;
+		std::copy(std::begin(record.attributes), std::end(record.attributes), primitive.attributes);
+		primitive.indices = record.hasIndices ? data[SECTION_INDICES] + record.indexOffset : nullptr;
+		primitive.indexCount = record.hasIndices ? record.indexCount : 0;
+		primitive.indexType = record.indexType;
+		primitive.minIndex = record.minIndex;
+		primitive.maxIndex = record.maxIndex;
+		primitive.mode = record.mode;
+		primitive.image = record.image;
+		primitive.sampler.magFilter = record.magFilter;
+		primitive.sampler.minFilter = record.minFilter;
+		primitive.sampler.wrapS = record.wrapS;
+		primitive.sampler.wrapT = record.wrapT;
+		primitive.doubleSided = record.doubleSided != 0;
+		primitive.meshlets = record.meshletCount != 0 ? meshlets.data() + record.meshletOffset : nullptr;
+		primitive.meshletCount = record.meshletCount;
+		primitive.lods = record.lodCount != 0 ? lods.data() + record.lodOffset : nullptr;
+		primitive.lodCount = record.lodCount;
+		primitive.clusters = record.clusterCount != 0 ? clusters.data() + record.clusterOffset : nullptr;
+		primitive.clusterCount = record.clusterCount;
+		primitive.clusterIndexCount = record.clusterIndexCount;
+		std::copy(std::begin(record.boundsCenter), std::end(record.boundsCenter), primitive.boundsCenter);
+		primitive.boundsRadius = record.boundsRadius;
+		std::copy(std::begin(record.positionOffset), std::end(record.positionOffset), primitive.positionOffset);
+		std::copy(std::begin(record.positionScale), std::end(record.positionScale), primitive.positionScale);
+	}
+	Images.resize(images.size());
+	for (size_t i = 0; i != images.size() && valid; ++i) {
+		const FileImage& record = images[i];
+		valid &= record.width >= 0 && record.height >= 0 && record.channels >= 0 && record.channels <= 4 &&
+			record.pixelSize == static_cast<uint64_t>(record.width) * record.height * record.channels &&
+			record.pixelOffset <= sizes[SECTION_PIXELS] && record.pixelSize <= sizes[SECTION_PIXELS] - record.pixelOffset;
+		Images[i].width = record.width;
+		Images[i].height = record.height;
+		Images[i].channels = record.channels;
+		Images[i].pixels = record.pixelSize != 0 ? data[SECTION_PIXELS] + record.pixelOffset : nullptr;
+	}
+	Nodes.resize(nodes.size());
+	for (size_t i = 0; i != nodes.size() && valid; ++i) {
+		const FileNode& record = nodes[i];
+		valid &= record.parent >= -1 && record.parent < static_cast<int>(i) &&
+			record.mesh >= -1 && record.mesh < static_cast<int>(Meshes.size());
+		Nodes[i].mesh = record.mesh;
+		Nodes[i].parent = record.parent;
+		std::memcpy(&Nodes[i].world[0][0], record.world, sizeof(record.world));
+	}
+
+	if (!valid) {
+		clear();
+		return false;
+	}
+	return true;
+}
+
+void BakedModel::clear()
+{
+	Meshes.clear();
+	Primitives.clear();
+	Images.clear();
+	Nodes.clear();
+	optionsHash = 0;
+	Report = BakeReport();
+	file.Close();
+	vertices.clear();
+	indices.clear();
+	pixels.clear();
+	meshlets.clear();
+	lods.clear();
+	clusters.clear();
+	decompressed.clear();
+}
+
+
+std::vector<BakedNode> flattenScene(const glTFloader& loader)
+{
+	// Flatten the default scene depth first, parents always come before their children
+	std::vector<BakedNode> nodes;
+	if (loader.DefaultScene >= loader.Scenes.size()) {
+		return nodes;
+	}
+	std::vector<char> visited(loader.Nodes.size(), 0);
+	std::vector<std::pair<unsigned int, int>> pending;
+	const std::vector<unsigned int>& roots = loader.Scenes[loader.DefaultScene].nodes;
+	for (auto root = roots.rbegin(); root != roots.rend(); ++root) {
+		pending.emplace_back(*root, -1);
+	}
+	while (!pending.empty()) {
+		const unsigned int index = pending.back().first;
+		const int parent = pending.back().second;
+		pending.pop_back();
+		// A node can only have one parent, anything else would loop forever
+		if (index >= loader.Nodes.size() || visited[index]) {
+			continue;
+		}
+		visited[index] = 1;
+
+		const Node& node = loader.Nodes[index];
+		BakedNode baked;
+		baked.mesh = node.mesh ? static_cast<int>(*(node.mesh)) : -1;
+		baked.parent = parent;
+		baked.world = parent < 0 ? node.matrix : nodes[parent].world * node.matrix;
+		nodes.push_back(baked);
+
+		const int bakedIndex = static_cast<int>(nodes.size() - 1);
+		for (auto child = node.children.rbegin(); child != node.children.rend(); ++child) {
+			pending.emplace_back(*child, bakedIndex);
+		}
+	}
+	return nodes;
+}
+
+void getBaseColorTexture(const glTFloader& loader, const Mesh_Primitive& primitive, int& image, Sampler& sampler)
+{
+	if (!primitive.material || *(primitive.material) >= loader.Materials.size()) {
+		return;
+	}
+	const Material& material = loader.Materials[*(primitive.material)];
+	if (material.baseColorTexture && *(material.baseColorTexture) < loader.Textures.size()) {
+		const Texture& texture = loader.Textures[*(material.baseColorTexture)];
+		if (texture.source) {
+			image = static_cast<int>(*(texture.source));
+		}
+		if (texture.sampler && *(texture.sampler) < loader.Samplers.size()) {
+			sampler = loader.Samplers[*(texture.sampler)];
+		}
+	}
+}
+
+bool isDoubleSided(const glTFloader& loader, const Mesh_Primitive& primitive)
+{
+	return primitive.material && *(primitive.material) < loader.Materials.size() && loader.Materials[*(primitive.material)].doubleSided;
+}
+
+std::vector<std::string> getModelDependencies(const glTFloader& loader)
+{
+	std::vector<std::string> dependencies;
+	for (const Buffer& buffer : loader.Buffers) {
+		if (!buffer.uri.empty() && !isDataUri(buffer.uri)) {
+			dependencies.push_back(buffer.uri);
+		}
+	}
+	for (const Image& image : loader.Images) {
+		if (!image.bufferView && !image.uri.empty() && !isDataUri(image.uri)) {
+			dependencies.push_back(image.uri);
+		}
+	}
+	return dependencies;
+}
+
+uint64_t hashModelSources(const std::string& modelPath, const std::string& directory, const std::vector<std::string>& dependencies)
+{
+	MappedFile source;
+	if (!source.Open(modelPath)) {
+		return 0;
+	}
+	uint64_t hash = hash64(source.Data(), source.Size(), BAKED_MODEL_VERSION);
+
+	// The names are part of the key too, a renamed file is a different model
+	for (const std::string& dependency : dependencies) {
+		if (!source.Open(directory + dependency)) {
+			return 0;
+		}
+		hash = hash64(dependency.data(), dependency.size(), hash);
+		hash = hash64(source.Data(), source.Size(), hash);
+	}
+	// 0 means the sources could not be read
+	return hash != 0 ? hash : 1;
+}
+
+bool LoadBakedModel(const std::string& modelPath, const std::string& directory, const std::string& cachePath, BakedModel& model,
+	const LoaderOptions& options, const CacheOptions& cacheOptions, const BakeOptions& bakeOptions)
+{
+	// A current cache is mapped and used as is
+	if (model.Open(cachePath, modelPath, directory, bakeOptions)) {
+		return true;
+	}
+
+	glTFloader loader(modelPath, directory, options);
+	if (options.progress && options.progress->Cancelled()) {
+		return false;
+	}
+	model.Build(loader, bakeOptions);
+
+	// The model is usable even if the cache cannot be written
+	const std::vector<std::string> dependencies = getModelDependencies(loader);
+	const uint64_t sourceHash = hashModelSources(modelPath, directory, dependencies);
+	model.Report.cacheSaveFailed = sourceHash == 0 || !model.Save(cachePath, sourceHash, dependencies, cacheOptions);
+	return true;
+}
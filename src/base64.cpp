@@ -0,0 +1,255 @@
+#include "../include/base64.h"
+#include "../include/cpu_features.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(GLTF_X86)
+#include <immintrin.h>
+#endif
+
+
+// Inputs at least this long are split across threads
+const size_t PARALLEL_THRESHOLD = 1 << 20;
+// The smallest piece of input given to one thread
+const size_t PARALLEL_CHUNK = 256 << 10;
+
+// Maps an input character to its 6-bit value, or 0xFF if it is not part of the alphabet
+struct DecodeTable {
+	uint8_t values[256];
+
+	DecodeTable() {
+		std::memset(values, 0xFF, sizeof(values));
+		const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		for (uint8_t i = 0; i != 64; ++i) {
+			values[static_cast<unsigned char>(alphabet[i])] = i;
+		}
+	}
+};
+
+static const DecodeTable decodeTable;
+
+// Decode whole groups of four characters
+static bool decodeScalar(const unsigned char* in, size_t quads, unsigned char* out)
+{
+	const uint8_t* values = decodeTable.values;
+	uint32_t invalid = 0;
+	for (size_t i = 0; i != quads; ++i, in += 4, out += 3) {
+		const uint32_t a = values[in[0]];
+		const uint32_t b = values[in[1]];
+		const uint32_t c = values[in[2]];
+		const uint32_t d = values[in[3]];
+		// Invalid characters map to 0xFF, checked once at the end
+		invalid |= a | b | c | d;
+		const uint32_t triple = (a << 18) | (b << 12) | (c << 6) | d;
+		out[0] = static_cast<unsigned char>(triple >> 16);
+		out[1] = static_cast<unsigned char>(triple >> 8);
+		out[2] = static_cast<unsigned char>(triple);
+	}
+	return invalid < 64;
+}
+
+#if defined(GLTF_X86)
+
+// Classify and translate 16 characters at once from their nibbles, then pack 16 6-bit values into 12 bytes.
+// Each step stores 16 bytes, so the loop stops while the output still has room for the 4 spare bytes.
+GLTF_TARGET("ssse3")
+static size_t decodeSSSE3(const unsigned char* in, size_t quads, unsigned char* out, bool& valid)
+{
+	const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+	const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i nibble = _mm_set1_epi8(0x0F);
+	const __m128i slash = _mm_set1_epi8(0x2F);
+	const __m128i packPairs = _mm_set1_epi32(0x01400140);
+	const __m128i packQuads = _mm_set1_epi32(0x00011000);
+	const __m128i order = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+	size_t done = 0;
+	for (; done + 6 <= quads; done += 4, in += 16, out += 12) {
+		const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+		const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(chars, 4), nibble);
+		const __m128i loNibbles = _mm_and_si128(chars, nibble);
+		const __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+		const __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+		if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0) {
+			valid = false;
+			return done;
+		}
+		const __m128i isSlash = _mm_cmpeq_epi8(chars, slash);
+		const __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(isSlash, hiNibbles));
+		const __m128i values = _mm_add_epi8(chars, roll);
+
+		const __m128i pairs = _mm_maddubs_epi16(values, packPairs);
+		const __m128i packed = _mm_madd_epi16(pairs, packQuads);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(packed, order));
+	}
+	return done;
+}
+
+// The AVX2 version of decodeSSSE3, 32 characters into 24 bytes with 8 spare bytes per store
+GLTF_TARGET("avx2")
+static size_t decodeAVX2(const unsigned char* in, size_t quads, unsigned char* out, bool& valid)
+{
+	const __m256i lutLo = _mm256_setr_epi8(
+		0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+		0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+	const __m256i lutHi = _mm256_setr_epi8(
+		0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+		0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m256i lutRoll = _mm256_setr_epi8(
+		0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i nibble = _mm256_set1_epi8(0x0F);
+	const __m256i slash = _mm256_set1_epi8(0x2F);
+	const __m256i packPairs = _mm256_set1_epi32(0x01400140);
+	const __m256i packQuads = _mm256_set1_epi32(0x00011000);
+	const __m256i order = _mm256_setr_epi8(
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+	size_t done = 0;
+	for (; done + 11 <= quads; done += 8, in += 32, out += 24) {
+		const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+		const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(chars, 4), nibble);
+		const __m256i loNibbles = _mm256_and_si256(chars, nibble);
+		const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+		const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+		if (!_mm256_testz_si256(lo, hi)) {
+			valid = false;
+			return done;
+		}
+		const __m256i isSlash = _mm256_cmpeq_epi8(chars, slash);
+		const __m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(isSlash, hiNibbles));
+		const __m256i values = _mm256_add_epi8(chars, roll);
+
+		const __m256i pairs = _mm256_maddubs_epi16(values, packPairs);
+		const __m256i packed = _mm256_madd_epi16(pairs, packQuads);
+		const __m256i ordered = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(packed, order), lanes);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), ordered);
+	}
+	return done;
+}
+
+#endif
+
+// Decode whole groups of four characters with the widest kernel the CPU supports
+static bool decodeQuads(const unsigned char* in, size_t quads, unsigned char* out)
+{
+	size_t done = 0;
+	bool valid = true;
+#if defined(GLTF_X86)
+	const CpuFeatures& features = getCpuFeatures();
+	if (features.avx2) {
+		done = decodeAVX2(in, quads, out, valid);
+	}
+	if (valid && features.ssse3) {
+		done += decodeSSSE3(in + done * 4, quads - done, out + done * 3, valid);
+	}
+	if (!valid) {
+		return false;
+	}
+#endif
+	return decodeScalar(in + done * 4, quads - done, out + done * 3);
+}
+
+size_t base64DecodedSize(const char* text, size_t length)
+{
+	if (length % 4 == 1) {
+		return 0;
+	}
+	size_t padding = 0;
+	if (length % 4 == 0 && length >= 4) {
+		padding = (text[length - 1] == '=') + (text[length - 2] == '=');
+	}
+	return length / 4 * 3 + (length % 4 ? length % 4 - 1 : 0) - padding;
+}
+
+bool base64Decode(const char* text, size_t length, unsigned char* out)
+{
+	if (length % 4 == 1) {
+		return false;
+	}
+	const unsigned char* in = reinterpret_cast<const unsigned char*>(text);
+
+	// The last group may be padded or short, every group before it is a plain quad
+	size_t tailLength = length % 4 ? length % 4 : std::min<size_t>(length, 4);
+	const size_t quads = (length - tailLength) / 4;
+
+	bool valid = true;
+	const unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	if (length >= PARALLEL_THRESHOLD && hardwareThreads > 1) {
+		const size_t chunks = std::min<size_t>(hardwareThreads, length / PARALLEL_CHUNK);
+		const size_t quadsPerChunk = (quads + chunks - 1) / chunks;
+		std::vector<std::thread> workers;
+		std::vector<char> results(chunks, 1);
+		for (size_t chunk = 0; chunk != chunks; ++chunk) {
+			const size_t first = chunk * quadsPerChunk;
+			const size_t count = std::min(quadsPerChunk, quads - std::min(quads, first));
+			workers.emplace_back([&results, chunk, in, out, first, count]() {
+				results[chunk] = decodeQuads(in + first * 4, count, out + first * 3);
+			});
+		}
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+		valid = std::all_of(results.begin(), results.end(), [](char result) { return result != 0; });
+	}
+	else {
+		valid = decodeQuads(in, quads, out);
+	}
+	if (!valid) {
+		return false;
+	}
+
+	if (tailLength == 0) {
+		return true;
+	}
+
+	// Decode the last group through a padded copy, writing only the bytes it really holds
+	unsigned char tail[4] = { 'A', 'A', 'A', 'A' };
+	std::memcpy(tail, in + quads * 4, tailLength);
+	while (tailLength > 2 && tail[tailLength - 1] == '=') {
+		tail[--tailLength] = 'A';
+	}
+	if (tailLength < 2) {
+		return false;
+	}
+	unsigned char bytes[3];
+	if (!decodeScalar(tail, 1, bytes)) {
+		return false;
+	}
+	std::memcpy(out + quads * 3, bytes, tailLength - 1);
+	return true;
+}
+
+bool isDataUri(const std::string& uri)
+{
+	return uri.compare(0, 5, "data:") == 0;
+}
+
+bool parseDataUri(const std::string& uri, std::string& mediaType, const char*& payload, size_t& payloadLength)
+{
+	if (!isDataUri(uri)) {
+		return false;
+	}
+	const size_t comma = uri.find(',');
+	if (comma == std::string::npos) {
+		return false;
+	}
+
+	// data:[<media type>][;base64],<data>
+	const std::string base64 = ";base64";
+	if (comma < 5 + base64.size() || uri.compare(comma - base64.size(), base64.size(), base64) != 0) {
+		return false;
+	}
+
+	mediaType = uri.substr(5, comma - base64.size() - 5);
+	payload = uri.data() + comma + 1;
+	payloadLength = uri.size() - comma - 1;
+	return true;
+}
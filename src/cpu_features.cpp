@@ -0,0 +1,88 @@
+#include "../include/cpu_features.h"
+
+#if defined(GLTF_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+
+#if defined(GLTF_X86)
+
+static void cpuid(int leaf, int subleaf, unsigned int registers[4])
+{
+#if defined(_MSC_VER)
+	int values[4];
+	__cpuidex(values, leaf, subleaf);
+	for (int i = 0; i != 4; ++i) {
+		registers[i] = static_cast<unsigned int>(values[i]);
+	}
+#else
+	__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// The register state the OS saves on context switches
+static unsigned long long xgetbv()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+
+static CpuFeatures detectCpuFeatures()
+{
+	CpuFeatures features;
+	unsigned int registers[4];
+
+	cpuid(0, 0, registers);
+	const unsigned int maxLeaf = registers[0];
+	if (maxLeaf < 1) {
+		return features;
+	}
+
+	cpuid(1, 0, registers);
+	features.ssse3 = (registers[2] & (1u << 9)) != 0;
+	features.sse41 = (registers[2] & (1u << 19)) != 0;
+	const bool f16c = (registers[2] & (1u << 29)) != 0;
+
+	// AVX state has to be enabled by the OS as well as supported by the CPU
+	const bool osxsave = (registers[2] & (1u << 27)) != 0;
+	if (!osxsave) {
+		return features;
+	}
+	const unsigned long long xcr0 = xgetbv();
+	const bool ymmEnabled = (xcr0 & 0x6) == 0x6;
+	const bool zmmEnabled = (xcr0 & 0xE6) == 0xE6;
+	features.f16c = ymmEnabled && f16c;
+	if (maxLeaf < 7) {
+		return features;
+	}
+
+	cpuid(7, 0, registers);
+	features.avx2 = ymmEnabled && (registers[1] & (1u << 5)) != 0;
+	features.avx512 = zmmEnabled && (registers[1] & (1u << 16)) != 0 && (registers[1] & (1u << 30)) != 0;
+
+	return features;
+}
+
+#else
+
+static CpuFeatures detectCpuFeatures()
+{
+	return CpuFeatures();
+}
+
+#endif
+
+const CpuFeatures& getCpuFeatures()
+{
+	static const CpuFeatures features = detectCpuFeatures();
+	return features;
+}
@@ -1,78 +1,185 @@
 #include "../include/glTF_loader.h"
+#include "../include/accessor_decode.h"
+#include "../include/base64.h"
+#include "../include/glTF_parser.h"
+#include "../include/meshopt_decode.h"
+#include "../include/thread_pool.h"
 
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <limits>
 
-// A map of GPU buffer types and their respective key
-std::unordered_map<unsigned int, GLenum> BufferTargets = {
-	{34962, GL_ARRAY_BUFFER},
-	{34963, GL_ELEMENT_ARRAY_BUFFER}
-};
+#include "stb_image.h"
+
+
+// How often the parse reports its progress, in bytes of JSON
+const size_t PARSE_PROGRESS_STEP = 64 << 10;
 
+// The seconds elapsed since start, which then moves to now
+static double lap(std::chrono::steady_clock::time_point& start)
+{
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	const double seconds = std::chrono::duration<double>(now - start).count();
+	start = now;
+	return seconds;
+}
 
-// A Map of component types along with their respective keys
-std::unordered_map<unsigned int,GLenum> ComponentTypes = {
-	{5120, GL_BYTE},
-	{5122, GL_SHORT},
-	{5123, GL_UNSIGNED_SHORT},
-	{5125, GL_UNSIGNED_INT},
-	{5126, GL_FLOAT}
+// Walks the JSON text like a plain pointer and reports the bytes consumed to the load's progress
+struct ProgressIterator {
+	using iterator_category = std::input_iterator_tag;
+	using value_type = unsigned char;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const unsigned char*;
+	using reference = const unsigned char&;
+
+	const unsigned char* current;
+	const unsigned char* reported;
+	LoadProgress* progress;
+
+	reference operator*() const { return *current; }
+	bool operator==(const ProgressIterator& other) const { return current == other.current; }
+	bool operator!=(const ProgressIterator& other) const { return current != other.current; }
+	ProgressIterator& operator++() {
+		if (static_cast<size_t>(++current - reported) >= PARSE_PROGRESS_STEP) {
+			progress->Advance(LOAD_PARSE, current - reported);
+			reported = current;
+		}
+		return *this;
+	}
 };
 
-// A Map of primitives and thir respective keys
-std::unordered_map<unsigned int, GLenum> PrimitiveTypes = {
-	{0, GL_POINTS},
-	{1, GL_LINES},
-	{2, GL_LINE_LOOP},
-	{3, GL_LINE_STRIP},
-	{4, GL_TRIANGLES},
-	{5, GL_TRIANGLE_STRIP},
-	{6, GL_TRIANGLE_FAN}
+// The buffer reads and image decodes running while a model loads.
+// Every task writes only to the slot of its own buffer or image, so the result never depends on scheduling.
+struct LoadQueue {
+	LoadProgress* progress;                 // Null when nobody follows the load
+	ByteBudget budget;
+	std::deque<std::future<void>> buffers;  // Indexed like Buffers
+	std::deque<char> buffersLoaded;         // Indexed like Buffers
+	std::deque<std::future<void>> images;   // Indexed like Images
+	std::deque<char> imagesLoaded;          // Indexed like Images
+	// Declared last so its workers are joined before the slots they write to are destroyed
+	ThreadPool pool;
+
+	explicit LoadQueue(const LoaderOptions& options)
+		: progress(options.progress.get()), budget(options.maxBytesInFlight), pool(options.workerCount)
+	{
+	}
+
+	bool Cancelled() const { return progress != nullptr && progress->Cancelled(); }
+	void AddTotal(LoadStage stage, size_t amount) { if (progress != nullptr) progress->AddTotal(stage, amount); }
+	void Advance(LoadStage stage, size_t amount = 1) { if (progress != nullptr) progress->Advance(stage, amount); }
 };
 
-glTFloader::glTFloader(const std::string& modelPath, const std::string& directory)
+glTFloader::glTFloader(const std::string& modelPath, const std::string& directory, const LoaderOptions& options)
+	: directory(directory), options(options)
 {
+	std::chrono::steady_clock::time_point stageStart = std::chrono::steady_clock::now();
 	try {
-		// Open file
-		std::ifstream file(modelPath);
-		if (!file.is_open()) {
+		// Open file, the whole file is read or mapped once
+		if (!readFile(modelPath, container)) {
 			std::cout << "Failed to open file at " << modelPath;
+			return;
 		}
 
-		// Parse file
-		json JSON = json::parse(file);
+		// Find the JSON document, a GLB container carries it in its first chunk
+		const unsigned char* jsonData = container.data;
+		size_t jsonLength = container.size;
+		if (container.size >= sizeof(uint32_t) && std::memcmp(container.data, "glTF", 4) == 0) {
+			if (!parseGLB(jsonData, jsonLength, modelPath)) {
+				return;
+			}
+		}
 
-		// Close file
-		file.close();
+		Timings.read = lap(stageStart);
+
+		// Parse file, the tables are filled as the tokens arrive and every buffer
+		// or standalone image starts loading on the pool as soon as it is parsed
+		LoadQueue queue(options);
+		queue.AddTotal(LOAD_PARSE, jsonLength);
+		glTFparser parser(*this);
+		parser.Progress = queue.progress;
+		parser.BufferParsed = [this, &queue](unsigned int buffer) {
+			scheduleBuffer(queue, buffer);
+		};
+		parser.ImageParsed = [this, &queue](unsigned int image) {
+			// Images inside buffer views have to wait for their buffer
+			if (!Images[image].bufferView) {
+				scheduleImage(queue, image);
+			}
+		};
+		bool parsed;
+		if (queue.progress != nullptr) {
+			const ProgressIterator first{ jsonData, jsonData, queue.progress };
+			const ProgressIterator last{ jsonData + jsonLength, jsonData + jsonLength, queue.progress };
+			parsed = json::sax_parse(first, last, &parser);
+		}
+		else {
+			parsed = json::sax_parse(jsonData, jsonData + jsonLength, &parser);
+		}
+		if (!parsed) {
+			if (!queue.Cancelled()) {
+				std::cout << "Failed to parse " << modelPath << ": " << parser.Error() << std::endl;
+			}
+			return;
+		}
+		queue.Advance(LOAD_PARSE, jsonLength % PARSE_PROGRESS_STEP);
+		Timings.parse = lap(stageStart);
 
-		if (!JSON.is_null()) {
-			// Load accessors
-			if (JSON.contains("accessors")) {
-				loadAccessors(JSON["accessors"]);
+		// Load binary geometry, failures are reported in buffer order once every read is done
+		for (unsigned int buffer = 0; buffer != Buffers.size(); ++buffer) {
+			if (buffer >= queue.buffers.size() || !queue.buffers[buffer].valid()) {
+				scheduleBuffer(queue, buffer);
 			}
-			// Load buffer views
-			if (JSON.contains("bufferViews")) {
-				loadBufferViews(JSON["bufferViews"]);
+		}
+		for (unsigned int buffer = 0; buffer != Buffers.size(); ++buffer) {
+			queue.buffers[buffer].get();
+		}
+		Timings.buffers = lap(stageStart);
+		if (queue.Cancelled()) {
+			return;
+		}
+		for (unsigned int buffer = 0; buffer != Buffers.size(); ++buffer) {
+			if (!queue.buffersLoaded[buffer]) {
+				std::cout << "Failed to load buffer " << buffer << ": " << Buffers[buffer].uri << std::endl;
 			}
-			// Load buffers
-			if (JSON.contains("buffers")) {
-				loadBuffers(JSON["buffers"]);
-				// Load binary geometry
-				for (const auto& buffer : Buffers) {
-					std::ifstream binFile(directory + buffer.second.uri, std::ios::binary);
-					if (binFile.is_open()) {
-						loadBinaryGeometry(binFile, buffer.first);
-						binFile.close();
-					}
-					else {
-						std::cout << "failed to open file";
-					}
-				}
+			else if (binaryGeometry[buffer].size < Buffers[buffer].byteLength) {
+				std::cout << "Buffer " << buffer << " is shorter than its byteLength" << std::endl;
 			}
-			// Load meshes
-			if (JSON.contains("meshes")) {
-				loadMeshes(JSON["meshes"]);
+		}
+
+		// Decompress EXT_meshopt_compression buffer views into their fallback buffers
+		decodeCompressedViews(queue);
+		Timings.decompress = lap(stageStart);
+		if (queue.Cancelled()) {
+			return;
+		}
+
+		// Images stored in buffer views can start now, the accessors are validated meanwhile
+		imageData.resize(Images.size());
+		imagePixels.resize(Images.size());
+		for (unsigned int image = 0; image != Images.size(); ++image) {
+			if (image >= queue.images.size() || !queue.images[image].valid()) {
+				scheduleImage(queue, image);
 			}
 		}
 
+		// Validate every accessor against the loaded buffers once
+		createAccessorViews();
+		Timings.views = lap(stageStart);
+
+		for (unsigned int image = 0; image != Images.size(); ++image) {
+			queue.images[image].get();
+		}
+		Timings.images = lap(stageStart);
+		if (queue.Cancelled()) {
+			return;
+		}
+		for (unsigned int image = 0; image != Images.size(); ++image) {
+			if (!queue.imagesLoaded[image]) {
+				std::cout << "Failed to load image " << image << std::endl;
+			}
+		}
 	}
 	catch (json::exception e) {
 		std::cout << e.what();
@@ -81,196 +188,533 @@ glTFloader::glTFloader(const std::string& modelPath, const std::string& director
 		std::cout << e.what();
 	}
 }
- 
-std::vector<unsigned char> glTFloader::GetData(Accessor& accessor)
-{
-	// Get the buffer view of the given accessor
-	unsigned int bufferViewIndex = accessor.bufferView;
-	BufferView bufferView = BufferViews[bufferViewIndex];
-
-	// Get the buffer of the buffer view
-	unsigned int bufferIndex = bufferView.buffer;
-
 
-	// Get the buffer data
-    std::vector<unsigned char> data;
-	for (int i = bufferView.byteOffset + accessor.byteOffset; i != (bufferView.byteLength + bufferView.byteOffset); ++i) {
-		data.push_back(binaryGeometry[bufferIndex][i]);
+void glTFloader::scheduleBuffer(LoadQueue& queue, unsigned int buffer)
+{
+	if (buffer >= binaryGeometry.size()) {
+		binaryGeometry.resize(buffer + 1);
+		queue.buffers.resize(buffer + 1);
+		queue.buffersLoaded.resize(buffer + 1, 0);
+	}
+	BufferData& bufferData = binaryGeometry[buffer];
+	char& loaded = queue.buffersLoaded[buffer];
+	Buffer& source = Buffers[buffer];
+	queue.AddTotal(LOAD_BUFFERS, source.byteLength);
+
+	// A fallback buffer is never read, its compressed buffer views are decoded into it once every buffer is loaded
+	if (source.fallback) {
+		const size_t byteLength = source.byteLength;
+		queue.buffers[buffer] = queue.pool.Submit([&queue, &bufferData, &loaded, byteLength]() {
+			if (queue.Cancelled()) {
+				return;
+			}
+			ByteReservation reservation(queue.budget, byteLength);
+			bufferData.owned.resize(byteLength);
+			bufferData.data = bufferData.owned.data();
+			bufferData.size = bufferData.owned.size();
+			loaded = 1;
+			queue.Advance(LOAD_BUFFERS, byteLength);
+		});
+	}
+	// The first buffer of a GLB file without a URI is its BIN chunk
+	else if (buffer == 0 && source.uri.empty() && binaryChunk != nullptr) {
+		bufferData.data = binaryChunk;
+		bufferData.size = binaryChunkLength;
+		loaded = 1;
+		queue.Advance(LOAD_BUFFERS, source.byteLength);
+		std::promise<void> done;
+		done.set_value();
+		queue.buffers[buffer] = done.get_future();
+	}
+	else if (isDataUri(source.uri)) {
+		// The task takes the payload, the table keeps only the header
+		std::string uri = std::move(source.uri);
+		source.uri = uri.substr(0, uri.find(',') + 1);
+		const size_t cost = source.byteLength;
+		queue.buffers[buffer] = queue.pool.Submit([this, &queue, &bufferData, &loaded, uri = std::move(uri), cost]() {
+			if (queue.Cancelled()) {
+				return;
+			}
+			ByteReservation reservation(queue.budget, cost);
+			std::string mediaType;
+			loaded = decodeDataUri(uri, mediaType, bufferData);
+			queue.Advance(LOAD_BUFFERS, cost);
+		});
+	}
+	else {
+		// A mapped file is paged in by the kernel, only reads into owned memory count against the budget
+		const size_t cost = options.memoryMapBuffers ? 0 : source.byteLength;
+		queue.buffers[buffer] = queue.pool.Submit([this, &queue, &bufferData, &loaded, path = directory + source.uri, byteLength = source.byteLength, cost]() {
+			if (queue.Cancelled()) {
+				return;
+			}
+			ByteReservation reservation(queue.budget, cost);
+			loaded = readFile(path, bufferData);
+			queue.Advance(LOAD_BUFFERS, byteLength);
+		});
 	}
-	
-	return data;
-
 }
 
-void glTFloader::loadAccessors(const json& jAccessors)
+void glTFloader::scheduleImage(LoadQueue& queue, unsigned int image)
 {
-	unsigned int key = 0;
-	for (const auto& jAccessor : jAccessors) {
-		Accessor accessor;
-		
-		if (jAccessor.contains("bufferView")) {
-			accessor.bufferView = jAccessor["bufferView"];
+	if (image >= imageData.size()) {
+		imageData.resize(image + 1);
+		imagePixels.resize(image + 1);
+	}
+	if (image >= queue.images.size()) {
+		queue.images.resize(image + 1);
+		queue.imagesLoaded.resize(image + 1, 0);
+	}
+	BufferData& bytes = imageData[image];
+	ImagePixels& pixels = imagePixels[image];
+	char& loaded = queue.imagesLoaded[image];
+
+	Image& record = Images[image];
+	Image source;
+	source.mimeType = record.mimeType;
+	source.bufferView = record.bufferView;
+	if (isDataUri(record.uri)) {
+		// The task takes the payload, the table keeps only the header
+		source.uri = std::move(record.uri);
+		record.uri = source.uri.substr(0, source.uri.find(',') + 1);
+	}
+	else {
+		source.uri = record.uri;
+	}
+	queue.AddTotal(LOAD_IMAGES, 1);
+	queue.images[image] = queue.pool.Submit([this, &queue, &bytes, &pixels, &loaded, source = std::move(source)]() {
+		if (queue.Cancelled()) {
+			return;
 		}
-
-		if (jAccessor.contains("byteOffset")) {
-			accessor.byteOffset = jAccessor["byteOffset"];
+		bool result;
+		{
+			ByteReservation reservation(queue.budget, isDataUri(source.uri) ? source.uri.size() / 4 * 3 : 0);
+			result = loadImageBytes(source, bytes);
 		}
-
-		if (jAccessor.contains("componentType")) {
-			accessor.componentType = ComponentTypes[jAccessor["componentType"]];
+		if (result && options.decodeImages) {
+			result = decodeImage(bytes, pixels, queue);
 		}
+		loaded = result;
+		queue.Advance(LOAD_IMAGES);
+	});
+}
 
-		if (jAccessor.contains("normalized")) {
-			accessor.normalized = jAccessor["normalized"];
+void glTFloader::decodeCompressedViews(LoadQueue& queue)
+{
+	// Views over a buffer that was loaded already hold the uncompressed bytes, only fallback buffers need decoding.
+	// Each view writes its own range of its fallback buffer, so the views decode in parallel.
+	std::vector<std::future<void>> decodes(BufferViews.size());
+	std::vector<char> decoded(BufferViews.size(), 0);
+	for (unsigned int index = 0; index != BufferViews.size(); ++index) {
+		const BufferView& bufferView = BufferViews[index];
+		if (!bufferView.meshopt || bufferView.buffer >= Buffers.size() || !Buffers[bufferView.buffer].fallback) {
+			continue;
 		}
-
-		if (jAccessor.contains("count")) {
-			accessor.count = jAccessor["count"];
+		const Meshopt_Compression& compression = *bufferView.meshopt;
+		if (compression.buffer >= binaryGeometry.size() || !queue.buffersLoaded[compression.buffer] || !queue.buffersLoaded[bufferView.buffer]) {
+			continue;
 		}
-
-		if (jAccessor.contains("type")) {
-			accessor.type = jAccessor["type"];
+		const BufferData& source = binaryGeometry[compression.buffer];
+		BufferData& target = binaryGeometry[bufferView.buffer];
+		if (compression.byteOffset > source.size || compression.byteLength > source.size - compression.byteOffset ||
+			compression.count > bufferView.byteLength / std::max<size_t>(compression.byteStride, 1) ||
+			bufferView.byteOffset > target.owned.size() || bufferView.byteLength > target.owned.size() - bufferView.byteOffset) {
+			continue;
 		}
 
-		if (jAccessor.contains("max")) {
-			for (int i = 0; i != jAccessor["max"].size(); ++i) {
-				accessor.max.push_back(
-					jAccessor["max"][i]
-				);
+		const unsigned char* data = source.data + compression.byteOffset;
+		unsigned char* out = target.owned.data() + bufferView.byteOffset;
+		char& result = decoded[index];
+		decodes[index] = queue.pool.Submit([&queue, &compression, data, out, &result]() {
+			if (!queue.Cancelled()) {
+				result = decodeMeshoptView(compression, data, out);
 			}
-		}
+		});
+	}
 
-		if (jAccessor.contains("min")) {
-			for (int i = 0; i != jAccessor["min"].size(); ++i) {
-				accessor.min.push_back(
-					jAccessor["min"][i]
-				);
-			}
+	for (unsigned int index = 0; index != BufferViews.size(); ++index) {
+		if (decodes[index].valid()) {
+			decodes[index].get();
 		}
+	}
+	if (queue.Cancelled()) {
+		return;
+	}
+	for (unsigned int index = 0; index != BufferViews.size(); ++index) {
+		const BufferView& bufferView = BufferViews[index];
+		if (bufferView.meshopt && bufferView.buffer < Buffers.size() && Buffers[bufferView.buffer].fallback && !decoded[index]) {
+			std::cout << "Failed to decode compressed buffer view " << index << std::endl;
+		}
+	}
+}
 
-		Accessors[key++] = accessor;
+void PixelDeleter::operator()(unsigned char* pixels) const
+{
+	stbi_image_free(pixels);
+}
+
+bool glTFloader::decodeImage(const BufferData& bytes, ImagePixels& image, LoadQueue& queue)
+{
+	if (bytes.size > static_cast<size_t>(std::numeric_limits<int>::max())) {
+		return false;
+	}
+	const stbi_uc* encoded = bytes.data;
+	const int length = static_cast<int>(bytes.size);
+
+	// Reserve the decoded size up front, the header is enough to know it
+	int width, height, channels;
+	if (!stbi_info_from_memory(encoded, length, &width, &height, &channels)) {
+		return false;
+	}
+	ByteReservation reservation(queue.budget, static_cast<size_t>(width) * height * channels);
+
+	image.pixels.reset(stbi_load_from_memory(encoded, length, &image.width, &image.height, &image.channels, 0));
+	return image.pixels != nullptr;
+}
+ 
+const AccessorView& glTFloader::GetView(unsigned int accessor) const
+{
+	static const AccessorView empty;
+	if (accessor >= accessorViews.size()) {
+		return empty;
+	}
+	if (needsExpanding[accessor]) {
+		std::call_once(expanded[accessor], [this, accessor]() { expandAccessor(accessor); });
 	}
+	return accessorViews[accessor];
 }
 
-void glTFloader::loadBufferViews(const json& jBufferViews) {
-	unsigned int key = 0;
-	for (const auto& jBufferView : jBufferViews) {
-		BufferView bufferView;
+const SparseAccessorView& glTFloader::GetSparseView(unsigned int accessor) const
+{
+	static const SparseAccessorView empty;
+	if (accessor >= sparseViews.size()) {
+		return empty;
+	}
+	return sparseViews[accessor];
+}
 
-		if (jBufferView.contains("buffer")) {
-			bufferView.buffer = jBufferView["buffer"];
-		}
+bool glTFloader::GetImageBytes(unsigned int image, const unsigned char*& data, size_t& size)
+{
+	if (image >= imageData.size()) {
+		return false;
+	}
+	BufferData& bytes = imageData[image];
 
-		if (jBufferView.contains("byteOffset")) {
-			bufferView.byteOffset = jBufferView["byteOffset"];
-		}
+	if (bytes.data == nullptr && !loadImageBytes(Images[image], bytes)) {
+		return false;
+	}
+
+	data = bytes.data;
+	size = bytes.size;
+	return true;
+}
+
+const ImagePixels& glTFloader::GetImagePixels(unsigned int image) const
+{
+	static const ImagePixels empty;
+	if (image >= imagePixels.size()) {
+		return empty;
+	}
+	return imagePixels[image];
+}
 
-		if (jBufferView.contains("byteLength")) {
-			bufferView.byteLength = jBufferView["byteLength"];
+bool glTFloader::GetBufferViewBytes(unsigned int bufferView, const unsigned char*& data, size_t& size) const
+{
+	if (bufferView >= BufferViews.size()) {
+		return false;
+	}
+	const BufferView& view = BufferViews[bufferView];
+	if (view.buffer >= binaryGeometry.size() || binaryGeometry[view.buffer].data == nullptr ||
+		view.byteOffset > binaryGeometry[view.buffer].size || view.byteLength > binaryGeometry[view.buffer].size - view.byteOffset) {
+		return false;
+	}
+	data = binaryGeometry[view.buffer].data + view.byteOffset;
+	size = view.byteLength;
+	return true;
+}
+
+bool glTFloader::loadImageBytes(const Image& source, BufferData& bytes)
+{
+	if (source.bufferView) {
+		// Embedded in a buffer, typically the BIN chunk of a GLB file
+		return GetBufferViewBytes(*source.bufferView, bytes.data, bytes.size);
+	}
+	if (isDataUri(source.uri)) {
+		std::string mediaType;
+		return decodeDataUri(source.uri, mediaType, bytes);
+	}
+	return readFile(directory + source.uri, bytes);
+}
+
+void glTFloader::createAccessorViews()
+{
+	accessorViews.assign(Accessors.size(), AccessorView());
+	sparseViews.assign(Accessors.size(), SparseAccessorView());
+	needsExpanding.assign(Accessors.size(), false);
+	expanded.reset(new std::once_flag[Accessors.size()]);
+	expandedData.assign(Accessors.size(), std::vector<unsigned char>());
+
+	for (unsigned int index = 0; index != Accessors.size(); ++index) {
+		const Accessor& accessor = Accessors[index];
+		if (accessor.count == 0) {
+			continue;
 		}
 
-		if (jBufferView.contains("byteStride")) {
-			bufferView.byteStride = jBufferView["byteStride"];
+		AccessorView view;
+		view.count = accessor.count;
+		view.componentType = accessor.componentType;
+		view.normalized = accessor.normalized;
+		view.numComponents = getNumComponents(accessor.type);
+		view.elementSize = getElementSize(accessor.type, accessor.componentType);
+		view.stride = view.elementSize;
+		if (accessor.bufferView && !bindView(index, "", *(accessor.bufferView), accessor.byteOffset, false, view)) {
+			continue;
 		}
 
-		if (jBufferView.contains("target")) {
-			bufferView.target = BufferTargets[jBufferView["target"]];
+		SparseAccessorView sparseView;
+		sparseView.base = view;
+		if (accessor.sparse) {
+			const Accessor_Sparse& sparse = *(accessor.sparse);
+			const GLenum indexType = sparse.indicesComponentType;
+			if (indexType != GL_UNSIGNED_BYTE && indexType != GL_UNSIGNED_SHORT && indexType != GL_UNSIGNED_INT) {
+				std::cout << "Accessor " << index << " has sparse indices that are not unsigned integers" << std::endl;
+				continue;
+			}
+			if (sparse.count > accessor.count) {
+				std::cout << "Accessor " << index << " replaces more elements than it has" << std::endl;
+				continue;
+			}
+
+			sparseView.indices.count = sparse.count;
+			sparseView.indices.componentType = indexType;
+			sparseView.indices.numComponents = 1;
+			sparseView.indices.elementSize = getComponentTypeSize(indexType);
+			sparseView.indices.stride = sparseView.indices.elementSize;
+			sparseView.values = view;
+			sparseView.values.data = nullptr;
+			sparseView.values.count = sparse.count;
+			sparseView.values.stride = view.elementSize;
+			if (sparse.count != 0 &&
+				(!bindView(index, " sparse indices", sparse.indicesBufferView, sparse.indicesByteOffset, true, sparseView.indices) ||
+				!bindView(index, " sparse values", sparse.valuesBufferView, sparse.valuesByteOffset, true, sparseView.values))) {
+				continue;
+			}
 		}
+		sparseViews[index] = sparseView;
 
-		BufferViews[key++] = bufferView;
+		if (accessor.bufferView && !accessor.sparse) {
+			accessorViews[index] = view;
+		}
+		else {
+			needsExpanding[index] = true;
+		}
 	}
 }
 
-void glTFloader::loadBuffers(const json& jBuffers) {
-	unsigned int key = 0;
-	for (const auto& jBuffer : jBuffers) {
-		Buffer buffer;
+bool glTFloader::bindView(unsigned int accessor, const char* part, unsigned int bufferViewIndex, size_t byteOffset, bool packed, AccessorView& view) const
+{
+	if (bufferViewIndex >= BufferViews.size()) {
+		std::cout << "Accessor " << accessor << part << " has no valid buffer view" << std::endl;
+		return false;
+	}
+	const BufferView& bufferView = BufferViews[bufferViewIndex];
+	if (bufferView.buffer >= binaryGeometry.size() || binaryGeometry[bufferView.buffer].data == nullptr) {
+		std::cout << "Accessor " << accessor << part << " refers to a buffer that is not loaded" << std::endl;
+		return false;
+	}
+	const BufferData& buffer = binaryGeometry[bufferView.buffer];
+	if (!packed && bufferView.byteStride != 0) {
+		view.stride = bufferView.byteStride;
+	}
+
+	// The last element has to end inside the buffer view, and the buffer view inside the buffer
+	const size_t viewEnd = bufferView.byteOffset + bufferView.byteLength;
+	if (view.elementSize == 0 || viewEnd > buffer.size ||
+		view.count - 1 > bufferView.byteLength / view.stride ||
+		byteOffset + view.stride * (view.count - 1) + view.elementSize > bufferView.byteLength) {
+		std::cout << "Accessor " << accessor << part << " is out of the bounds of its buffer view" << std::endl;
+		return false;
+	}
 
-		if (jBuffer.contains("uri")) {
-			buffer.uri = jBuffer["uri"];
+	view.data = buffer.data + bufferView.byteOffset + byteOffset;
+	return true;
+}
+
+// Copy the replacing elements over the expanded ones, with fixed-size copies for the common element sizes.
+// Returns the number of indices that fall outside the accessor.
+template<size_t Size>
+static size_t scatterElements(unsigned char* elements, size_t count, size_t elementSize, const uint32_t* indices, const unsigned char* values, size_t replaced)
+{
+	const size_t size = Size != 0 ? Size : elementSize;
+	size_t outside = 0;
+	for (size_t i = 0; i != replaced; ++i) {
+		if (indices[i] >= count) {
+			++outside;
+			continue;
 		}
+		std::memcpy(elements + indices[i] * size, values + i * size, size);
+	}
+	return outside;
+}
 
-		if (jBuffer.contains("byteLength")) {
-			buffer.byteLength = jBuffer["byteLength"];
+void glTFloader::expandAccessor(unsigned int accessor) const
+{
+	const SparseAccessorView& sparse = sparseViews[accessor];
+	const AccessorView& base = sparse.base;
+	const size_t elementSize = base.elementSize;
+
+	// Start from a packed copy of the buffer view, or from zeros
+	std::vector<unsigned char>& elements = expandedData[accessor];
+	elements.resize(base.count * elementSize);
+	if (base.data != nullptr && base.packed()) {
+		std::memcpy(elements.data(), base.data, elements.size());
+	}
+	else if (base.data != nullptr) {
+		for (size_t i = 0; i != base.count; ++i) {
+			std::memcpy(elements.data() + i * elementSize, base[i], elementSize);
 		}
+	}
 
-		Buffers[key++] = buffer;
+	if (!sparse.indices.empty()) {
+		std::vector<uint32_t> indices(sparse.indices.count);
+		decodeAccessor(sparse.indices, DECODE_INTEGER, indices.data());
+
+		unsigned char* out = elements.data();
+		const unsigned char* values = sparse.values.data;
+		size_t outside;
+		switch (elementSize) {
+		case 4:  outside = scatterElements<4>(out, base.count, elementSize, indices.data(), values, indices.size()); break;
+		case 8:  outside = scatterElements<8>(out, base.count, elementSize, indices.data(), values, indices.size()); break;
+		case 12: outside = scatterElements<12>(out, base.count, elementSize, indices.data(), values, indices.size()); break;
+		case 16: outside = scatterElements<16>(out, base.count, elementSize, indices.data(), values, indices.size()); break;
+		default: outside = scatterElements<0>(out, base.count, elementSize, indices.data(), values, indices.size()); break;
+		}
+		if (outside != 0) {
+			std::cout << "Accessor " << accessor << " has " << outside << " sparse indices outside of it" << std::endl;
+		}
 	}
+
+	AccessorView view = base;
+	view.data = elements.data();
+	view.stride = elementSize;
+	accessorViews[accessor] = view;
 }
 
-void glTFloader::loadMeshes(const json& jMeshes)
+bool glTFloader::readFile(const std::string& path, BufferData& bufferData)
 {
-	unsigned int index = 0;
-	for (const auto& jMesh : jMeshes) {
-		Mesh mesh;
-		// Primitives
-		if (jMesh.contains("primitives")) {
-			unsigned int primitiveIndex = 0;
-			for (const auto& jPrimitive : jMesh["primitives"]) {
-				// Ensure that mesh.primitives has enough elements
-				if (primitiveIndex >= mesh.primitives.size()) {
-					mesh.primitives.resize(primitiveIndex + 1);
-				}
-				// Attributes
-				if (jPrimitive["attributes"].contains("POSITION")) {
-					 mesh.primitives[primitiveIndex]
-						.attributes[POSITION] = jPrimitive["attributes"]["POSITION"];
-				}
-				
-				if (jPrimitive["attributes"].contains("NORMAL")) {
-					mesh.primitives[primitiveIndex]
-						.attributes[NORMAL] = jPrimitive["attributes"]["NORMAL"];
-				}
-				if (jPrimitive["attributes"].contains("TEXCOORD_0")) {
-					mesh.primitives[primitiveIndex]
-						.attributes[TEXCOORD_0] = jPrimitive["attributes"]["TEXCOORD_0"];
-				}
-				if (jPrimitive["attributes"].contains("COLOR_0")) {
-					mesh.primitives[primitiveIndex]
-						.attributes[COLOR_0] = jPrimitive["attributes"]["COLOR_0"];
-				}
-				// Indices
-				if (jPrimitive.contains("indices")) {
-					mesh.primitives[primitiveIndex]
-						.indices = jPrimitive["indices"];
-				}
-				// Material
-				if (jPrimitive.contains("material")) {
-					mesh.primitives[primitiveIndex]
-						.material = jPrimitive["material"];
-				}
-				// Mode 
-				if (jPrimitive.contains("mode")) {
-					mesh.primitives[primitiveIndex]
-						.mode = PrimitiveTypes[jPrimitive["mode"]];
-				
-				}
-				else { // Go with the default one
-					mesh.primitives[primitiveIndex]
-						.mode = PrimitiveTypes[4]; // GL_TRIANGLES
-				}
-				
-				primitiveIndex++;
-			}
+	if (options.memoryMapBuffers) {
+		// Serve the bytes straight from the page cache, no copy is made
+		if (!bufferData.mapping.Open(path)) {
+			return false;
 		}
-		Meshes[index++] = mesh;
+		bufferData.data = bufferData.mapping.Data();
+		bufferData.size = bufferData.mapping.Size();
+	}
+	else {
+		std::ifstream binFile(path, std::ios::binary);
+		if (!binFile.is_open()) {
+			return false;
+		}
+
+		binFile.seekg(0, std::ios::end);
+
+		std::streamsize size = binFile.tellg();
 
+		binFile.seekg(0, std::ios::beg);
+
+		// Read directly into the final storage
+		bufferData.owned.resize(size);
+
+		binFile.read(reinterpret_cast<char*>(bufferData.owned.data()), size);
+
+		bufferData.data = bufferData.owned.data();
+		bufferData.size = bufferData.owned.size();
 	}
+	return true;
 }
 
-void glTFloader::loadBinaryGeometry(std::ifstream& binFile, unsigned int buffer)
+bool glTFloader::decodeDataUri(const std::string& uri, std::string& mediaType, BufferData& bufferData)
 {
-	std::vector<unsigned char> data;
+	const char* payload = nullptr;
+	size_t payloadLength = 0;
+	if (!parseDataUri(uri, mediaType, payload, payloadLength)) {
+		return false;
+	}
 
-	binFile.seekg(0, std::ios::end);
+	const size_t size = base64DecodedSize(payload, payloadLength);
+	if (size == 0 && payloadLength != 0) {
+		return false;
+	}
 
-	std::streamsize size = binFile.tellg();
+	// Decode straight into the final storage
+	bufferData.owned.resize(size);
+	if (!base64Decode(payload, payloadLength, bufferData.owned.data())) {
+		bufferData.owned.clear();
+		return false;
+	}
+	bufferData.data = bufferData.owned.data();
+	bufferData.size = bufferData.owned.size();
+	return true;
+}
 
-	binFile.seekg(0, std::ios::beg);
+bool glTFloader::parseGLB(const unsigned char*& jsonData, size_t& jsonLength, const std::string& modelPath)
+{
+	const unsigned char* bytes = container.data;
+	const size_t size = container.size;
+
+	auto readUint32 = [bytes](size_t offset) {
+		uint32_t value;
+		std::memcpy(&value, bytes + offset, sizeof(value));
+		return value;
+	};
+
+	// 12-byte header: magic, version, total length
+	if (size < GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE || readUint32(0) != GLB_MAGIC) {
+		std::cout << "Not a GLB file: " << modelPath << std::endl;
+		return false;
+	}
+	if (readUint32(4) != 2) {
+		std::cout << "Unsupported GLB version " << readUint32(4) << ": " << modelPath << std::endl;
+		return false;
+	}
+	const size_t length = readUint32(8);
+	if (length > size) {
+		std::cout << "GLB file is truncated: " << modelPath << std::endl;
+		return false;
+	}
 
-	data.resize(size);
+	// The chunk table, the first chunk is always JSON and an optional BIN chunk follows it
+	bool hasJSON = false;
+	size_t offset = GLB_HEADER_SIZE;
+	for (unsigned int chunk = 0; offset + GLB_CHUNK_HEADER_SIZE <= length; ++chunk) {
+		const size_t chunkLength = readUint32(offset);
+		const uint32_t chunkType = readUint32(offset + 4);
+		const size_t chunkStart = offset + GLB_CHUNK_HEADER_SIZE;
+		if (chunkLength > length - chunkStart) {
+			std::cout << "GLB chunk " << chunk << " overflows the file: " << modelPath << std::endl;
+			return false;
+		}
 
-	binFile.read(reinterpret_cast<char*>(data.data()), size);
+		if (chunk == 0) {
+			if (chunkType != GLB_CHUNK_JSON) {
+				std::cout << "GLB file does not start with a JSON chunk: " << modelPath << std::endl;
+				return false;
+			}
+			// The JSON is parsed straight out of the container, the text is never copied
+			jsonData = bytes + chunkStart;
+			jsonLength = chunkLength;
+			hasJSON = true;
+		}
+		else if (chunk == 1 && chunkType == GLB_CHUNK_BIN) {
+			binaryChunk = bytes + chunkStart;
+			binaryChunkLength = chunkLength;
+		}
+		// Unknown chunks are skipped, chunks are padded to 4 byte boundaries
+		offset = chunkStart + ((chunkLength + 3) & ~size_t(3));
+	}
 
-	binaryGeometry[buffer] = data;
+	if (!hasJSON) {
+		std::cout << "GLB file has no JSON chunk: " << modelPath << std::endl;
+	}
+	return hasJSON;
 }
@@ -0,0 +1,797 @@
+#include "../include/glTF_parser.h"
+#include "../include/glTF_loader.h"
+
+#include <climits>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+
+// A map of GPU buffer types and their respective key
+const std::unordered_map<unsigned int, GLenum> BufferTargets = {
+	{34962, GL_ARRAY_BUFFER},
+	{34963, GL_ELEMENT_ARRAY_BUFFER}
+};
+
+
+// A Map of component types along with their respective keys
+const std::unordered_map<unsigned int, GLenum> ComponentTypes = {
+	{5120, GL_BYTE},
+	{5121, GL_UNSIGNED_BYTE},
+	{5122, GL_SHORT},
+	{5123, GL_UNSIGNED_SHORT},
+	{5125, GL_UNSIGNED_INT},
+	{5126, GL_FLOAT}
+};
+
+// The EXT_meshopt_compression modes and filters by name
+const std::unordered_map<std::string, Meshopt_Mode> MeshoptModes = {
+	{"ATTRIBUTES", MESHOPT_ATTRIBUTES},
+	{"TRIANGLES", MESHOPT_TRIANGLES},
+	{"INDICES", MESHOPT_INDICES}
+};
+
+const std::unordered_map<std::string, Meshopt_Filter> MeshoptFilters = {
+	{"NONE", MESHOPT_FILTER_NONE},
+	{"OCTAHEDRAL", MESHOPT_FILTER_OCTAHEDRAL},
+	{"QUATERNION", MESHOPT_FILTER_QUATERNION},
+	{"EXPONENTIAL", MESHOPT_FILTER_EXPONENTIAL}
+};
+
+// A Map of primitives and thir respective keys
+const std::unordered_map<unsigned int, GLenum> PrimitiveTypes = {
+	{0, GL_POINTS},
+	{1, GL_LINES},
+	{2, GL_LINE_LOOP},
+	{3, GL_LINE_STRIP},
+	{4, GL_TRIANGLES},
+	{5, GL_TRIANGLE_STRIP},
+	{6, GL_TRIANGLE_FAN}
+};
+
+// A map of the mesh attribute semantics and their slot in Mesh_Primitive::attributes
+const std::unordered_map<std::string, Attribute> AttributeSemantics = {
+	{"POSITION", POSITION},
+	{"NORMAL", NORMAL},
+	{"TANGENT", TANGENT},
+	{"TEXCOORD_0", TEXCOORD_0},
+	{"TEXCOORD_1", TEXCOORD_1},
+	{"TEXCOORD_2", TEXCOORD_2},
+	{"TEXCOORD_3", TEXCOORD_3},
+	{"COLOR_0", COLOR_0},
+	{"COLOR_1", COLOR_1},
+	{"JOINTS_0", JOINTS_0},
+	{"JOINTS_1", JOINTS_1},
+	{"WEIGHTS_0", WEIGHTS_0},
+	{"WEIGHTS_1", WEIGHTS_1}
+};
+
+// A map of accessor element types and their respective names
+const std::unordered_map<std::string, Accessor_Type> AccessorTypes = {
+	{"SCALAR", SCALAR},
+	{"VEC2", VEC2},
+	{"VEC3", VEC3},
+	{"VEC4", VEC4},
+	{"MAT2", MAT2},
+	{"MAT3", MAT3},
+	{"MAT4", MAT4}
+};
+
+// The GL enum a glTF code stands for, false when the table has no such code
+static bool findCode(const std::unordered_map<unsigned int, GLenum>& table, unsigned long long code, GLenum& value)
+{
+	const auto found = code <= UINT_MAX ? table.find(static_cast<unsigned int>(code)) : table.end();
+	if (found == table.end()) {
+		return false;
+	}
+	value = found->second;
+	return true;
+}
+
+// The record for the element at the given index, the table grows to hold it
+template<typename T>
+static T* element(std::vector<T>& table, size_t index)
+{
+	if (index >= table.size()) {
+		table.resize(index + 1);
+	}
+	return &table[index];
+}
+
+
+glTFparser::glTFparser(glTFloader& loader)
+	: loader(loader)
+{
+	path.reserve(16);
+}
+
+bool glTFparser::null()
+{
+	Value val;
+	val.kind = Value::NULL_VALUE;
+	return value(val);
+}
+
+bool glTFparser::boolean(bool b)
+{
+	Value val;
+	val.kind = Value::BOOLEAN;
+	val.boolean = b;
+	return value(val);
+}
+
+bool glTFparser::number_integer(number_integer_t i)
+{
+	Value val;
+	val.kind = Value::NUMBER;
+	val.number = static_cast<double>(i);
+	val.outOfRange = i < 0;
+	val.integer = val.outOfRange ? 0 : static_cast<unsigned long long>(i);
+	return value(val);
+}
+
+bool glTFparser::number_unsigned(number_unsigned_t u)
+{
+	Value val;
+	val.kind = Value::NUMBER;
+	val.number = static_cast<double>(u);
+	val.integer = u;
+	return value(val);
+}
+
+bool glTFparser::number_float(number_float_t f, const string_t&)
+{
+	Value val;
+	val.kind = Value::NUMBER;
+	val.number = f;
+	// Converting NaN or a value of 2^64 and above to an integer is undefined, those count as out of range
+	val.outOfRange = !(f >= 0.0 && f < 18446744073709551616.0);
+	val.integer = val.outOfRange ? 0 : static_cast<unsigned long long>(f);
+	return value(val);
+}
+
+bool glTFparser::string(string_t& s)
+{
+	Value val;
+	val.kind = Value::STRING;
+	val.string = &s;
+	return value(val);
+}
+
+bool glTFparser::binary(binary_t&)
+{
+	// Never produced by the JSON lexer
+	next();
+	return true;
+}
+
+bool glTFparser::start_object(std::size_t)
+{
+	return enter(false);
+}
+
+bool glTFparser::key(string_t& val)
+{
+	if (skipDepth == 0) {
+		path.back().key = val;
+	}
+	return true;
+}
+
+bool glTFparser::end_object()
+{
+	leave();
+	if (Progress != nullptr && path.size() == 2 && Progress->Cancelled()) {
+		error = "Cancelled";
+		return false;
+	}
+	return true;
+}
+
+bool glTFparser::start_array(std::size_t)
+{
+	return enter(true);
+}
+
+bool glTFparser::end_array()
+{
+	leave();
+	return true;
+}
+
+bool glTFparser::parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex)
+{
+	error = ex.what();
+	return false;
+}
+
+bool glTFparser::enter(bool isArray)
+{
+	if (skipDepth != 0) {
+		++skipDepth;
+		return true;
+	}
+
+	const size_t depth = path.size();
+	bool read = false;
+
+	if (depth == 0) {
+		// The root object
+		read = !isArray;
+	}
+	else if (depth == 1) {
+		// A top-level property, only the tables below are read
+		const std::string& name = keyAt(0);
+		table = NO_TABLE;
+		if (name == "accessors") table = ACCESSORS;
+		else if (name == "bufferViews") table = BUFFER_VIEWS;
+		else if (name == "buffers") table = BUFFERS;
+		else if (name == "meshes") table = MESHES;
+		else if (name == "images") table = IMAGES;
+		else if (name == "samplers") table = SAMPLERS;
+		else if (name == "textures") table = TEXTURES;
+		else if (name == "materials") table = MATERIALS;
+		else if (name == "nodes") table = NODES;
+		else if (name == "scenes") table = SCENES;
+		read = isArray && table != NO_TABLE;
+	}
+	else if (depth == 2) {
+		// An element of a table, create its record in place
+		read = !isArray;
+		if (read) {
+			const size_t index = path[1].index;
+			switch (table) {
+			case ACCESSORS:    accessor = element(loader.Accessors, index); break;
+			case BUFFER_VIEWS: bufferView = element(loader.BufferViews, index); break;
+			case BUFFERS:      buffer = element(loader.Buffers, index); break;
+			case MESHES:       mesh = element(loader.Meshes, index); break;
+			case IMAGES:       image = element(loader.Images, index); break;
+			case SAMPLERS:     sampler = element(loader.Samplers, index); break;
+			case TEXTURES:     texture = element(loader.Textures, index); break;
+			case MATERIALS:    material = element(loader.Materials, index); break;
+			case NODES:        node = element(loader.Nodes, index); nodeHasMatrix = false; break;
+			case SCENES:       scene = element(loader.Scenes, index); break;
+			default:           read = false; break;
+			}
+		}
+	}
+	else if (depth == 3) {
+		// A nested property of a table element
+		const std::string& name = keyAt(2);
+		read = (table == ACCESSORS && isArray && (name == "min" || name == "max")) ||
+			(table == ACCESSORS && !isArray && name == "sparse") ||
+			((table == BUFFER_VIEWS || table == BUFFERS) && !isArray && name == "extensions") ||
+			(table == MESHES && isArray && name == "primitives") ||
+			(table == MATERIALS && !isArray && name == "pbrMetallicRoughness") ||
+			(table == NODES && isArray && (name == "children" || name == "matrix" || name == "translation" || name == "rotation" || name == "scale")) ||
+			(table == SCENES && isArray && name == "nodes");
+		if (read && table == ACCESSORS && name == "sparse") {
+			accessor->sparse.emplace();
+		}
+	}
+	else if (depth == 4) {
+		if (table == ACCESSORS && !isArray && keyAt(2) == "sparse") {
+			// The indices or values of a sparse accessor
+			read = keyAt(3) == "indices" || keyAt(3) == "values";
+		}
+		else if ((table == BUFFER_VIEWS || table == BUFFERS) && !isArray) {
+			// The only extension of buffers and buffer views that is read
+			read = keyAt(3) == "EXT_meshopt_compression";
+			if (read && table == BUFFER_VIEWS) {
+				bufferView->meshopt.emplace();
+			}
+		}
+		else if (table == MESHES && !isArray) {
+			// A primitive
+			mesh->primitives.emplace_back();
+			primitive = &mesh->primitives.back();
+			read = true;
+		}
+		else if (table == MATERIALS) {
+			const std::string& name = keyAt(3);
+			read = (isArray && name == "baseColorFactor") || (!isArray && name == "baseColorTexture");
+		}
+	}
+	else if (depth == 5) {
+		read = table == MESHES && !isArray && keyAt(4) == "attributes";
+	}
+
+	if (read) {
+		path.push_back(Frame{ isArray, std::string(), 0 });
+	}
+	else {
+		skipDepth = 1;
+	}
+	return true;
+}
+
+void glTFparser::leave()
+{
+	if (skipDepth != 0) {
+		--skipDepth;
+	}
+	else {
+		if (path.size() == 3 && table == NODES && !nodeHasMatrix) {
+			// Nodes keep a single local matrix, composed as T * R * S
+			node->matrix = glm::translate(glm::mat4(1.0f), node->translation) *
+				glm::mat4_cast(node->rotation) *
+				glm::scale(glm::mat4(1.0f), node->scale);
+		}
+		else if (path.size() == 3 && table == BUFFERS && BufferParsed) {
+			BufferParsed(static_cast<unsigned int>(path[1].index));
+		}
+		else if (path.size() == 3 && table == IMAGES && ImageParsed) {
+			ImageParsed(static_cast<unsigned int>(path[1].index));
+		}
+		path.pop_back();
+		if (path.size() == 1) {
+			table = NO_TABLE;
+		}
+	}
+	if (skipDepth == 0) {
+		next();
+	}
+}
+
+void glTFparser::next()
+{
+	if (skipDepth == 0 && !path.empty() && path.back().isArray) {
+		++path.back().index;
+	}
+}
+
+bool glTFparser::unexpected(const char* expected)
+{
+	// e.g. Expected an unsigned integer for "count" in accessors[3]
+	size_t depth = path.size() - 1;
+	while (depth > 0 && path[depth].isArray) {
+		--depth;
+	}
+	error = "Expected " + std::string(expected) + " for \"" + keyAt(depth) + "\" in " +
+		keyAt(0) + "[" + std::to_string(path[1].index) + "]";
+	return false;
+}
+
+bool glTFparser::value(const Value& val)
+{
+	if (skipDepth != 0) {
+		return true;
+	}
+
+	bool result = true;
+	if (path.size() == 1 && keyAt(0) == "scene") {
+		if (val.kind != Value::NUMBER || val.outOfRange) {
+			error = "Expected a scene index for \"scene\"";
+			return false;
+		}
+		loader.DefaultScene = static_cast<unsigned int>(val.integer);
+	}
+	else if (path.size() >= 3) {
+		switch (table) {
+		case ACCESSORS:    result = accessorValue(val); break;
+		case BUFFER_VIEWS: result = bufferViewValue(val); break;
+		case BUFFERS:      result = bufferValue(val); break;
+		case MESHES:       result = meshValue(val); break;
+		case IMAGES:       result = imageValue(val); break;
+		case SAMPLERS:     result = samplerValue(val); break;
+		case TEXTURES:     result = textureValue(val); break;
+		case MATERIALS:    result = materialValue(val); break;
+		case NODES:        result = nodeValue(val); break;
+		case SCENES:       result = sceneValue(val); break;
+		default: break;
+		}
+	}
+
+	next();
+	return result;
+}
+
+bool glTFparser::accessorValue(const Value& val)
+{
+	const std::string& name = keyAt(2);
+
+	if (name == "sparse") {
+		return sparseValue(val);
+	}
+
+	if (path.size() == 4) {
+		// A component of min or max
+		if (val.kind != Value::NUMBER) {
+			return unexpected("a number");
+		}
+		const size_t component = path[3].index;
+		if (component < MAX_COMPONENTS) {
+			(name == "min" ? accessor->min : accessor->max)[component] = static_cast<float>(val.number);
+			(name == "min" ? accessor->hasMin : accessor->hasMax) = true;
+		}
+		return true;
+	}
+
+	if (name == "type") {
+		if (val.kind != Value::STRING) {
+			return unexpected("a string");
+		}
+		const auto type = AccessorTypes.find(*val.string);
+		if (type == AccessorTypes.end()) {
+			return unexpected("an accessor type");
+		}
+		accessor->type = type->second;
+		return true;
+	}
+	if (name == "normalized") {
+		if (val.kind != Value::BOOLEAN) {
+			return unexpected("a boolean");
+		}
+		accessor->normalized = val.boolean;
+		return true;
+	}
+
+	if (name != "bufferView" && name != "byteOffset" && name != "componentType" && name != "count") {
+		return true;
+	}
+	if (val.kind != Value::NUMBER || val.outOfRange) {
+		return unexpected("an unsigned integer");
+	}
+	if (name == "bufferView") {
+		accessor->bufferView = static_cast<unsigned int>(val.integer);
+	}
+	else if (name == "byteOffset") {
+		accessor->byteOffset = static_cast<size_t>(val.integer);
+	}
+	else if (name == "componentType") {
+		if (!findCode(ComponentTypes, val.integer, accessor->componentType)) {
+			return unexpected("a component type");
+		}
+	}
+	else if (name == "count") {
+		accessor->count = static_cast<size_t>(val.integer);
+	}
+	return true;
+}
+
+bool glTFparser::sparseValue(const Value& val)
+{
+	// Either the count, or a member of indices or values
+	const std::string& name = keyAt(path.size() - 1);
+	if (path.size() == 4 ? name != "count" : name != "bufferView" && name != "byteOffset" && name != "componentType") {
+		return true;
+	}
+	if (val.kind != Value::NUMBER || val.outOfRange) {
+		return unexpected("an unsigned integer");
+	}
+
+	Accessor_Sparse& sparse = *(accessor->sparse);
+	if (path.size() == 4) {
+		sparse.count = static_cast<size_t>(val.integer);
+		return true;
+	}
+	const bool indices = keyAt(3) == "indices";
+	if (name == "bufferView") {
+		(indices ? sparse.indicesBufferView : sparse.valuesBufferView) = static_cast<unsigned int>(val.integer);
+	}
+	else if (name == "byteOffset") {
+		(indices ? sparse.indicesByteOffset : sparse.valuesByteOffset) = static_cast<size_t>(val.integer);
+	}
+	else if (indices) {
+		if (!findCode(ComponentTypes, val.integer, sparse.indicesComponentType)) {
+			return unexpected("a component type");
+		}
+	}
+	return true;
+}
+
+bool glTFparser::bufferViewValue(const Value& val)
+{
+	if (path.size() == 5) {
+		return meshoptValue(val);
+	}
+	const std::string& name = keyAt(2);
+
+	if (name != "buffer" && name != "byteOffset" && name != "byteLength" && name != "byteStride" && name != "target") {
+		return true;
+	}
+	if (val.kind != Value::NUMBER || val.outOfRange) {
+		return unexpected("an unsigned integer");
+	}
+	if (name == "buffer") {
+		bufferView->buffer = static_cast<unsigned int>(val.integer);
+	}
+	else if (name == "byteOffset") {
+		bufferView->byteOffset = static_cast<size_t>(val.integer);
+	}
+	else if (name == "byteLength") {
+		bufferView->byteLength = static_cast<size_t>(val.integer);
+	}
+	else if (name == "byteStride") {
+		bufferView->byteStride = static_cast<size_t>(val.integer);
+	}
+	else if (name == "target") {
+		if (!findCode(BufferTargets, val.integer, bufferView->target)) {
+			return unexpected("a buffer target");
+		}
+	}
+	return true;
+}
+
+bool glTFparser::meshoptValue(const Value& val)
+{
+	const std::string& name = keyAt(4);
+	Meshopt_Compression& compression = *(bufferView->meshopt);
+
+	if (name == "mode" || name == "filter") {
+		if (val.kind != Value::STRING) {
+			return unexpected("a string");
+		}
+		if (name == "mode") {
+			const auto mode = MeshoptModes.find(*val.string);
+			if (mode == MeshoptModes.end()) {
+				return unexpected("a compression mode");
+			}
+			compression.mode = mode->second;
+		}
+		else {
+			const auto filter = MeshoptFilters.find(*val.string);
+			if (filter == MeshoptFilters.end()) {
+				return unexpected("a compression filter");
+			}
+			compression.filter = filter->second;
+		}
+		return true;
+	}
+
+	if (name != "buffer" && name != "byteOffset" && name != "byteLength" && name != "byteStride" && name != "count") {
+		return true;
+	}
+	if (val.kind != Value::NUMBER || val.outOfRange) {
+		return unexpected("an unsigned integer");
+	}
+	if (name == "buffer") {
+		compression.buffer = static_cast<unsigned int>(val.integer);
+	}
+	else if (name == "byteOffset") {
+		compression.byteOffset = static_cast<size_t>(val.integer);
+	}
+	else if (name == "byteLength") {
+		compression.byteLength = static_cast<size_t>(val.integer);
+	}
+	else if (name == "byteStride") {
+		compression.byteStride = static_cast<size_t>(val.integer);
+	}
+	else if (name == "count") {
+		compression.count = static_cast<size_t>(val.integer);
+	}
+	return true;
+}
+
+bool glTFparser::bufferValue(const Value& val)
+{
+	const std::string& name = keyAt(2);
+
+	if (path.size() == 5) {
+		// The fallback flag of EXT_meshopt_compression
+		if (keyAt(4) == "fallback") {
+			if (val.kind != Value::BOOLEAN) {
+				return unexpected("a boolean");
+			}
+			buffer->fallback = val.boolean;
+		}
+		return true;
+	}
+	if (name == "uri") {
+		if (val.kind != Value::STRING) {
+			return unexpected("a string");
+		}
+		buffer->uri = *val.string;
+	}
+	else if (name == "byteLength") {
+		if (val.kind != Value::NUMBER || val.outOfRange) {
+			return unexpected("an unsigned integer");
+		}
+		buffer->byteLength = static_cast<size_t>(val.integer);
+	}
+	return true;
+}
+
+bool glTFparser::meshValue(const Value& val)
+{
+	// Only primitive properties are read
+	if (path.size() < 5) {
+		return true;
+	}
+
+	if (path.size() == 6) {
+		// An attribute semantic and the index of its accessor
+		const auto semantic = AttributeSemantics.find(keyAt(5));
+		if (semantic == AttributeSemantics.end()) {
+			return true;
+		}
+		if (val.kind != Value::NUMBER || val.outOfRange) {
+			return unexpected("an accessor index");
+		}
+		primitive->attributes[semantic->second] = static_cast<unsigned int>(val.integer);
+		return true;
+	}
+
+	const std::string& name = keyAt(4);
+	if (name != "indices" && name != "material" && name != "mode") {
+		return true;
+	}
+	if (val.kind != Value::NUMBER || val.outOfRange) {
+		return unexpected("an unsigned integer");
+	}
+	if (name == "indices") {
+		primitive->indices = static_cast<unsigned int>(val.integer);
+	}
+	else if (name == "material") {
+		primitive->material = static_cast<unsigned int>(val.integer);
+	}
+	else if (name == "mode") {
+		if (!findCode(PrimitiveTypes, val.integer, primitive->mode)) {
+			return unexpected("a primitive mode");
+		}
+	}
+	return true;
+}
+
+bool glTFparser::imageValue(const Value& val)
+{
+	const std::string& name = keyAt(2);
+
+	if (name == "uri" || name == "mimeType") {
+		if (val.kind != Value::STRING) {
+			return unexpected("a string");
+		}
+		(name == "uri" ? image->uri : image->mimeType) = *val.string;
+	}
+	else if (name == "bufferView") {
+		if (val.kind != Value::NUMBER || val.outOfRange) {
+			return unexpected("an unsigned integer");
+		}
+		image->bufferView = static_cast<unsigned int>(val.integer);
+	}
+	return true;
+}
+
+bool glTFparser::samplerValue(const Value& val)
+{
+	const std::string& name = keyAt(2);
+
+	if (name != "magFilter" && name != "minFilter" && name != "wrapS" && name != "wrapT") {
+		return true;
+	}
+	if (val.kind != Value::NUMBER || val.outOfRange) {
+		return unexpected("an unsigned integer");
+	}
+	const GLint mode = static_cast<GLint>(val.integer);
+	if (name == "magFilter") {
+		sampler->magFilter = mode;
+	}
+	else if (name == "minFilter") {
+		sampler->minFilter = mode;
+	}
+	else if (name == "wrapS") {
+		sampler->wrapS = mode;
+	}
+	else if (name == "wrapT") {
+		sampler->wrapT = mode;
+	}
+	return true;
+}
+
+bool glTFparser::textureValue(const Value& val)
+{
+	const std::string& name = keyAt(2);
+
+	if (name != "sampler" && name != "source") {
+		return true;
+	}
+	if (val.kind != Value::NUMBER || val.outOfRange) {
+		return unexpected("an unsigned integer");
+	}
+	(name == "sampler" ? texture->sampler : texture->source) = static_cast<unsigned int>(val.integer);
+	return true;
+}
+
+bool glTFparser::materialValue(const Value& val)
+{
+	if (path.size() == 3) {
+		if (keyAt(2) == "name") {
+			if (val.kind != Value::STRING) {
+				return unexpected("a string");
+			}
+			material->name = *val.string;
+		}
+		else if (keyAt(2) == "doubleSided") {
+			if (val.kind != Value::BOOLEAN) {
+				return unexpected("a boolean");
+			}
+			material->doubleSided = val.boolean;
+		}
+		return true;
+	}
+
+	if (path.size() == 5 && keyAt(3) == "baseColorFactor") {
+		if (val.kind != Value::NUMBER) {
+			return unexpected("a number");
+		}
+		if (path[4].index < 4) {
+			material->baseColorFactor[static_cast<int>(path[4].index)] = static_cast<float>(val.number);
+		}
+	}
+	else if (path.size() == 5 && keyAt(3) == "baseColorTexture") {
+		const std::string& name = keyAt(4);
+		if (name != "index" && name != "texCoord") {
+			return true;
+		}
+		if (val.kind != Value::NUMBER || val.outOfRange) {
+			return unexpected("an unsigned integer");
+		}
+		if (name == "index") {
+			material->baseColorTexture = static_cast<unsigned int>(val.integer);
+		}
+		else {
+			material->baseColorTexCoord = static_cast<unsigned int>(val.integer);
+		}
+	}
+	return true;
+}
+
+bool glTFparser::nodeValue(const Value& val)
+{
+	const std::string& name = keyAt(2);
+
+	if (path.size() == 3) {
+		if (name == "mesh") {
+			if (val.kind != Value::NUMBER || val.outOfRange) {
+				return unexpected("an unsigned integer");
+			}
+			node->mesh = static_cast<unsigned int>(val.integer);
+		}
+		return true;
+	}
+
+	const size_t i = path[3].index;
+	if (name == "children") {
+		if (val.kind != Value::NUMBER || val.outOfRange) {
+			return unexpected("a node index");
+		}
+		node->children.push_back(static_cast<unsigned int>(val.integer));
+		return true;
+	}
+
+	if (val.kind != Value::NUMBER) {
+		return unexpected("a number");
+	}
+	const float number = static_cast<float>(val.number);
+	if (name == "matrix" && i < 16) {
+		// Column-major, like glm
+		node->matrix[static_cast<int>(i / 4)][static_cast<int>(i % 4)] = number;
+		nodeHasMatrix = true;
+	}
+	else if (name == "translation" && i < 3) {
+		node->translation[static_cast<int>(i)] = number;
+	}
+	else if (name == "scale" && i < 3) {
+		node->scale[static_cast<int>(i)] = number;
+	}
+	else if (name == "rotation" && i < 4) {
+		// glTF stores quaternions as x, y, z, w
+		switch (i) {
+		case 0: node->rotation.x = number; break;
+		case 1: node->rotation.y = number; break;
+		case 2: node->rotation.z = number; break;
+		case 3: node->rotation.w = number; break;
+		}
+	}
+	return true;
+}
+
+bool glTFparser::sceneValue(const Value& val)
+{
+	if (path.size() == 4 && keyAt(2) == "nodes") {
+		if (val.kind != Value::NUMBER || val.outOfRange) {
+			return unexpected("a node index");
+		}
+		scene->nodes.push_back(static_cast<unsigned int>(val.integer));
+	}
+	return true;
+}
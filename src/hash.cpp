@@ -0,0 +1,98 @@
+#include "../include/hash.h"
+
+#include <cstring>
+
+
+static const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+static const uint64_t PRIME3 = 0x165667B19E3779F9ull;
+static const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+static const uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+static inline uint64_t rotl(uint64_t value, int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t read64(const unsigned char* bytes)
+{
+	uint64_t value;
+	std::memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+static inline uint32_t read32(const unsigned char* bytes)
+{
+	uint32_t value;
+	std::memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+static inline uint64_t round(uint64_t accumulator, uint64_t input)
+{
+	accumulator += input * PRIME2;
+	accumulator = rotl(accumulator, 31);
+	return accumulator * PRIME1;
+}
+
+static inline uint64_t merge(uint64_t accumulator, uint64_t lane)
+{
+	accumulator ^= round(0, lane);
+	return accumulator * PRIME1 + PRIME4;
+}
+
+uint64_t hash64(const void* data, size_t size, uint64_t seed)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	const unsigned char* end = bytes + size;
+	uint64_t hash;
+
+	if (size >= 32) {
+		// Four independent lanes over 32-byte stripes
+		uint64_t lane1 = seed + PRIME1 + PRIME2;
+		uint64_t lane2 = seed + PRIME2;
+		uint64_t lane3 = seed;
+		uint64_t lane4 = seed - PRIME1;
+		const unsigned char* limit = end - 32;
+		do {
+			lane1 = round(lane1, read64(bytes));
+			lane2 = round(lane2, read64(bytes + 8));
+			lane3 = round(lane3, read64(bytes + 16));
+			lane4 = round(lane4, read64(bytes + 24));
+			bytes += 32;
+		} while (bytes <= limit);
+
+		hash = rotl(lane1, 1) + rotl(lane2, 7) + rotl(lane3, 12) + rotl(lane4, 18);
+		hash = merge(hash, lane1);
+		hash = merge(hash, lane2);
+		hash = merge(hash, lane3);
+		hash = merge(hash, lane4);
+	}
+	else {
+		hash = seed + PRIME5;
+	}
+	hash += static_cast<uint64_t>(size);
+
+	// The tail, 8 then 4 then 1 byte at a time
+	for (; bytes + 8 <= end; bytes += 8) {
+		hash ^= round(0, read64(bytes));
+		hash = rotl(hash, 27) * PRIME1 + PRIME4;
+	}
+	if (bytes + 4 <= end) {
+		hash ^= static_cast<uint64_t>(read32(bytes)) * PRIME1;
+		hash = rotl(hash, 23) * PRIME2 + PRIME3;
+		bytes += 4;
+	}
+	for (; bytes != end; ++bytes) {
+		hash ^= (*bytes) * PRIME5;
+		hash = rotl(hash, 11) * PRIME1;
+	}
+
+	// Avalanche
+	hash ^= hash >> 33;
+	hash *= PRIME2;
+	hash ^= hash >> 29;
+	hash *= PRIME3;
+	hash ^= hash >> 32;
+	return hash;
+}
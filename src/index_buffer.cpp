@@ -0,0 +1,312 @@
+#include "../include/index_buffer.h"
+#include "../include/cpu_features.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(GLTF_X86)
+#include <immintrin.h>
+#endif
+
+
+template<typename T>
+static inline T load(const unsigned char* bytes)
+{
+	T value;
+	std::memcpy(&value, bytes, sizeof(T));
+	return value;
+}
+
+template<typename T>
+static void rangeScalar(const unsigned char* in, size_t n, uint32_t& low, uint32_t& high)
+{
+	for (size_t i = 0; i != n; ++i) {
+		const uint32_t index = load<T>(in + i * sizeof(T));
+		low = std::min(low, index);
+		high = std::max(high, index);
+	}
+}
+
+static void narrowScalar(const unsigned char* in, size_t n, unsigned char* out)
+{
+	// Reads stay ahead of writes, so narrowing in place is safe
+	for (size_t i = 0; i != n; ++i) {
+		const uint16_t index = static_cast<uint16_t>(load<uint32_t>(in + i * sizeof(uint32_t)));
+		std::memcpy(out + i * sizeof(uint16_t), &index, sizeof(uint16_t));
+	}
+}
+
+#if defined(GLTF_X86)
+
+// Lane-wise unsigned minimum and maximum of indices of type T
+template<typename T>
+GLTF_TARGET("sse4.1")
+static inline __m128i min128(__m128i a, __m128i b)
+{
+	if constexpr (sizeof(T) == 1) {
+		return _mm_min_epu8(a, b);
+	}
+	else if constexpr (sizeof(T) == 2) {
+		return _mm_min_epu16(a, b);
+	}
+	else {
+		return _mm_min_epu32(a, b);
+	}
+}
+
+template<typename T>
+GLTF_TARGET("sse4.1")
+static inline __m128i max128(__m128i a, __m128i b)
+{
+	if constexpr (sizeof(T) == 1) {
+		return _mm_max_epu8(a, b);
+	}
+	else if constexpr (sizeof(T) == 2) {
+		return _mm_max_epu16(a, b);
+	}
+	else {
+		return _mm_max_epu32(a, b);
+	}
+}
+
+template<typename T>
+GLTF_TARGET("sse4.1")
+static size_t rangeSSE41(const unsigned char* in, size_t n, uint32_t& low, uint32_t& high)
+{
+	const size_t lanes = sizeof(__m128i) / sizeof(T);
+	if (n < lanes) {
+		return 0;
+	}
+	__m128i lowest = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+	__m128i highest = lowest;
+	size_t done = lanes;
+	for (; done + lanes <= n; done += lanes) {
+		const __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done * sizeof(T)));
+		lowest = min128<T>(lowest, indices);
+		highest = max128<T>(highest, indices);
+	}
+	// Fold the lanes with the scalar loop
+	unsigned char lows[sizeof(__m128i)];
+	unsigned char highs[sizeof(__m128i)];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lows), lowest);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(highs), highest);
+	rangeScalar<T>(lows, lanes, low, high);
+	rangeScalar<T>(highs, lanes, low, high);
+	return done;
+}
+
+GLTF_TARGET("sse4.1")
+static size_t narrowSSE41(const unsigned char* in, size_t n, unsigned char* out)
+{
+	// Both halves are loaded before the store, which never passes the bytes already read
+	size_t done = 0;
+	for (; done + 8 <= n; done += 8) {
+		const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done * sizeof(uint32_t)));
+		const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done * sizeof(uint32_t) + 16));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + done * sizeof(uint16_t)), _mm_packus_epi32(first, second));
+	}
+	return done;
+}
+
+template<typename T>
+GLTF_TARGET("avx2")
+static inline __m256i min256(__m256i a, __m256i b)
+{
+	if constexpr (sizeof(T) == 1) {
+		return _mm256_min_epu8(a, b);
+	}
+	else if constexpr (sizeof(T) == 2) {
+		return _mm256_min_epu16(a, b);
+	}
+	else {
+		return _mm256_min_epu32(a, b);
+	}
+}
+
+template<typename T>
+GLTF_TARGET("avx2")
+static inline __m256i max256(__m256i a, __m256i b)
+{
+	if constexpr (sizeof(T) == 1) {
+		return _mm256_max_epu8(a, b);
+	}
+	else if constexpr (sizeof(T) == 2) {
+		return _mm256_max_epu16(a, b);
+	}
+	else {
+		return _mm256_max_epu32(a, b);
+	}
+}
+
+template<typename T>
+GLTF_TARGET("avx2")
+static size_t rangeAVX2(const unsigned char* in, size_t n, uint32_t& low, uint32_t& high)
+{
+	const size_t lanes = sizeof(__m256i) / sizeof(T);
+	if (n < lanes) {
+		return 0;
+	}
+	__m256i lowest = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+	__m256i highest = lowest;
+	size_t done = lanes;
+	for (; done + lanes <= n; done += lanes) {
+		const __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + done * sizeof(T)));
+		lowest = min256<T>(lowest, indices);
+		highest = max256<T>(highest, indices);
+	}
+	unsigned char lows[sizeof(__m256i)];
+	unsigned char highs[sizeof(__m256i)];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(lows), lowest);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(highs), highest);
+	rangeScalar<T>(lows, lanes, low, high);
+	rangeScalar<T>(highs, lanes, low, high);
+	return done;
+}
+
+GLTF_TARGET("avx2")
+static size_t narrowAVX2(const unsigned char* in, size_t n, unsigned char* out)
+{
+	size_t done = 0;
+	for (; done + 16 <= n; done += 16) {
+		const __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + done * sizeof(uint32_t)));
+		const __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + done * sizeof(uint32_t) + 32));
+		// The pack works within 128-bit halves, put the four quarters back in order
+		const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(first, second), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + done * sizeof(uint16_t)), packed);
+	}
+	return done;
+}
+
+#endif
+
+template<typename T>
+static IndexRange getRange(const unsigned char* in, size_t n)
+{
+	uint32_t low = UINT32_MAX;
+	uint32_t high = 0;
+	size_t done = 0;
+#if defined(GLTF_X86)
+	const CpuFeatures& features = getCpuFeatures();
+	if (features.avx2) {
+		done = rangeAVX2<T>(in, n, low, high);
+	}
+	if (features.sse41) {
+		done += rangeSSE41<T>(in + done * sizeof(T), n - done, low, high);
+	}
+#endif
+	rangeScalar<T>(in + done * sizeof(T), n - done, low, high);
+
+	IndexRange range;
+	if (n != 0) {
+		range.min = low;
+		range.max = high;
+	}
+	return range;
+}
+
+IndexRange getIndexRange(const unsigned char* indices, size_t count, GLenum indexType)
+{
+	switch (indexType) {
+	case GL_UNSIGNED_BYTE:  return getRange<uint8_t>(indices, count);
+	case GL_UNSIGNED_SHORT: return getRange<uint16_t>(indices, count);
+	case GL_UNSIGNED_INT:   return getRange<uint32_t>(indices, count);
+	default:                return IndexRange();
+	}
+}
+
+template<typename T>
+static void readPacked(const unsigned char* in, size_t count, uint32_t* out)
+{
+	for (size_t i = 0; i != count; ++i) {
+		out[i] = load<T>(in + i * sizeof(T));
+	}
+}
+
+template<typename T>
+static void writePacked(const uint32_t* in, size_t count, unsigned char* out)
+{
+	for (size_t i = 0; i != count; ++i) {
+		const T index = static_cast<T>(in[i]);
+		std::memcpy(out + i * sizeof(T), &index, sizeof(T));
+	}
+}
+
+void readIndices(const unsigned char* in, size_t count, GLenum indexType, uint32_t* out)
+{
+	switch (indexType) {
+	case GL_UNSIGNED_BYTE:  readPacked<uint8_t>(in, count, out); break;
+	case GL_UNSIGNED_SHORT: readPacked<uint16_t>(in, count, out); break;
+	case GL_UNSIGNED_INT:   readPacked<uint32_t>(in, count, out); break;
+	default:                break;
+	}
+}
+
+void writeIndices(const uint32_t* in, size_t count, GLenum indexType, unsigned char* out)
+{
+	switch (indexType) {
+	case GL_UNSIGNED_BYTE:  writePacked<uint8_t>(in, count, out); break;
+	case GL_UNSIGNED_SHORT: writePacked<uint16_t>(in, count, out); break;
+	case GL_UNSIGNED_INT:   writePacked<uint32_t>(in, count, out); break;
+	default:                break;
+	}
+}
+
+void narrowIndices(const unsigned char* in, size_t count, unsigned char* out)
+{
+	size_t done = 0;
+#if defined(GLTF_X86)
+	const CpuFeatures& features = getCpuFeatures();
+	if (features.avx2) {
+		done = narrowAVX2(in, count, out);
+	}
+	if (features.sse41) {
+		done += narrowSSE41(in + done * sizeof(uint32_t), count - done, out + done * sizeof(uint16_t));
+	}
+#endif
+	narrowScalar(in + done * sizeof(uint32_t), count - done, out + done * sizeof(uint16_t));
+}
+
+bool splitIndices(const unsigned char* indices, size_t count, size_t vertexCount, GLenum mode, size_t maxVertices,
+	std::vector<IndexChunk>& chunks)
+{
+	chunks.clear();
+	const size_t corners = mode == GL_TRIANGLES ? 3 : mode == GL_LINES ? 2 : mode == GL_POINTS ? 1 : 0;
+	if (corners == 0 || count % corners != 0 || maxVertices < corners) {
+		return false;
+	}
+
+	// The chunk vertex every source vertex became, valid while owner holds the current chunk
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<uint32_t> owner(vertexCount, UINT32_MAX);
+	for (size_t i = 0; i != count; i += corners) {
+		uint32_t corner[3];
+		size_t added = 0;
+		for (size_t c = 0; c != corners; ++c) {
+			corner[c] = load<uint32_t>(indices + (i + c) * sizeof(uint32_t));
+			if (corner[c] >= vertexCount) {
+				chunks.clear();
+				return false;
+			}
+			const bool repeated = (c > 0 && corner[c] == corner[0]) || (c > 1 && corner[c] == corner[1]);
+			if (!repeated && (chunks.empty() || owner[corner[c]] != chunks.size() - 1)) {
+				++added;
+			}
+		}
+		// Start a new chunk when this primitive's new vertices would not fit
+		if (chunks.empty() || chunks.back().vertices.size() + added > maxVertices) {
+			chunks.emplace_back();
+		}
+		IndexChunk& chunk = chunks.back();
+		const uint32_t current = static_cast<uint32_t>(chunks.size() - 1);
+		for (size_t c = 0; c != corners; ++c) {
+			const uint32_t vertex = corner[c];
+			if (owner[vertex] != current) {
+				owner[vertex] = current;
+				remap[vertex] = static_cast<uint32_t>(chunk.vertices.size());
+				chunk.vertices.push_back(vertex);
+			}
+			chunk.indices.push_back(static_cast<uint16_t>(remap[vertex]));
+		}
+	}
+	return true;
+}
@@ -0,0 +1,191 @@
+#include "../include/lz4_block.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+// The shortest match the format can encode
+const size_t MIN_MATCH = 4;
+// The last match has to start this far from the end of the block
+const size_t MATCH_SAFETY = 12;
+// The last bytes of a block are always literals
+const size_t LAST_LITERALS = 5;
+// The farthest back a match can point
+const size_t MAX_OFFSET = 65535;
+const unsigned int HASH_BITS = 16;
+
+static inline uint32_t read32(const unsigned char* bytes)
+{
+	uint32_t value;
+	std::memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+static inline uint32_t hashPosition(const unsigned char* bytes)
+{
+	return (read32(bytes) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Write the rest of a length that did not fit in its 4-bit token field
+static inline unsigned char* writeLength(unsigned char* out, size_t length)
+{
+	for (; length >= 255; length -= 255) {
+		*out++ = 255;
+	}
+	*out++ = static_cast<unsigned char>(length);
+	return out;
+}
+
+size_t lz4CompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t lz4Compress(const unsigned char* source, size_t size, unsigned char* destination, size_t capacity)
+{
+	if (capacity < lz4CompressBound(size)) {
+		return 0;
+	}
+	const unsigned char* in = source;
+	const unsigned char* end = source + size;
+	const unsigned char* anchor = source;
+	unsigned char* out = destination;
+
+	// Greedy matching against the last position seen for every hash
+	if (size > MATCH_SAFETY) {
+		std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+		const unsigned char* matchLimit = end - LAST_LITERALS;
+		const unsigned char* searchLimit = end - MATCH_SAFETY;
+
+		++in;
+		while (in < searchLimit) {
+			const uint32_t hash = hashPosition(in);
+			const unsigned char* candidate = source + table[hash];
+			table[hash] = static_cast<uint32_t>(in - source);
+			if (candidate >= in || static_cast<size_t>(in - candidate) > MAX_OFFSET || read32(candidate) != read32(in)) {
+				++in;
+				continue;
+			}
+
+			// Extend the match backwards over pending literals, then forwards
+			while (in > anchor && candidate > source && in[-1] == candidate[-1]) {
+				--in;
+				--candidate;
+			}
+			const unsigned char* matchEnd = in + MIN_MATCH;
+			const unsigned char* candidateEnd = candidate + MIN_MATCH;
+			while (matchEnd < matchLimit && *matchEnd == *candidateEnd) {
+				++matchEnd;
+				++candidateEnd;
+			}
+
+			const size_t literals = static_cast<size_t>(in - anchor);
+			const size_t matchLength = static_cast<size_t>(matchEnd - in) - MIN_MATCH;
+			unsigned char* token = out++;
+			*token = static_cast<unsigned char>((literals >= 15 ? 15 : literals) << 4);
+			if (literals >= 15) {
+				out = writeLength(out, literals - 15);
+			}
+			std::memcpy(out, anchor, literals);
+			out += literals;
+
+			const size_t offset = static_cast<size_t>(in - candidate);
+			*out++ = static_cast<unsigned char>(offset);
+			*out++ = static_cast<unsigned char>(offset >> 8);
+			*token |= static_cast<unsigned char>(matchLength >= 15 ? 15 : matchLength);
+			if (matchLength >= 15) {
+				out = writeLength(out, matchLength - 15);
+			}
+
+			in = matchEnd;
+			anchor = in;
+		}
+	}
+
+	// Everything after the last match is stored as literals
+	const size_t literals = static_cast<size_t>(end - anchor);
+	*out++ = static_cast<unsigned char>((literals >= 15 ? 15 : literals) << 4);
+	if (literals >= 15) {
+		out = writeLength(out, literals - 15);
+	}
+	if (literals != 0) {
+		std::memcpy(out, anchor, literals);
+	}
+	out += literals;
+	return static_cast<size_t>(out - destination);
+}
+
+bool lz4Decompress(const unsigned char* source, size_t size, unsigned char* destination, size_t rawSize)
+{
+	const unsigned char* in = source;
+	const unsigned char* inEnd = source + size;
+	unsigned char* out = destination;
+	unsigned char* outEnd = destination + rawSize;
+
+	// Read the rest of a length whose token field was saturated
+	auto readLength = [&in, inEnd](size_t& length) {
+		unsigned char byte;
+		do {
+			if (in == inEnd) {
+				return false;
+			}
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	};
+
+	while (in < inEnd) {
+		const unsigned char token = *in++;
+
+		size_t literals = token >> 4;
+		if (literals == 15 && !readLength(literals)) {
+			return false;
+		}
+		if (literals > static_cast<size_t>(inEnd - in) || literals > static_cast<size_t>(outEnd - out)) {
+			return false;
+		}
+		if (literals != 0) {
+			std::memcpy(out, in, literals);
+		}
+		in += literals;
+		out += literals;
+
+		// The last sequence has no match
+		if (in == inEnd) {
+			break;
+		}
+
+		if (inEnd - in < 2) {
+			return false;
+		}
+		const size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+		if (offset == 0 || offset > static_cast<size_t>(out - destination)) {
+			return false;
+		}
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !readLength(matchLength)) {
+			return false;
+		}
+		matchLength += MIN_MATCH;
+		if (matchLength > static_cast<size_t>(outEnd - out)) {
+			return false;
+		}
+
+		// Matches may overlap their own output, so copy forwards byte by byte when they do
+		const unsigned char* match = out - offset;
+		if (offset >= matchLength) {
+			std::memcpy(out, match, matchLength);
+			out += matchLength;
+		}
+		else {
+			for (size_t i = 0; i != matchLength; ++i) {
+				*out++ = match[i];
+			}
+		}
+	}
+	return out == outEnd;
+}
@@ -0,0 +1,193 @@
+#include "../include/mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <utility>
+
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other) {
+		Close();
+		bytes = std::exchange(other.bytes, nullptr);
+		length = std::exchange(other.length, 0);
+		opened = std::exchange(other.opened, false);
+#ifdef _WIN32
+		fileHandle = std::exchange(other.fileHandle, nullptr);
+		mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+	// Buffers are mostly read front to back, let the cache manager read ahead aggressively
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	length = static_cast<size_t>(fileSize.QuadPart);
+	opened = true;
+
+	// An empty file cannot be mapped but is still a valid (empty) buffer
+	if (length == 0) {
+		return true;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		Close();
+		return false;
+	}
+	mappingHandle = mapping;
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr) {
+		Close();
+		return false;
+	}
+	bytes = static_cast<const unsigned char*>(view);
+
+	WillNeed(0, length);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (bytes != nullptr) {
+		UnmapViewOfFile(bytes);
+	}
+	if (mappingHandle != nullptr) {
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != nullptr) {
+		CloseHandle(fileHandle);
+	}
+	bytes = nullptr;
+	length = 0;
+	opened = false;
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+}
+
+void MappedFile::WillNeed(size_t offset, size_t size) const
+{
+	if (bytes == nullptr || offset >= length) {
+		return;
+	}
+	if (size > length - offset) {
+		size = length - offset;
+	}
+#if _WIN32_WINNT >= 0x0602
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<unsigned char*>(bytes + offset);
+	range.NumberOfBytes = size;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		::close(fd);
+		return false;
+	}
+
+	length = static_cast<size_t>(info.st_size);
+	opened = true;
+
+	// An empty file cannot be mapped but is still a valid (empty) buffer
+	if (length == 0) {
+		::close(fd);
+		return true;
+	}
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	// Start page cache readahead before the first fault
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+
+	void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps its own reference to the file
+	::close(fd);
+	if (view == MAP_FAILED) {
+		Close();
+		return false;
+	}
+	bytes = static_cast<const unsigned char*>(view);
+
+	posix_madvise(view, length, POSIX_MADV_SEQUENTIAL);
+	WillNeed(0, length);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (bytes != nullptr) {
+		munmap(const_cast<unsigned char*>(bytes), length);
+	}
+	bytes = nullptr;
+	length = 0;
+	opened = false;
+}
+
+void MappedFile::WillNeed(size_t offset, size_t size) const
+{
+	if (bytes == nullptr || offset >= length) {
+		return;
+	}
+	if (size > length - offset) {
+		size = length - offset;
+	}
+	// madvise needs a page aligned start address
+	const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	const size_t alignedOffset = offset - offset % pageSize;
+	posix_madvise(const_cast<unsigned char*>(bytes + alignedOffset),
+		size + (offset - alignedOffset), POSIX_MADV_WILLNEED);
+}
+
+#endif
@@ -0,0 +1,918 @@
+#include "../include/mesh_optimize.h"
+#include "../include/hash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+// Live triangle counts past this score like it, a vertex used that often is rarely the best choice anyway
+const size_t VALENCE_LIMIT = 32;
+// No triangle chosen yet
+const size_t NO_TRIANGLE = ~size_t(0);
+
+// A FIFO post-transform cache, a vertex is in it while at most VERTEX_CACHE_SIZE vertices were shaded after it
+struct FifoCache {
+	std::vector<size_t> shadedAt;
+	size_t clock = VERTEX_CACHE_SIZE + 1;
+
+	explicit FifoCache(size_t vertexCount) : shadedAt(vertexCount, 0) {}
+
+	// Draw a triangle, returns how many of its corners were shaded
+	unsigned int draw(const uint32_t* corners) {
+		unsigned int misses = 0;
+		for (size_t c = 0; c != 3; ++c) {
+			if (clock - shadedAt[corners[c]] > VERTEX_CACHE_SIZE) {
+				shadedAt[corners[c]] = clock++;
+				++misses;
+			}
+		}
+		return misses;
+	}
+
+	// Forget every vertex
+	void flush() { clock += VERTEX_CACHE_SIZE + 1; }
+};
+
+// The side of the overdraw estimator's square render target in pixels
+const int OVERDRAW_GRID = 256;
+
+// Forsyth's vertex score, split into the part from the cache position and the part from the live triangles
+struct VertexScoreTable {
+	float cache[VERTEX_CACHE_SIZE + 1];   // Indexed by the cache position + 1, 0 for vertices out of the cache
+	float valence[VALENCE_LIMIT + 1];     // Indexed by the triangles still to be drawn that use the vertex
+
+	VertexScoreTable() {
+		cache[0] = 0.0f;
+		for (size_t position = 0; position != VERTEX_CACHE_SIZE; ++position) {
+			// The last triangle's vertices score alike, whatever order they went in
+			cache[position + 1] = position < 3 ? 0.75f :
+				std::pow(1.0f - static_cast<float>(position - 3) / (VERTEX_CACHE_SIZE - 3), 1.5f);
+		}
+		valence[0] = 0.0f;
+		for (size_t live = 1; live <= VALENCE_LIMIT; ++live) {
+			// Vertices with few triangles left are finished first, so they can leave the cache for good
+			valence[live] = 2.0f / std::sqrt(static_cast<float>(live));
+		}
+	}
+
+	float score(int position, uint32_t live) const {
+		// A vertex without triangles left adds nothing to the triangles that used it
+		return live == 0 ? 0.0f : cache[position + 1] + valence[std::min<size_t>(live, VALENCE_LIMIT)];
+	}
+};
+
+// The sum of the squared distances to a set of weighted planes, after Garland and Heckbert
+struct Quadric {
+	double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+	double b0 = 0, b1 = 0, b2 = 0;
+	double c = 0;
+	double weight = 0;
+
+	// Add the plane through point with unit normal
+	void addPlane(const float* normal, const float* point, double planeWeight) {
+		const double x = normal[0], y = normal[1], z = normal[2];
+		const double d = -(x * point[0] + y * point[1] + z * point[2]);
+		a00 += planeWeight * x * x; a01 += planeWeight * x * y; a02 += planeWeight * x * z;
+		a11 += planeWeight * y * y; a12 += planeWeight * y * z; a22 += planeWeight * z * z;
+		b0 += planeWeight * x * d; b1 += planeWeight * y * d; b2 += planeWeight * z * d;
+		c += planeWeight * d * d;
+		weight += planeWeight;
+	}
+
+	void add(const Quadric& other) {
+		a00 += other.a00; a01 += other.a01; a02 += other.a02; a11 += other.a11; a12 += other.a12; a22 += other.a22;
+		b0 += other.b0; b1 += other.b1; b2 += other.b2;
+		c += other.c;
+		weight += other.weight;
+	}
+
+	// The weighted mean squared distance of a point to the planes
+	double evaluate(const float* point) const {
+		const double x = point[0], y = point[1], z = point[2];
+		const double distance = x * (a00 * x + a01 * y + a02 * z) + y * (a01 * x + a11 * y + a12 * z) + z * (a02 * x + a12 * y + a22 * z) +
+			2.0 * (b0 * x + b1 * y + b2 * z) + c;
+		return weight > 0.0 ? std::max(distance, 0.0) / weight : 0.0;
+	}
+};
+
+// The squared difference between three attribute components and the values the triangles around a vertex interpolate
+// at a point, after Hoppe. Every triangle predicts each component as a linear function over its plane.
+struct AttributeQuadric {
+	double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+	double b0 = 0, b1 = 0, b2 = 0;
+	double c = 0;
+	double gradients[3][3] = {};   // The weighted gradients of every component
+	double offsets[3] = {};        // The weighted values of every component at the origin
+	double weight = 0;
+
+	// Add the triangle p0, p1, p2 with the values v0, v1 and v2 at its corners
+	void addTriangle(const float* p0, const float* p1, const float* p2, const float* v0, const float* v1, const float* v2, double triangleWeight) {
+		const double u[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		const double v[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		const double n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+		const double area = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+		if (area == 0.0) {
+			return;
+		}
+		// The gradient g lies in the plane with g.u and g.v the changes of the value along the edges
+		const double vn[3] = { v[1] * n[2] - v[2] * n[1], v[2] * n[0] - v[0] * n[2], v[0] * n[1] - v[1] * n[0] };
+		const double nu[3] = { n[1] * u[2] - n[2] * u[1], n[2] * u[0] - n[0] * u[2], n[0] * u[1] - n[1] * u[0] };
+		for (size_t component = 0; component != 3; ++component) {
+			const double du = v1[component] - v0[component];
+			const double dv = v2[component] - v0[component];
+			const double g[3] = { (du * vn[0] + dv * nu[0]) / area, (du * vn[1] + dv * nu[1]) / area, (du * vn[2] + dv * nu[2]) / area };
+			const double d = v0[component] - (g[0] * p0[0] + g[1] * p0[1] + g[2] * p0[2]);
+			a00 += triangleWeight * g[0] * g[0]; a01 += triangleWeight * g[0] * g[1]; a02 += triangleWeight * g[0] * g[2];
+			a11 += triangleWeight * g[1] * g[1]; a12 += triangleWeight * g[1] * g[2]; a22 += triangleWeight * g[2] * g[2];
+			b0 += triangleWeight * g[0] * d; b1 += triangleWeight * g[1] * d; b2 += triangleWeight * g[2] * d;
+			c += triangleWeight * d * d;
+			for (size_t axis = 0; axis != 3; ++axis) {
+				gradients[component][axis] += triangleWeight * g[axis];
+			}
+			offsets[component] += triangleWeight * d;
+		}
+		weight += triangleWeight;
+	}
+
+	void add(const AttributeQuadric& other) {
+		a00 += other.a00; a01 += other.a01; a02 += other.a02; a11 += other.a11; a12 += other.a12; a22 += other.a22;
+		b0 += other.b0; b1 += other.b1; b2 += other.b2;
+		c += other.c;
+		for (size_t component = 0; component != 3; ++component) {
+			for (size_t axis = 0; axis != 3; ++axis) {
+				gradients[component][axis] += other.gradients[component][axis];
+			}
+			offsets[component] += other.offsets[component];
+		}
+		weight += other.weight;
+	}
+
+	// The weighted mean squared difference between value and the values predicted at point
+	double evaluate(const float* point, const float* value) const {
+		const double x = point[0], y = point[1], z = point[2];
+		double difference = x * (a00 * x + a01 * y + a02 * z) + y * (a01 * x + a11 * y + a12 * z) + z * (a02 * x + a12 * y + a22 * z) +
+			2.0 * (b0 * x + b1 * y + b2 * z) + c;
+		for (size_t component = 0; component != 3; ++component) {
+			const double predicted = gradients[component][0] * x + gradients[component][1] * y + gradients[component][2] * z + offsets[component];
+			difference += value[component] * (weight * value[component] - 2.0 * predicted);
+		}
+		return weight > 0.0 ? std::max(difference, 0.0) / weight : 0.0;
+	}
+};
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t count, size_t vertexCount, size_t cacheSize)
+{
+	VertexCacheStats stats;
+	stats.triangles = count / 3;
+
+	// A vertex is in a FIFO cache while fewer than cacheSize vertices were shaded after it
+	std::vector<size_t> shadedAt(vertexCount, 0);
+	std::vector<bool> used(vertexCount, false);
+	for (size_t i = 0; i != stats.triangles * 3; ++i) {
+		const uint32_t vertex = indices[i];
+		if (vertex >= vertexCount) {
+			continue;
+		}
+		if (!used[vertex]) {
+			used[vertex] = true;
+			++stats.vertices;
+		}
+		else if (stats.transforms - shadedAt[vertex] < cacheSize) {
+			continue;
+		}
+		shadedAt[vertex] = stats.transforms++;
+	}
+	return stats;
+}
+
+void optimizeVertexCache(uint32_t* indices, size_t count, size_t vertexCount)
+{
+	static const VertexScoreTable table;
+	const size_t triangleCount = count / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	// The triangles of every vertex, the ones still to be drawn first
+	std::vector<uint32_t> live(vertexCount, 0);
+	for (size_t i = 0; i != triangleCount * 3; ++i) {
+		++live[indices[i]];
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t vertex = 0; vertex != vertexCount; ++vertex) {
+		offsets[vertex + 1] = offsets[vertex] + live[vertex];
+	}
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i != triangleCount * 3; ++i) {
+		adjacency[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t vertex = 0; vertex != vertexCount; ++vertex) {
+		vertexScores[vertex] = table.score(-1, live[vertex]);
+	}
+	std::vector<float> triangleScores(triangleCount);
+	for (size_t triangle = 0; triangle != triangleCount; ++triangle) {
+		const uint32_t* corners = indices + triangle * 3;
+		triangleScores[triangle] = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+	}
+
+	std::vector<uint32_t> result(triangleCount * 3);
+	std::vector<bool> emitted(triangleCount, false);
+	uint32_t cache[VERTEX_CACHE_SIZE + 3];
+	uint32_t next[VERTEX_CACHE_SIZE + 3];
+	size_t cached = 0;
+	// Where to look for a triangle when none touches the cache, every triangle before it is drawn
+	size_t cursor = 0;
+	size_t current = 0;
+
+	for (size_t out = 0; out != triangleCount; ++out) {
+		if (current == NO_TRIANGLE) {
+			while (emitted[cursor]) {
+				++cursor;
+			}
+			current = cursor;
+		}
+		const uint32_t* corners = indices + current * 3;
+		std::copy(corners, corners + 3, result.begin() + out * 3);
+		emitted[current] = true;
+
+		// The drawn triangle leaves the live lists of its vertices
+		for (size_t c = 0; c != 3; ++c) {
+			const uint32_t vertex = corners[c];
+			uint32_t* triangles = adjacency.data() + offsets[vertex];
+			uint32_t* found = std::find(triangles, triangles + live[vertex], static_cast<uint32_t>(current));
+			if (found != triangles + live[vertex]) {
+				*found = triangles[--live[vertex]];
+			}
+		}
+
+		// Its vertices move to the front of the cache, the oldest ones fall out the back
+		size_t nextCount = 0;
+		for (size_t c = 0; c != 3; ++c) {
+			if (std::find(next, next + nextCount, corners[c]) == next + nextCount) {
+				next[nextCount++] = corners[c];
+			}
+		}
+		for (size_t i = 0; i != cached; ++i) {
+			if (cache[i] != corners[0] && cache[i] != corners[1] && cache[i] != corners[2]) {
+				next[nextCount++] = cache[i];
+			}
+		}
+		for (size_t i = 0; i != nextCount; ++i) {
+			cachePosition[next[i]] = i < VERTEX_CACHE_SIZE ? static_cast<int>(i) : -1;
+		}
+		cached = std::min(nextCount, VERTEX_CACHE_SIZE);
+		std::copy(next, next + cached, cache);
+
+		// Rescore every vertex that moved, the evicted ones included, and the triangles still using them
+		for (size_t i = 0; i != nextCount; ++i) {
+			const uint32_t vertex = next[i];
+			const float score = table.score(cachePosition[vertex], live[vertex]);
+			const float delta = score - vertexScores[vertex];
+			vertexScores[vertex] = score;
+			const uint32_t* triangles = adjacency.data() + offsets[vertex];
+			for (uint32_t t = 0; t != live[vertex]; ++t) {
+				triangleScores[triangles[t]] += delta;
+			}
+		}
+
+		// The next triangle is the best one touching the cache, other triangles score no better than they did
+		current = NO_TRIANGLE;
+		float best = 0.0f;
+		for (size_t i = 0; i != cached; ++i) {
+			const uint32_t vertex = cache[i];
+			const uint32_t* triangles = adjacency.data() + offsets[vertex];
+			for (uint32_t t = 0; t != live[vertex]; ++t) {
+				if (triangleScores[triangles[t]] > best) {
+					best = triangleScores[triangles[t]];
+					current = triangles[t];
+				}
+			}
+		}
+	}
+
+	std::copy(result.begin(), result.end(), indices);
+}
+
+// Draw one triangle with its corners in pixels and depth in [0, 1], smaller is nearer
+static void rasterize(std::vector<float>& depth, const float* a, const float* b, const float* c, OverdrawStats& stats)
+{
+	// Counter-clockwise triangles face the viewer
+	const float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+	if (area <= 0.0f) {
+		return;
+	}
+	const int minX = std::max(0, static_cast<int>(std::floor(std::min({ a[0], b[0], c[0] }))));
+	const int minY = std::max(0, static_cast<int>(std::floor(std::min({ a[1], b[1], c[1] }))));
+	const int maxX = std::min(OVERDRAW_GRID - 1, static_cast<int>(std::ceil(std::max({ a[0], b[0], c[0] }))));
+	const int maxY = std::min(OVERDRAW_GRID - 1, static_cast<int>(std::ceil(std::max({ a[1], b[1], c[1] }))));
+	auto edge = [](const float* from, const float* to, float x, float y) {
+		return (to[0] - from[0]) * (y - from[1]) - (to[1] - from[1]) * (x - from[0]);
+	};
+	for (int y = minY; y <= maxY; ++y) {
+		for (int x = minX; x <= maxX; ++x) {
+			// Sample at the pixel center
+			const float px = x + 0.5f;
+			const float py = y + 0.5f;
+			const float wa = edge(b, c, px, py);
+			const float wb = edge(c, a, px, py);
+			const float wc = edge(a, b, px, py);
+			if (wa < 0.0f || wb < 0.0f || wc < 0.0f) {
+				continue;
+			}
+			const float z = (wa * a[2] + wb * b[2] + wc * c[2]) / area;
+			float& nearest = depth[static_cast<size_t>(y) * OVERDRAW_GRID + x];
+			if (z < nearest) {
+				stats.covered += std::isinf(nearest) ? 1 : 0;
+				stats.shaded += 1;
+				nearest = z;
+			}
+		}
+	}
+}
+
+OverdrawStats analyzeOverdraw(const uint32_t* indices, size_t count, const float* positions, size_t vertexCount)
+{
+	OverdrawStats stats;
+	const size_t triangleCount = count / 3;
+	if (triangleCount == 0 || vertexCount == 0) {
+		return stats;
+	}
+
+	// Fit the bounds of the triangles into the unit cube, keeping their proportions
+	float low[3] = { INFINITY, INFINITY, INFINITY };
+	float high[3] = { -INFINITY, -INFINITY, -INFINITY };
+	for (size_t i = 0; i != triangleCount * 3; ++i) {
+		const float* position = positions + indices[i] * 3;
+		for (size_t axis = 0; axis != 3; ++axis) {
+			low[axis] = std::min(low[axis], position[axis]);
+			high[axis] = std::max(high[axis], position[axis]);
+		}
+	}
+	const float extent = std::max({ high[0] - low[0], high[1] - low[1], high[2] - low[2] });
+	const float scale = extent > 0.0f ? 1.0f / extent : 0.0f;
+
+	std::vector<float> depth(static_cast<size_t>(OVERDRAW_GRID) * OVERDRAW_GRID);
+	for (size_t axis = 0; axis != 3; ++axis) {
+		// Look down the axis from both sides, the other two axes span the screen. Seen from below,
+		// the screen is mirrored and the depth reversed, so the same triangles face away.
+		for (int side = 0; side != 2; ++side) {
+			std::fill(depth.begin(), depth.end(), INFINITY);
+			for (size_t triangle = 0; triangle != triangleCount; ++triangle) {
+				float corners[3][3];
+				for (size_t c = 0; c != 3; ++c) {
+					const float* position = positions + indices[triangle * 3 + c] * 3;
+					const float u = (position[(axis + 1) % 3] - low[(axis + 1) % 3]) * scale;
+					const float v = (position[(axis + 2) % 3] - low[(axis + 2) % 3]) * scale;
+					const float w = (position[axis] - low[axis]) * scale;
+					corners[c][0] = (side == 0 ? u : 1.0f - u) * OVERDRAW_GRID;
+					corners[c][1] = v * OVERDRAW_GRID;
+					corners[c][2] = side == 0 ? 1.0f - w : w;
+				}
+				rasterize(depth, corners[0], corners[1], corners[2], stats);
+			}
+		}
+	}
+	return stats;
+}
+
+void optimizeOverdraw(uint32_t* indices, size_t count, const float* positions, size_t vertexCount, float threshold)
+{
+	const size_t triangleCount = count / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	// The cache order restarts wherever a triangle misses on all its corners
+	FifoCache cache(vertexCount);
+	std::vector<size_t> runs;
+	for (size_t triangle = 0; triangle != triangleCount; ++triangle) {
+		if (cache.draw(indices + triangle * 3) == 3 || triangle == 0) {
+			runs.push_back(triangle);
+		}
+	}
+	runs.push_back(triangleCount);
+
+	// Within a run, close a cluster as soon as its miss ratio is within the threshold of the whole run's
+	std::vector<size_t> clusters;
+	for (size_t run = 0; run + 1 != runs.size(); ++run) {
+		const size_t start = runs[run];
+		const size_t end = runs[run + 1];
+		cache.flush();
+		size_t runMisses = 0;
+		for (size_t triangle = start; triangle != end; ++triangle) {
+			runMisses += cache.draw(indices + triangle * 3);
+		}
+		const float target = threshold * static_cast<float>(runMisses) / static_cast<float>(end - start);
+
+		cache.flush();
+		clusters.push_back(start);
+		size_t misses = 0;
+		size_t drawn = 0;
+		for (size_t triangle = start; triangle != end; ++triangle) {
+			misses += cache.draw(indices + triangle * 3);
+			++drawn;
+			if (triangle + 1 != end && static_cast<float>(misses) <= target * static_cast<float>(drawn)) {
+				clusters.push_back(triangle + 1);
+				cache.flush();
+				misses = 0;
+				drawn = 0;
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	float center[3] = { 0.0f, 0.0f, 0.0f };
+	for (size_t vertex = 0; vertex != vertexCount; ++vertex) {
+		for (size_t axis = 0; axis != 3; ++axis) {
+			center[axis] += positions[vertex * 3 + axis] / static_cast<float>(vertexCount);
+		}
+	}
+
+	// Clusters are ranked by how far their area-weighted centroid lies out of the mesh along their average normal,
+	// from outside those are the triangles most likely to hide the rest
+	const size_t clusterCount = clusters.size() - 1;
+	std::vector<float> ranks(clusterCount);
+	for (size_t cluster = 0; cluster != clusterCount; ++cluster) {
+		float centroid[3] = { 0.0f, 0.0f, 0.0f };
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+		float totalArea = 0.0f;
+		for (size_t triangle = clusters[cluster]; triangle != clusters[cluster + 1]; ++triangle) {
+			const float* a = positions + indices[triangle * 3 + 0] * 3;
+			const float* b = positions + indices[triangle * 3 + 1] * 3;
+			const float* c = positions + indices[triangle * 3 + 2] * 3;
+			const float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			const float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			const float cross[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+			const float area = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+			for (size_t axis = 0; axis != 3; ++axis) {
+				centroid[axis] += (a[axis] + b[axis] + c[axis]) / 3.0f * area;
+				normal[axis] += cross[axis];
+			}
+			totalArea += area;
+		}
+		const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (totalArea <= 0.0f || length <= 0.0f) {
+			ranks[cluster] = 0.0f;
+			continue;
+		}
+		float rank = 0.0f;
+		for (size_t axis = 0; axis != 3; ++axis) {
+			rank += (centroid[axis] / totalArea - center[axis]) * normal[axis] / length;
+		}
+		ranks[cluster] = rank;
+	}
+
+	std::vector<size_t> order(clusterCount);
+	for (size_t cluster = 0; cluster != clusterCount; ++cluster) {
+		order[cluster] = cluster;
+	}
+	std::stable_sort(order.begin(), order.end(), [&ranks](size_t a, size_t b) { return ranks[a] > ranks[b]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(triangleCount * 3);
+	for (size_t cluster : order) {
+		result.insert(result.end(), indices + clusters[cluster] * 3, indices + clusters[cluster + 1] * 3);
+	}
+	std::copy(result.begin(), result.end(), indices);
+}
+
+size_t optimizeVertexFetch(uint32_t* indices, size_t count, size_t vertexCount, std::vector<uint32_t>& remap)
+{
+	const uint32_t unused = UINT32_MAX;
+	remap.assign(vertexCount, unused);
+	uint32_t used = 0;
+	for (size_t i = 0; i != count; ++i) {
+		uint32_t& place = remap[indices[i]];
+		if (place == unused) {
+			place = used++;
+		}
+		indices[i] = place;
+	}
+	uint32_t next = used;
+	for (uint32_t& place : remap) {
+		if (place == unused) {
+			place = next++;
+		}
+	}
+	return used;
+}
+
+size_t weldVertices(const WeldAttribute* attributes, size_t attributeCount, size_t vertexCount,
+	std::vector<uint32_t>& remap, std::vector<uint32_t>& unique)
+{
+	remap.assign(vertexCount, 0);
+	unique.clear();
+
+	// Every vertex as one key, tolerant values replaced by the grid point they snap to
+	size_t keySize = 0;
+	for (size_t a = 0; a != attributeCount; ++a) {
+		keySize += attributes[a].size;
+	}
+	std::vector<unsigned char> keys(vertexCount * keySize);
+	size_t keyOffset = 0;
+	for (size_t a = 0; a != attributeCount; ++a) {
+		const WeldAttribute& attribute = attributes[a];
+		for (size_t vertex = 0; vertex != vertexCount; ++vertex) {
+			unsigned char* key = keys.data() + vertex * keySize + keyOffset;
+			std::memcpy(key, attribute.data + vertex * attribute.stride, attribute.size);
+			if (attribute.tolerance > 0.0f) {
+				for (size_t component = 0; component != attribute.size / sizeof(float); ++component) {
+					float value;
+					std::memcpy(&value, key + component * sizeof(float), sizeof(float));
+					// Adding 0 turns -0 into 0, so both snap alike
+					value = std::round(value / attribute.tolerance) + 0.0f;
+					std::memcpy(key + component * sizeof(float), &value, sizeof(float));
+				}
+			}
+		}
+		keyOffset += attribute.size;
+	}
+
+	// Linear probing in a table at most half full, holding the first vertex of every distinct key
+	const uint32_t empty = UINT32_MAX;
+	size_t capacity = 16;
+	while (capacity < vertexCount * 2) {
+		capacity *= 2;
+	}
+	std::vector<uint32_t> table(capacity, empty);
+	for (size_t vertex = 0; vertex != vertexCount; ++vertex) {
+		const unsigned char* key = keys.data() + vertex * keySize;
+		size_t slot = static_cast<size_t>(hash64(key, keySize)) & (capacity - 1);
+		while (table[slot] != empty && std::memcmp(keys.data() + table[slot] * keySize, key, keySize) != 0) {
+			slot = (slot + 1) & (capacity - 1);
+		}
+		if (table[slot] == empty) {
+			table[slot] = static_cast<uint32_t>(vertex);
+			remap[vertex] = static_cast<uint32_t>(unique.size());
+			unique.push_back(static_cast<uint32_t>(vertex));
+		}
+		else {
+			remap[vertex] = remap[table[slot]];
+		}
+	}
+	return unique.size();
+}
+
+// The normal of a triangle scaled by twice its area
+static void triangleNormal(const float* a, const float* b, const float* c, float* normal)
+{
+	const float u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	const float v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	normal[0] = u[1] * v[2] - u[2] * v[1];
+	normal[1] = u[2] * v[0] - u[0] * v[2];
+	normal[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+// No edge found
+const uint32_t NO_EDGE = UINT32_MAX;
+
+// The position after a triangle corner, going around its triangle
+static size_t nextCorner(size_t i)
+{
+	return i - i % 3 + (i + 1) % 3;
+}
+
+// List the triangles around every position. A triangle with two corners at one position is listed twice there.
+static void findCornerTriangles(const uint32_t* indices, size_t count, const std::vector<uint32_t>& corner,
+	std::vector<uint32_t>& firstTriangle, std::vector<uint32_t>& triangles)
+{
+	std::fill(firstTriangle.begin(), firstTriangle.end(), 0);
+	for (size_t i = 0; i != count; ++i) {
+		++firstTriangle[corner[indices[i]] + 1];
+	}
+	for (size_t c = 0; c + 1 != firstTriangle.size(); ++c) {
+		firstTriangle[c + 1] += firstTriangle[c];
+	}
+	triangles.resize(count);
+	std::vector<uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+	for (size_t i = 0; i != count; ++i) {
+		triangles[filled[corner[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+	}
+}
+
+// For the edge from every index to the next one of its triangle, the index starting the edge of the other triangle
+// running back between the same two positions. Open borders and edges more than two triangles share get NO_EDGE.
+static void findOppositeEdges(const uint32_t* indices, size_t count, const std::vector<uint32_t>& corner,
+	const std::vector<uint32_t>& firstTriangle, const std::vector<uint32_t>& triangles, std::vector<uint32_t>& opposite)
+{
+	opposite.assign(count, NO_EDGE);
+	for (size_t i = 0; i != count; ++i) {
+		const uint32_t a = corner[indices[i]];
+		const uint32_t b = corner[indices[nextCorner(i)]];
+		if (a == b) {
+			continue;
+		}
+		size_t along = 0;
+		size_t back = 0;
+		uint32_t edge = NO_EDGE;
+		for (uint32_t t = firstTriangle[b]; t != firstTriangle[b + 1]; ++t) {
+			for (size_t e = triangles[t] * 3; e != triangles[t] * 3 + 3; ++e) {
+				const uint32_t from = corner[indices[e]];
+				const uint32_t to = corner[indices[nextCorner(e)]];
+				along += from == a && to == b;
+				if (from == b && to == a) {
+					edge = static_cast<uint32_t>(e);
+					++back;
+				}
+			}
+		}
+		if (along == 1 && back == 1) {
+			opposite[i] = edge;
+		}
+	}
+}
+
+// Moving every vertex at one position onto the vertex of a neighbouring position it shares a triangle with
+struct Collapse {
+	uint32_t from;
+	uint32_t to;
+	double cost;                // The squared error the collapse adds, what the candidates are ordered by
+	uint32_t fromVertices[2];   // The vertices at from, two on a seam
+	uint32_t toVertices[2];     // The vertices they move onto
+	uint32_t vertexCount;
+};
+
+size_t simplifyMesh(const uint32_t* indices, size_t count, const float* positions, const float* normals, size_t vertexCount,
+	size_t targetCount, float maxError, uint32_t* out, float& error, const unsigned char* lockedVertices)
+{
+	count = count / 3 * 3;
+	std::copy(indices, indices + count, out);
+	error = 0.0f;
+	if (count == 0) {
+		return 0;
+	}
+
+	// Vertices at one position are one corner of the surface with several sets of attributes, a collapse moves them
+	// all together. Open borders and edges shared by more than two triangles are locked, so the outline keeps its shape.
+	WeldAttribute position;
+	position.data = reinterpret_cast<const unsigned char*>(positions);
+	position.stride = 3 * sizeof(float);
+	position.size = 3 * sizeof(float);
+	std::vector<uint32_t> corner;
+	std::vector<uint32_t> unique;
+	const size_t cornerCount = weldVertices(&position, 1, vertexCount, corner, unique);
+	std::vector<uint32_t> firstTriangle(cornerCount + 1);
+	std::vector<uint32_t> triangles;
+	std::vector<uint32_t> opposite;
+	findCornerTriangles(out, count, corner, firstTriangle, triangles);
+	findOppositeEdges(out, count, corner, firstTriangle, triangles, opposite);
+	std::vector<char> locked(cornerCount, 0);
+	// Seams, where the triangles on either side of an edge use different vertices, may only slide along themselves.
+	// The planes through a seam upright on its triangles, weighted by its length, measure how far it bends.
+	std::vector<Quadric> seamQuadrics(cornerCount);
+	for (size_t i = 0; i != count; ++i) {
+		const uint32_t a = out[i];
+		const uint32_t b = out[nextCorner(i)];
+		if (corner[a] == corner[b]) {
+			continue;
+		}
+		if (opposite[i] == NO_EDGE) {
+			locked[corner[a]] = 1;
+			locked[corner[b]] = 1;
+			continue;
+		}
+		if (out[opposite[i]] == b && out[nextCorner(opposite[i])] == a) {
+			continue;
+		}
+		const float* p = positions + a * 3;
+		const float* q = positions + b * 3;
+		float face[3];
+		triangleNormal(p, q, positions + out[nextCorner(nextCorner(i))] * 3, face);
+		const float along[3] = { q[0] - p[0], q[1] - p[1], q[2] - p[2] };
+		float upright[3] = { along[1] * face[2] - along[2] * face[1], along[2] * face[0] - along[0] * face[2], along[0] * face[1] - along[1] * face[0] };
+		const float length = std::sqrt(upright[0] * upright[0] + upright[1] * upright[1] + upright[2] * upright[2]);
+		if (length == 0.0f) {
+			continue;
+		}
+		for (size_t axis = 0; axis != 3; ++axis) {
+			upright[axis] /= length;
+		}
+		const double seamLength = std::sqrt(along[0] * along[0] + along[1] * along[1] + along[2] * along[2]);
+		seamQuadrics[corner[a]].addPlane(upright, p, seamLength);
+		seamQuadrics[corner[b]].addPlane(upright, p, seamLength);
+	}
+	if (lockedVertices) {
+		for (size_t vertex = 0; vertex != vertexCount; ++vertex) {
+			locked[corner[vertex]] |= lockedVertices[vertex] != 0;
+		}
+	}
+
+	// Every corner starts with the planes of its triangles weighted by their area, every vertex with the normals
+	// its triangles interpolate
+	std::vector<Quadric> quadrics(cornerCount);
+	std::vector<AttributeQuadric> attributes(normals ? vertexCount : 0);
+	for (size_t i = 0; i != count; i += 3) {
+		const float* a = positions + out[i] * 3;
+		const float* b = positions + out[i + 1] * 3;
+		const float* c = positions + out[i + 2] * 3;
+		float normal[3];
+		triangleNormal(a, b, c, normal);
+		const float area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (area == 0.0f) {
+			continue;
+		}
+		const float unit[3] = { normal[0] / area, normal[1] / area, normal[2] / area };
+		AttributeQuadric shading;
+		if (normals) {
+			shading.addTriangle(a, b, c, normals + out[i] * 3, normals + out[i + 1] * 3, normals + out[i + 2] * 3, area);
+		}
+		for (size_t k = 0; k != 3; ++k) {
+			quadrics[corner[out[i + k]]].addPlane(unit, a, area);
+			if (normals) {
+				attributes[out[i + k]].add(shading);
+			}
+		}
+	}
+
+	// Collapse edges in passes, each pass takes the cheapest collapses whose neighbourhoods do not overlap
+	const double errorLimit = static_cast<double>(maxError) * maxError;
+	double worst = 0.0;
+	size_t current = count;
+	targetCount = targetCount / 3 * 3;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<char> used(vertexCount);
+	std::vector<uint32_t> cornerUses(cornerCount);
+	std::vector<uint32_t> seamEdges(cornerCount);
+	std::vector<Collapse> collapses;
+	std::vector<char> touched(cornerCount);
+	std::vector<uint32_t> fromRing;
+	std::vector<uint32_t> toRing;
+	std::vector<uint32_t> across;
+	while (current > targetCount) {
+		if (current != count) {
+			findCornerTriangles(out, current, corner, firstTriangle, triangles);
+			findOppositeEdges(out, current, corner, firstTriangle, triangles, opposite);
+		}
+
+		// A corner moves if one vertex is left at it, or if it has two on a seam running through it, which then
+		// only moves along the seam. A seam ending at a corner of one vertex holds it back through its seam planes.
+		std::fill(used.begin(), used.end(), 0);
+		std::fill(cornerUses.begin(), cornerUses.end(), 0);
+		std::fill(seamEdges.begin(), seamEdges.end(), 0);
+		for (size_t i = 0; i != current; ++i) {
+			if (!used[out[i]]) {
+				used[out[i]] = 1;
+				++cornerUses[corner[out[i]]];
+			}
+			const uint32_t back = opposite[i];
+			seamEdges[corner[out[i]]] += back != NO_EDGE && (out[back] != out[nextCorner(i)] || out[nextCorner(back)] != out[i]);
+		}
+
+		// Every edge moves the vertices at either end onto those at the other. What the attributes change counts
+		// over the length of the edge, so it compares to the distance the surface moves.
+		collapses.clear();
+		for (size_t i = 0; i != current; ++i) {
+			const uint32_t back = opposite[i];
+			if (back == NO_EDGE || corner[out[i]] > corner[out[nextCorner(i)]]) {
+				continue;
+			}
+			// The vertices the triangles on either side use at both ends
+			const uint32_t ends[2][2] = { { out[i], out[nextCorner(back)] }, { out[nextCorner(i)], out[back] } };
+			for (size_t direction = 0; direction != 2; ++direction) {
+				const uint32_t* from = ends[direction];
+				const uint32_t* to = ends[1 - direction];
+				const uint32_t fromCorner = corner[from[0]];
+				if (locked[fromCorner] || cornerUses[fromCorner] != (from[0] == from[1] ? 1u : 2u) ||
+					(from[0] == from[1] && to[0] != to[1]) || (from[0] != from[1] && seamEdges[fromCorner] != 2)) {
+					continue;
+				}
+				Collapse collapse = { fromCorner, corner[to[0]], 0.0, { from[0], from[1] }, { to[0], to[1] }, from[0] == from[1] ? 1u : 2u };
+				const float* target = positions + to[0] * 3;
+				Quadric merged = quadrics[collapse.from];
+				merged.add(quadrics[collapse.to]);
+				Quadric seam = seamQuadrics[collapse.from];
+				seam.add(seamQuadrics[collapse.to]);
+				collapse.cost = merged.evaluate(target) + seam.evaluate(target);
+				for (uint32_t v = 0; v != collapse.vertexCount && normals; ++v) {
+					const float* p = positions + from[v] * 3;
+					const double length = (p[0] - target[0]) * (p[0] - target[0]) + (p[1] - target[1]) * (p[1] - target[1]) +
+						(p[2] - target[2]) * (p[2] - target[2]);
+					AttributeQuadric shading = attributes[from[v]];
+					shading.add(attributes[to[v]]);
+					collapse.cost += shading.evaluate(target, normals + to[v] * 3) * length;
+				}
+				collapses.push_back(collapse);
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		for (size_t vertex = 0; vertex != vertexCount; ++vertex) {
+			remap[vertex] = static_cast<uint32_t>(vertex);
+		}
+		std::fill(touched.begin(), touched.end(), 0);
+		size_t removed = 0;
+		size_t applied = 0;
+		for (const Collapse& collapse : collapses) {
+			if (collapse.cost > errorLimit || current - removed <= targetCount) {
+				break;
+			}
+			if (touched[collapse.from] || touched[collapse.to]) {
+				continue;
+			}
+			// The triangles around from keep facing about the same way once it moves onto to
+			const float* target = positions + collapse.toVertices[0] * 3;
+			bool flips = false;
+			fromRing.clear();
+			across.clear();
+			for (uint32_t t = firstTriangle[collapse.from]; t != firstTriangle[collapse.from + 1] && !flips; ++t) {
+				const uint32_t* triangle = out + triangles[t] * 3;
+				bool vanishes = false;
+				for (size_t c = 0; c != 3; ++c) {
+					vanishes |= corner[triangle[c]] == collapse.to;
+					if (corner[triangle[c]] != collapse.from) {
+						fromRing.push_back(corner[triangle[c]]);
+					}
+				}
+				if (vanishes) {
+					for (size_t c = 0; c != 3; ++c) {
+						if (corner[triangle[c]] != collapse.from && corner[triangle[c]] != collapse.to) {
+							across.push_back(corner[triangle[c]]);
+						}
+					}
+					continue;
+				}
+				const float* moved[3];
+				for (size_t c = 0; c != 3; ++c) {
+					moved[c] = corner[triangle[c]] == collapse.from ? target : positions + triangle[c] * 3;
+				}
+				float before[3];
+				float after[3];
+				triangleNormal(positions + triangle[0] * 3, positions + triangle[1] * 3, positions + triangle[2] * 3, before);
+				triangleNormal(moved[0], moved[1], moved[2], after);
+				// Turning by more than about 75 degrees counts as flipping, smaller turns can fold a sliver over a few passes
+				const float turn = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+				const float lengths = std::sqrt((before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+					(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+				flips = turn <= 0.25f * lengths;
+			}
+			if (flips || across.empty()) {
+				continue;
+			}
+			// The link condition: the corners next to both ends are only those across the collapsing edge,
+			// anything else would pinch the surface into a non-manifold shape
+			toRing.clear();
+			for (uint32_t t = firstTriangle[collapse.to]; t != firstTriangle[collapse.to + 1]; ++t) {
+				const uint32_t* triangle = out + triangles[t] * 3;
+				for (size_t c = 0; c != 3; ++c) {
+					if (corner[triangle[c]] != collapse.to && corner[triangle[c]] != collapse.from) {
+						toRing.push_back(corner[triangle[c]]);
+					}
+				}
+			}
+			for (std::vector<uint32_t>* ring : { &fromRing, &toRing, &across }) {
+				std::sort(ring->begin(), ring->end());
+				ring->erase(std::unique(ring->begin(), ring->end()), ring->end());
+			}
+			size_t shared = 0;
+			for (uint32_t c : fromRing) {
+				shared += std::binary_search(toRing.begin(), toRing.end(), c);
+			}
+			if (shared != across.size()) {
+				continue;
+			}
+
+			// The whole neighbourhood of from changes, none of it takes part in another collapse this pass
+			size_t vanishing = 0;
+			for (uint32_t t = firstTriangle[collapse.from]; t != firstTriangle[collapse.from + 1]; ++t) {
+				const uint32_t* triangle = out + triangles[t] * 3;
+				touched[corner[triangle[0]]] = touched[corner[triangle[1]]] = touched[corner[triangle[2]]] = 1;
+				vanishing += corner[triangle[0]] == collapse.to || corner[triangle[1]] == collapse.to || corner[triangle[2]] == collapse.to;
+			}
+			for (uint32_t v = 0; v != collapse.vertexCount; ++v) {
+				remap[collapse.fromVertices[v]] = collapse.toVertices[v];
+				if (normals) {
+					attributes[collapse.toVertices[v]].add(attributes[collapse.fromVertices[v]]);
+				}
+			}
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			seamQuadrics[collapse.to].add(seamQuadrics[collapse.from]);
+			worst = std::max(worst, collapse.cost);
+			removed += vanishing * 3;
+			++applied;
+		}
+		if (applied == 0) {
+			break;
+		}
+
+		// Drop the triangles that lost a corner
+		size_t kept = 0;
+		for (size_t i = 0; i != current; i += 3) {
+			const uint32_t a = remap[out[i]];
+			const uint32_t b = remap[out[i + 1]];
+			const uint32_t c = remap[out[i + 2]];
+			if (a != b && b != c && c != a) {
+				out[kept++] = a;
+				out[kept++] = b;
+				out[kept++] = c;
+			}
+		}
+		current = kept;
+	}
+	error = static_cast<float>(std::sqrt(worst));
+	return current;
+}
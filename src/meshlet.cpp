@@ -0,0 +1,738 @@
+#include "../include/meshlet.h"
+#include "../include/mesh_optimize.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+// Below this the normals spread over more than a hemisphere's worth of directions, and the cone culls nothing
+const float MIN_CONE_SPREAD = 0.1f;
+// The triangles a group of clusters grows to before it is simplified, four full clusters as in Nanite
+const size_t CLUSTER_GROUP_TRIANGLES = 4 * MESHLET_MAX_TRIANGLES;
+// A group whose simplified triangles are not below this share of its triangles is left for the next level
+const float MIN_GROUP_REDUCTION = 0.85f;
+
+static glm::vec3 getPosition(const float* positions, uint32_t vertex)
+{
+	return glm::vec3(positions[vertex * 3], positions[vertex * 3 + 1], positions[vertex * 3 + 2]);
+}
+
+// The bounding sphere of a run of triangles after Ritter, and the cone around their unit normals
+static void computeBounds(const uint32_t* indices, size_t count, const float* positions, Meshlet& meshlet)
+{
+	// Start from the pair of axis extremes furthest apart
+	uint32_t lowest[3] = { indices[0], indices[0], indices[0] };
+	uint32_t highest[3] = { indices[0], indices[0], indices[0] };
+	for (size_t i = 0; i != count; ++i) {
+		const glm::vec3 point = getPosition(positions, indices[i]);
+		for (int axis = 0; axis != 3; ++axis) {
+			if (point[axis] < getPosition(positions, lowest[axis])[axis]) {
+				lowest[axis] = indices[i];
+			}
+			if (point[axis] > getPosition(positions, highest[axis])[axis]) {
+				highest[axis] = indices[i];
+			}
+		}
+	}
+	int widest = 0;
+	float widestSquared = -1.0f;
+	for (int axis = 0; axis != 3; ++axis) {
+		const glm::vec3 span = getPosition(positions, highest[axis]) - getPosition(positions, lowest[axis]);
+		if (glm::dot(span, span) > widestSquared) {
+			widestSquared = glm::dot(span, span);
+			widest = axis;
+		}
+	}
+	glm::vec3 center = (getPosition(positions, lowest[widest]) + getPosition(positions, highest[widest])) * 0.5f;
+	float radius = std::sqrt(widestSquared) * 0.5f;
+
+	// Grow the sphere just enough to take in every point outside it
+	for (size_t i = 0; i != count; ++i) {
+		const glm::vec3 point = getPosition(positions, indices[i]);
+		const float distance = glm::length(point - center);
+		if (distance > radius) {
+			const float grown = (radius + distance) * 0.5f;
+			center += (point - center) * ((grown - radius) / distance);
+			radius = grown;
+		}
+	}
+
+	// Degenerate triangles face nowhere and are left out of the cone
+	glm::vec3 sum(0.0f);
+	for (size_t i = 0; i + 3 <= count; i += 3) {
+		const glm::vec3 a = getPosition(positions, indices[i]);
+		const glm::vec3 normal = glm::cross(getPosition(positions, indices[i + 1]) - a, getPosition(positions, indices[i + 2]) - a);
+		const float area = glm::length(normal);
+		if (area > 0.0f) {
+			sum += normal / area;
+		}
+	}
+	const float sumLength = glm::length(sum);
+	float spread = sumLength > 0.0f ? 1.0f : -1.0f;
+	const glm::vec3 axis = sumLength > 0.0f ? sum / sumLength : glm::vec3(0.0f);
+	for (size_t i = 0; i + 3 <= count && sumLength > 0.0f; i += 3) {
+		const glm::vec3 a = getPosition(positions, indices[i]);
+		const glm::vec3 normal = glm::cross(getPosition(positions, indices[i + 1]) - a, getPosition(positions, indices[i + 2]) - a);
+		const float area = glm::length(normal);
+		if (area > 0.0f) {
+			spread = std::min(spread, glm::dot(normal / area, axis));
+		}
+	}
+
+	for (int component = 0; component != 3; ++component) {
+		meshlet.center[component] = center[component];
+		meshlet.coneAxis[component] = axis[component];
+	}
+	meshlet.radius = radius;
+	// The normals lie within acos(spread) of the axis, so every triangle faces away from directions closer to the
+	// axis than 90 degrees less that angle, whose cosine is sin(acos(spread))
+	meshlet.coneCutoff = spread < MIN_CONE_SPREAD ? 1.0f : std::sqrt(1.0f - spread * spread);
+}
+
+size_t buildMeshlets(const uint32_t* indices, size_t count, const float* positions, size_t vertexCount, std::vector<Meshlet>& meshlets,
+	size_t maxVertices, size_t maxTriangles)
+{
+	const size_t first = meshlets.size();
+	maxVertices = std::max<size_t>(maxVertices, 3);
+	maxTriangles = std::max<size_t>(maxTriangles, 1);
+
+	// The meshlet that last took every vertex, the meshlet being built is meshlets.size()
+	std::vector<size_t> owner(vertexCount, ~size_t(0));
+	size_t start = 0;
+	size_t vertices = 0;
+	const size_t end = count / 3 * 3;
+	for (size_t i = 0; i != end; i += 3) {
+		const uint32_t* corners = indices + i;
+		size_t added = 0;
+		for (size_t c = 0; c != 3; ++c) {
+			const bool repeated = (c > 0 && corners[c] == corners[0]) || (c > 1 && corners[c] == corners[1]);
+			added += !repeated && owner[corners[c]] != meshlets.size();
+		}
+		// A triangle that does not fit starts the next meshlet, where every one of its vertices is new
+		if (i != start && (vertices + added > maxVertices || (i - start) / 3 == maxTriangles)) {
+			Meshlet meshlet;
+			meshlet.firstIndex = static_cast<uint32_t>(start);
+			meshlet.indexCount = static_cast<uint32_t>(i - start);
+			computeBounds(indices + start, i - start, positions, meshlet);
+			meshlets.push_back(meshlet);
+			start = i;
+			vertices = 0;
+		}
+		for (size_t c = 0; c != 3; ++c) {
+			if (owner[corners[c]] != meshlets.size()) {
+				owner[corners[c]] = meshlets.size();
+				++vertices;
+			}
+		}
+	}
+	if (start != end) {
+		Meshlet meshlet;
+		meshlet.firstIndex = static_cast<uint32_t>(start);
+		meshlet.indexCount = static_cast<uint32_t>(end - start);
+		computeBounds(indices + start, end - start, positions, meshlet);
+		meshlets.push_back(meshlet);
+	}
+	return meshlets.size() - first;
+}
+
+// The frustum planes of a clip transform, in the space it transforms from and pointing inwards. They are sums and
+// differences of the rows of the transform, after Gribb and Hartmann.
+static void getFrustumPlanes(const glm::mat4& clip, glm::vec4* planes)
+{
+	glm::vec4 rows[4];
+	for (int row = 0; row != 4; ++row) {
+		rows[row] = glm::vec4(clip[0][row], clip[1][row], clip[2][row], clip[3][row]);
+	}
+	for (int axis = 0; axis != 3; ++axis) {
+		planes[axis * 2] = rows[3] + rows[axis];
+		planes[axis * 2 + 1] = rows[3] - rows[axis];
+	}
+	for (int plane = 0; plane != 6; ++plane) {
+		const float length = glm::length(glm::vec3(planes[plane]));
+		planes[plane] = length > 0.0f ? planes[plane] / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
+
+static bool outsideFrustum(const glm::vec3& center, float radius, const glm::vec4* planes)
+{
+	for (int plane = 0; plane != 6; ++plane) {
+		if (glm::dot(glm::vec3(planes[plane]), center) + planes[plane].w < -radius) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool cullMeshlet(const Meshlet& meshlet, const glm::vec4* planes, const glm::vec3& eye)
+{
+	const glm::vec3 center(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+	if (outsideFrustum(center, meshlet.radius, planes)) {
+		return true;
+	}
+	// The cone test with the bounding sphere in place of the cone's apex, conservative for every point of the sphere
+	const glm::vec3 axis(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+	const glm::vec3 toCenter = center - eye;
+	return glm::dot(toCenter, axis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+}
+
+void cullMeshlets(const Meshlet* meshlets, size_t count, const glm::mat4& world, const glm::mat4& viewProjection, const glm::vec3& eye,
+	std::vector<IndexRun>& runs, MeshletCullStats* stats)
+{
+	glm::vec4 planes[6];
+	getFrustumPlanes(viewProjection * world, planes);
+	const glm::vec3 localEye = glm::vec3(glm::inverse(world) * glm::vec4(eye, 1.0f));
+
+	runs.clear();
+	MeshletCullStats counted;
+	for (size_t i = 0; i != count; ++i) {
+		const Meshlet& meshlet = meshlets[i];
+		++counted.meshlets;
+		counted.triangles += meshlet.indexCount / 3;
+		if (cullMeshlet(meshlet, planes, localEye)) {
+			++counted.culledMeshlets;
+			counted.culledTriangles += meshlet.indexCount / 3;
+			continue;
+		}
+		if (!runs.empty() && runs.back().firstIndex + runs.back().indexCount == meshlet.firstIndex) {
+			runs.back().indexCount += meshlet.indexCount;
+		}
+		else {
+			IndexRun run;
+			run.firstIndex = meshlet.firstIndex;
+			run.indexCount = meshlet.indexCount;
+			runs.push_back(run);
+		}
+	}
+	if (stats) {
+		stats->add(counted);
+	}
+}
+
+// The largest scale of a transform, which stretches both spheres and errors
+static float getLargestScale(const glm::mat4& world)
+{
+	return std::max(glm::length(glm::vec3(world[0])), std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+}
+
+// getScreenError with the scale of the transform and the pixels per unit at distance 1 worked out
+static float projectError(float error, const glm::vec3& center, float radius, const glm::mat4& world, float scale,
+	float pixelsPerUnit, const glm::vec3& eye)
+{
+	if (error == 0.0f) {
+		return 0.0f;
+	}
+	const float distance = glm::length(glm::vec3(world * glm::vec4(center, 1.0f)) - eye) - radius * scale;
+	if (distance <= 0.0f) {
+		return FLT_MAX;
+	}
+	return std::min(error * scale, FLT_MAX / pixelsPerUnit) * pixelsPerUnit / distance;
+}
+
+float getScreenError(float error, const glm::vec3& center, float radius, const glm::mat4& world, const glm::vec3& eye,
+	float fovY, float viewportHeight)
+{
+	return projectError(error, center, radius, world, getLargestScale(world), viewportHeight / (2.0f * std::tan(fovY * 0.5f)), eye);
+}
+
+// Grow a sphere just enough to hold another one
+static void growSphere(glm::vec3& center, float& radius, const glm::vec3& otherCenter, float otherRadius)
+{
+	const float distance = glm::length(otherCenter - center);
+	if (distance + otherRadius <= radius) {
+		return;
+	}
+	if (distance + radius <= otherRadius) {
+		center = otherCenter;
+		radius = otherRadius;
+		return;
+	}
+	const float grown = (distance + radius + otherRadius) * 0.5f;
+	center += (otherCenter - center) * ((grown - radius) / distance);
+	radius = grown;
+}
+
+// Split the clusters of one level into groups of neighbouring clusters of about CLUSTER_GROUP_TRIANGLES triangles.
+// Every group grows from a seed, taking the neighbour that shares the most vertices with the whole group, and the next
+// seed is the neighbour of the last group with the fewest neighbours left, so groups leave few clusters stranded.
+// Clusters left alone are merged into the neighbouring group they share the most vertices with. Clusters are read
+// from indices followed by extraIndices, and groups hold positions in level.
+static std::vector<std::vector<uint32_t>> groupClusters(const std::vector<uint32_t>& level, const std::vector<ClusterLod>& clusters,
+	const uint32_t* indices, size_t count, const std::vector<uint32_t>& extraIndices, size_t vertexCount)
+{
+	std::vector<std::vector<uint32_t>> vertices(level.size());
+	for (size_t c = 0; c != level.size(); ++c) {
+		const ClusterLod& cluster = clusters[level[c]];
+		for (size_t i = cluster.firstIndex; i != cluster.firstIndex + cluster.indexCount; ++i) {
+			vertices[c].push_back(i < count ? indices[i] : extraIndices[i - count]);
+		}
+		std::sort(vertices[c].begin(), vertices[c].end());
+		vertices[c].erase(std::unique(vertices[c].begin(), vertices[c].end()), vertices[c].end());
+	}
+
+	// The clusters around every vertex
+	std::vector<uint32_t> firstUser(vertexCount + 1, 0);
+	for (const std::vector<uint32_t>& list : vertices) {
+		for (uint32_t vertex : list) {
+			++firstUser[vertex + 1];
+		}
+	}
+	for (size_t vertex = 0; vertex != vertexCount; ++vertex) {
+		firstUser[vertex + 1] += firstUser[vertex];
+	}
+	std::vector<uint32_t> users(firstUser.back());
+	std::vector<uint32_t> filled(firstUser.begin(), firstUser.end() - 1);
+	for (size_t c = 0; c != vertices.size(); ++c) {
+		for (uint32_t vertex : vertices[c]) {
+			users[filled[vertex]++] = static_cast<uint32_t>(c);
+		}
+	}
+
+	// Every neighbour of a cluster with the number of vertices they share
+	std::vector<std::vector<std::pair<uint32_t, uint32_t>>> neighbours(level.size());
+	std::vector<uint32_t> others;
+	for (size_t c = 0; c != vertices.size(); ++c) {
+		others.clear();
+		for (uint32_t vertex : vertices[c]) {
+			for (uint32_t user = firstUser[vertex]; user != firstUser[vertex + 1]; ++user) {
+				if (users[user] != c) {
+					others.push_back(users[user]);
+				}
+			}
+		}
+		std::sort(others.begin(), others.end());
+		for (size_t i = 0; i != others.size();) {
+			size_t run = i;
+			while (run != others.size() && others[run] == others[i]) {
+				++run;
+			}
+			neighbours[c].emplace_back(others[i], static_cast<uint32_t>(run - i));
+			i = run;
+		}
+	}
+
+	// The neighbours of every cluster not grouped yet
+	std::vector<uint32_t> open(level.size());
+	for (size_t c = 0; c != level.size(); ++c) {
+		open[c] = static_cast<uint32_t>(neighbours[c].size());
+	}
+	std::vector<uint32_t> groupOf(level.size(), UINT32_MAX);
+	std::vector<uint32_t> shared(level.size(), 0);
+	std::vector<uint32_t> candidates;
+	std::vector<std::vector<uint32_t>> groups;
+	size_t cursor = 0;
+	uint32_t seed = UINT32_MAX;
+	for (;;) {
+		if (seed == UINT32_MAX) {
+			while (cursor != level.size() && groupOf[cursor] != UINT32_MAX) {
+				++cursor;
+			}
+			if (cursor == level.size()) {
+				break;
+			}
+			seed = static_cast<uint32_t>(cursor);
+		}
+
+		const uint32_t g = static_cast<uint32_t>(groups.size());
+		groups.emplace_back();
+		std::vector<uint32_t>& group = groups.back();
+		size_t triangles = 0;
+		candidates.clear();
+		for (uint32_t member = seed; member != UINT32_MAX;) {
+			group.push_back(member);
+			groupOf[member] = g;
+			triangles += clusters[level[member]].indexCount / 3;
+			for (const std::pair<uint32_t, uint32_t>& neighbour : neighbours[member]) {
+				--open[neighbour.first];
+				if (groupOf[neighbour.first] == UINT32_MAX) {
+					if (shared[neighbour.first] == 0) {
+						candidates.push_back(neighbour.first);
+					}
+					shared[neighbour.first] += neighbour.second;
+				}
+			}
+			member = UINT32_MAX;
+			if (triangles >= CLUSTER_GROUP_TRIANGLES) {
+				break;
+			}
+			uint32_t bestShared = 0;
+			for (uint32_t candidate : candidates) {
+				if (groupOf[candidate] == UINT32_MAX && shared[candidate] > bestShared) {
+					member = candidate;
+					bestShared = shared[candidate];
+				}
+			}
+		}
+
+		// Seed the next group next to this one, in the corner with the fewest clusters left around it
+		seed = UINT32_MAX;
+		for (uint32_t candidate : candidates) {
+			if (groupOf[candidate] == UINT32_MAX && (seed == UINT32_MAX || open[candidate] < open[seed])) {
+				seed = candidate;
+			}
+			shared[candidate] = 0;
+		}
+	}
+
+	// A cluster left alone would be simplified without its neighbours, with all its borders locked
+	for (size_t g = 0; g != groups.size(); ++g) {
+		if (groups[g].size() != 1) {
+			continue;
+		}
+		const uint32_t single = groups[g][0];
+		uint32_t best = UINT32_MAX;
+		uint32_t bestShared = 0;
+		candidates.clear();
+		for (const std::pair<uint32_t, uint32_t>& neighbour : neighbours[single]) {
+			const uint32_t other = groupOf[neighbour.first];
+			if (shared[other] == 0) {
+				candidates.push_back(other);
+			}
+			shared[other] += neighbour.second;
+			if (shared[other] > bestShared) {
+				best = other;
+				bestShared = shared[other];
+			}
+		}
+		for (uint32_t candidate : candidates) {
+			shared[candidate] = 0;
+		}
+		if (best != UINT32_MAX) {
+			groups[best].push_back(single);
+			groupOf[single] = best;
+			groups[g].clear();
+		}
+	}
+	groups.erase(std::remove_if(groups.begin(), groups.end(), [](const std::vector<uint32_t>& group) { return group.empty(); }), groups.end());
+	return groups;
+}
+
+// The distinct vertices a triangle adds to a cluster, owner holds the cluster that last took every vertex
+static size_t countAdded(const uint32_t* corners, const std::vector<size_t>& owner, size_t cluster)
+{
+	size_t added = 0;
+	for (size_t c = 0; c != 3; ++c) {
+		const bool repeated = (c > 0 && corners[c] == corners[0]) || (c > 1 && corners[c] == corners[1]);
+		added += !repeated && owner[corners[c]] != cluster;
+	}
+	return added;
+}
+
+// Grow clusters of at most MESHLET_MAX_VERTICES vertices and maxTriangles triangles over a triangle list, every one
+// from a seed triangle over its neighbours. The next triangle taken adds the fewest vertices and has the fewest
+// triangles left around it, the next seed is the triangle next to the last cluster with the fewest left around it.
+// firstTriangle and triangles list the triangles around every vertex.
+static void growClusters(const uint32_t* indices, size_t triangleCount, size_t vertexCount, const std::vector<uint32_t>& firstTriangle,
+	const std::vector<uint32_t>& triangles, size_t maxTriangles, std::vector<std::vector<uint32_t>>& members)
+{
+	members.clear();
+	std::vector<uint32_t> live(vertexCount);
+	for (size_t vertex = 0; vertex != vertexCount; ++vertex) {
+		live[vertex] = firstTriangle[vertex + 1] - firstTriangle[vertex];
+	}
+	auto left = [&](uint32_t triangle) {
+		return live[indices[triangle * 3]] + live[indices[triangle * 3 + 1]] + live[indices[triangle * 3 + 2]];
+	};
+
+	std::vector<char> taken(triangleCount, 0);
+	std::vector<size_t> owner(vertexCount, ~size_t(0));
+	std::vector<uint32_t> candidates;
+	size_t cursor = 0;
+	uint32_t seed = UINT32_MAX;
+	for (;;) {
+		if (seed == UINT32_MAX) {
+			while (cursor != triangleCount && taken[cursor]) {
+				++cursor;
+			}
+			if (cursor == triangleCount) {
+				break;
+			}
+			seed = static_cast<uint32_t>(cursor);
+		}
+
+		const size_t id = members.size();
+		members.emplace_back();
+		std::vector<uint32_t>& cluster = members.back();
+		size_t clusterVertices = 0;
+		candidates.clear();
+		for (uint32_t triangle = seed; triangle != UINT32_MAX;) {
+			const uint32_t* corners = indices + triangle * 3;
+			taken[triangle] = 1;
+			cluster.push_back(triangle);
+			for (size_t c = 0; c != 3; ++c) {
+				const bool repeated = (c > 0 && corners[c] == corners[0]) || (c > 1 && corners[c] == corners[1]);
+				if (repeated) {
+					continue;
+				}
+				--live[corners[c]];
+				if (owner[corners[c]] == id) {
+					continue;
+				}
+				owner[corners[c]] = id;
+				++clusterVertices;
+				for (uint32_t t = firstTriangle[corners[c]]; t != firstTriangle[corners[c] + 1]; ++t) {
+					if (!taken[triangles[t]]) {
+						candidates.push_back(triangles[t]);
+					}
+				}
+			}
+
+			triangle = UINT32_MAX;
+			if (cluster.size() == maxTriangles) {
+				break;
+			}
+			size_t bestAdded = 4;
+			size_t bestLeft = 0;
+			for (uint32_t candidate : candidates) {
+				if (taken[candidate]) {
+					continue;
+				}
+				const size_t added = countAdded(indices + candidate * 3, owner, id);
+				if (clusterVertices + added <= MESHLET_MAX_VERTICES && (added < bestAdded || (added == bestAdded && left(candidate) < bestLeft))) {
+					triangle = candidate;
+					bestAdded = added;
+					bestLeft = left(candidate);
+				}
+			}
+		}
+
+		seed = UINT32_MAX;
+		for (uint32_t candidate : candidates) {
+			if (!taken[candidate] && (seed == UINT32_MAX || left(candidate) < left(seed))) {
+				seed = candidate;
+			}
+		}
+	}
+}
+
+// Cut a triangle list into clusters like buildMeshlets, but grown over neighbouring triangles instead of in order, so
+// the triangles a simplifier leaves scattered still fill whole clusters. Clusters filled to the limits leave the rest
+// of the list as one small cluster, so the list is cut again aiming at an even share of triangles per cluster, raised
+// until it takes as few clusters again. The list is reordered so every cluster is one run of it.
+static void buildClusters(uint32_t* indices, size_t count, const float* positions, size_t vertexCount, std::vector<Meshlet>& meshlets)
+{
+	const size_t triangleCount = count / 3;
+	std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+	for (size_t i = 0; i != triangleCount * 3; ++i) {
+		++firstTriangle[indices[i] + 1];
+	}
+	for (size_t vertex = 0; vertex != vertexCount; ++vertex) {
+		firstTriangle[vertex + 1] += firstTriangle[vertex];
+	}
+	std::vector<uint32_t> triangles(firstTriangle.back());
+	std::vector<uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+	for (size_t i = 0; i != triangleCount * 3; ++i) {
+		triangles[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<std::vector<uint32_t>> members;
+	growClusters(indices, triangleCount, vertexCount, firstTriangle, triangles, MESHLET_MAX_TRIANGLES, members);
+	auto smallest = [](const std::vector<std::vector<uint32_t>>& clusters) {
+		size_t size = MESHLET_MAX_TRIANGLES;
+		for (const std::vector<uint32_t>& cluster : clusters) {
+			size = std::min(size, cluster.size());
+		}
+		return size;
+	};
+	std::vector<std::vector<uint32_t>> balanced;
+	const size_t fewest = members.size();
+	for (size_t target = (triangleCount + fewest - 1) / std::max<size_t>(fewest, 1); fewest > 1 && smallest(members) * 2 < target &&
+		target < MESHLET_MAX_TRIANGLES; target += MESHLET_MAX_TRIANGLES / 16) {
+		growClusters(indices, triangleCount, vertexCount, firstTriangle, triangles, target, balanced);
+		if (balanced.size() == fewest) {
+			members.swap(balanced);
+			break;
+		}
+	}
+
+	std::vector<uint32_t> ordered;
+	ordered.reserve(triangleCount * 3);
+	for (const std::vector<uint32_t>& cluster : members) {
+		const size_t start = ordered.size();
+		for (uint32_t triangle : cluster) {
+			ordered.insert(ordered.end(), indices + triangle * 3, indices + triangle * 3 + 3);
+		}
+		Meshlet meshlet;
+		meshlet.firstIndex = static_cast<uint32_t>(start);
+		meshlet.indexCount = static_cast<uint32_t>(ordered.size() - start);
+		computeBounds(ordered.data() + start, ordered.size() - start, positions, meshlet);
+		meshlets.push_back(meshlet);
+	}
+	std::copy(ordered.begin(), ordered.end(), indices);
+}
+
+size_t buildClusterLod(const uint32_t* indices, size_t count, const float* positions, const float* normals, size_t vertexCount,
+	std::vector<ClusterLod>& clusters, std::vector<uint32_t>& extraIndices)
+{
+	clusters.clear();
+	extraIndices.clear();
+	count = count / 3 * 3;
+
+	// The finest level is the meshlets of the list, drawn from the list itself
+	std::vector<Meshlet> meshlets;
+	buildMeshlets(indices, count, positions, vertexCount, meshlets);
+	std::vector<uint32_t> level;
+	for (const Meshlet& meshlet : meshlets) {
+		ClusterLod cluster;
+		cluster.firstIndex = meshlet.firstIndex;
+		cluster.indexCount = meshlet.indexCount;
+		std::copy(std::begin(meshlet.center), std::end(meshlet.center), cluster.center);
+		cluster.radius = meshlet.radius;
+		level.push_back(static_cast<uint32_t>(clusters.size()));
+		clusters.push_back(cluster);
+	}
+	if (clusters.empty()) {
+		return 0;
+	}
+
+	size_t levels = 1;
+	std::vector<uint32_t> local(vertexCount, UINT32_MAX);
+	std::vector<uint32_t> owner(vertexCount);
+	std::vector<unsigned char> border(vertexCount);
+	std::vector<unsigned char> groupLocked;
+	std::vector<uint32_t> groupVertices;
+	std::vector<uint32_t> groupIndices;
+	std::vector<uint32_t> simplified;
+	std::vector<float> groupPositions;
+	std::vector<float> groupNormals;
+	while (level.size() > 1) {
+		std::vector<uint32_t> next;
+		bool simplifiedAny = false;
+		const std::vector<std::vector<uint32_t>> groups = groupClusters(level, clusters, indices, count, extraIndices, vertexCount);
+
+		// The vertices the clusters of several groups use are the borders between groups. They stay where they are,
+		// so every group still meets its neighbours whichever level each is drawn at. Edges shared by more than two
+		// triangles can look closed to the groups on either side, so the borders are not left to the simplifier to find.
+		std::fill(owner.begin(), owner.end(), UINT32_MAX);
+		std::fill(border.begin(), border.end(), 0);
+		for (size_t g = 0; g != groups.size(); ++g) {
+			for (uint32_t member : groups[g]) {
+				const ClusterLod& cluster = clusters[level[member]];
+				for (size_t i = cluster.firstIndex; i != cluster.firstIndex + cluster.indexCount; ++i) {
+					const uint32_t vertex = i < count ? indices[i] : extraIndices[i - count];
+					if (owner[vertex] == UINT32_MAX) {
+						owner[vertex] = static_cast<uint32_t>(g);
+					}
+					else if (owner[vertex] != g) {
+						border[vertex] = 1;
+					}
+				}
+			}
+		}
+
+		for (const std::vector<uint32_t>& group : groups) {
+			// The group's triangles over its own vertices
+			groupVertices.clear();
+			groupIndices.clear();
+			for (uint32_t member : group) {
+				const ClusterLod& cluster = clusters[level[member]];
+				for (size_t i = cluster.firstIndex; i != cluster.firstIndex + cluster.indexCount; ++i) {
+					const uint32_t vertex = i < count ? indices[i] : extraIndices[i - count];
+					if (local[vertex] == UINT32_MAX) {
+						local[vertex] = static_cast<uint32_t>(groupVertices.size());
+						groupVertices.push_back(vertex);
+					}
+					groupIndices.push_back(local[vertex]);
+				}
+			}
+			groupPositions.resize(groupVertices.size() * 3);
+			groupNormals.resize(normals ? groupVertices.size() * 3 : 0);
+			groupLocked.resize(groupVertices.size());
+			for (size_t v = 0; v != groupVertices.size(); ++v) {
+				std::copy(positions + groupVertices[v] * 3, positions + groupVertices[v] * 3 + 3, groupPositions.begin() + v * 3);
+				if (normals) {
+					std::copy(normals + groupVertices[v] * 3, normals + groupVertices[v] * 3 + 3, groupNormals.begin() + v * 3);
+				}
+				groupLocked[v] = border[groupVertices[v]];
+				local[groupVertices[v]] = UINT32_MAX;
+			}
+
+			simplified.resize(groupIndices.size());
+			float error = 0.0f;
+			const size_t kept = simplifyMesh(groupIndices.data(), groupIndices.size(), groupPositions.data(), normals ? groupNormals.data() : nullptr,
+				groupVertices.size(), groupIndices.size() / 6 * 3, FLT_MAX, simplified.data(), error, groupLocked.data());
+			if (kept == 0 || kept > groupIndices.size() * MIN_GROUP_REDUCTION) {
+				for (uint32_t member : group) {
+					next.push_back(level[member]);
+				}
+				continue;
+			}
+			simplifiedAny = true;
+
+			// The group's sphere holds the spheres of its clusters and its error is at least theirs, so the group
+			// never covers fewer pixels than a cluster it replaces
+			const ClusterLod& seed = clusters[level[group[0]]];
+			glm::vec3 center(seed.center[0], seed.center[1], seed.center[2]);
+			float radius = seed.radius;
+			for (uint32_t member : group) {
+				const ClusterLod& cluster = clusters[level[member]];
+				growSphere(center, radius, glm::vec3(cluster.center[0], cluster.center[1], cluster.center[2]), cluster.radius);
+				error = std::max(error, cluster.error);
+			}
+			for (uint32_t member : group) {
+				ClusterLod& cluster = clusters[level[member]];
+				for (int component = 0; component != 3; ++component) {
+					cluster.parentCenter[component] = center[component];
+				}
+				cluster.parentRadius = radius;
+				cluster.parentError = error;
+			}
+
+			std::vector<Meshlet> parts;
+			buildClusters(simplified.data(), kept, groupPositions.data(), groupVertices.size(), parts);
+			for (const Meshlet& part : parts) {
+				ClusterLod cluster;
+				cluster.firstIndex = static_cast<uint32_t>(count + extraIndices.size());
+				cluster.indexCount = part.indexCount;
+				for (size_t i = part.firstIndex; i != part.firstIndex + part.indexCount; ++i) {
+					extraIndices.push_back(groupVertices[simplified[i]]);
+				}
+				for (int component = 0; component != 3; ++component) {
+					cluster.center[component] = center[component];
+				}
+				cluster.radius = radius;
+				cluster.error = error;
+				next.push_back(static_cast<uint32_t>(clusters.size()));
+				clusters.push_back(cluster);
+			}
+		}
+		if (!simplifiedAny) {
+			break;
+		}
+		level.swap(next);
+		++levels;
+	}
+	return levels;
+}
+
+size_t selectClusters(const ClusterLod* clusters, size_t count, const glm::mat4& world, const glm::mat4& viewProjection,
+	const glm::vec3& eye, float fovY, float viewportHeight, float pixelError, std::vector<IndexRun>& runs)
+{
+	glm::vec4 planes[6];
+	getFrustumPlanes(viewProjection * world, planes);
+	const float scale = getLargestScale(world);
+	const float pixelsPerUnit = viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+
+	runs.clear();
+	size_t triangles = 0;
+	for (size_t i = 0; i != count; ++i) {
+		const ClusterLod& cluster = clusters[i];
+		const glm::vec3 center(cluster.center[0], cluster.center[1], cluster.center[2]);
+		const glm::vec3 parentCenter(cluster.parentCenter[0], cluster.parentCenter[1], cluster.parentCenter[2]);
+		if (projectError(cluster.error, center, cluster.radius, world, scale, pixelsPerUnit, eye) > pixelError ||
+			projectError(cluster.parentError, parentCenter, cluster.parentRadius, world, scale, pixelsPerUnit, eye) <= pixelError ||
+			outsideFrustum(center, cluster.radius, planes)) {
+			continue;
+		}
+		triangles += cluster.indexCount / 3;
+		if (!runs.empty() && runs.back().firstIndex + runs.back().indexCount == cluster.firstIndex) {
+			runs.back().indexCount += cluster.indexCount;
+		}
+		else {
+			IndexRun run;
+			run.firstIndex = cluster.firstIndex;
+			run.indexCount = cluster.indexCount;
+			runs.push_back(run);
+		}
+	}
+	return triangles;
+}
@@ -0,0 +1,824 @@
+#include "../include/meshopt_decode.h"
+#include "../include/cpu_features.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(GLTF_X86)
+#include <immintrin.h>
+#endif
+
+
+// The first byte of every stream, the low nibble holds the version
+const unsigned char ATTRIBUTE_HEADER = 0xA0;
+const unsigned char TRIANGLE_HEADER = 0xE0;
+const unsigned char SEQUENCE_HEADER = 0xD0;
+
+// Attribute data is split into blocks of at most this many bytes and vertices,
+// and each byte of a vertex is coded across the block in groups of 16
+const size_t BLOCK_MAX_BYTES = 8192;
+const size_t BLOCK_MAX_VERTICES = 256;
+const size_t GROUP_SIZE = 16;
+// The most bytes one group can take, a group is only decoded with this much data left
+const size_t GROUP_DECODE_LIMIT = 24;
+// The attribute stream ends with the first vertex, padded to at least this size
+const size_t TAIL_MIN_SIZE = 32;
+
+static inline unsigned char unzigzag8(unsigned char value)
+{
+	return static_cast<unsigned char>(-(value & 1) ^ (value >> 1));
+}
+
+// The vertices of every attribute block, a multiple of the group size
+static size_t getBlockVertices(size_t byteStride)
+{
+	const size_t vertices = (BLOCK_MAX_BYTES / byteStride) & ~(GROUP_SIZE - 1);
+	return vertices < BLOCK_MAX_VERTICES ? vertices : BLOCK_MAX_VERTICES;
+}
+
+// Decode a group of 16 bytes stored with 0, 2, 4 or 8 bits each. Values that do not fit
+// in 2 or 4 bits are stored as all ones and follow the packed bits in full.
+static const unsigned char* decodeGroup(const unsigned char* data, unsigned char* out, int bitsLog2)
+{
+	if (bitsLog2 == 0) {
+		std::memset(out, 0, GROUP_SIZE);
+		return data;
+	}
+	if (bitsLog2 == 3) {
+		std::memcpy(out, data, GROUP_SIZE);
+		return data + GROUP_SIZE;
+	}
+
+	const int bits = bitsLog2 == 1 ? 2 : 4;
+	const unsigned char sentinel = static_cast<unsigned char>((1 << bits) - 1);
+	const unsigned char* packed = data;
+	const unsigned char* extra = data + bits * 2;
+	for (size_t i = 0; i != GROUP_SIZE; ) {
+		unsigned char byte = *packed++;
+		for (int k = 0; k != 8 / bits; ++k, ++i) {
+			const unsigned char value = static_cast<unsigned char>(byte >> (8 - bits));
+			byte = static_cast<unsigned char>(byte << bits);
+			out[i] = value == sentinel ? *extra : value;
+			extra += value == sentinel;
+		}
+	}
+	return extra;
+}
+
+// Decode the groups of one byte of every vertex in a block, the group widths come first, 2 bits each
+static const unsigned char* decodeBytes(const unsigned char* data, const unsigned char* dataEnd, unsigned char* out, size_t size)
+{
+	const unsigned char* header = data;
+	const size_t headerSize = (size / GROUP_SIZE + 3) / 4;
+	if (static_cast<size_t>(dataEnd - data) < headerSize) {
+		return nullptr;
+	}
+	data += headerSize;
+
+	for (size_t i = 0; i < size; i += GROUP_SIZE) {
+		if (static_cast<size_t>(dataEnd - data) < GROUP_DECODE_LIMIT) {
+			return nullptr;
+		}
+		const size_t group = i / GROUP_SIZE;
+		const int bitsLog2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+		data = decodeGroup(data, out + i, bitsLog2);
+	}
+	return data;
+}
+
+// Every byte of a vertex is stored as the zigzag delta from the same byte of the previous vertex
+static const unsigned char* decodeBlock(const unsigned char* data, const unsigned char* dataEnd, unsigned char* out, size_t count, size_t byteStride, unsigned char* lastVertex)
+{
+	unsigned char deltas[BLOCK_MAX_VERTICES];
+	unsigned char transposed[BLOCK_MAX_BYTES];
+	const size_t countAligned = (count + GROUP_SIZE - 1) & ~(GROUP_SIZE - 1);
+
+	for (size_t k = 0; k != byteStride; ++k) {
+		data = decodeBytes(data, dataEnd, deltas, countAligned);
+		if (data == nullptr) {
+			return nullptr;
+		}
+		unsigned char previous = lastVertex[k];
+		for (size_t i = 0; i != count; ++i) {
+			previous = static_cast<unsigned char>(previous + unzigzag8(deltas[i]));
+			transposed[i * byteStride + k] = previous;
+		}
+	}
+
+	std::memcpy(out, transposed, count * byteStride);
+	std::memcpy(lastVertex, transposed + (count - 1) * byteStride, byteStride);
+	return data;
+}
+
+#if defined(GLTF_X86)
+
+// For every 8 bit mask of the group bytes stored in full, the shuffle that moves them into place and their count
+struct GroupShuffleTable {
+	alignas(8) unsigned char shuffle[256][8];
+	unsigned char count[256];
+
+	GroupShuffleTable() {
+		for (int mask = 0; mask != 256; ++mask) {
+			unsigned char next = 0;
+			for (int bit = 0; bit != 8; ++bit) {
+				shuffle[mask][bit] = (mask & (1 << bit)) ? next++ : 0x80;
+			}
+			count[mask] = next;
+		}
+	}
+};
+
+static const GroupShuffleTable groupShuffle;
+
+// decodeGroup with the packed values spread to bytes by shifts and the full ones gathered by one shuffle.
+// Reading 16 bytes past the packed bits stays within the decode limit.
+GLTF_TARGET("ssse3")
+static const unsigned char* decodeGroupSSSE3(const unsigned char* data, unsigned char* out, int bitsLog2)
+{
+	__m128i selectors;
+	__m128i full;
+	size_t packedSize;
+	switch (bitsLog2) {
+	case 0:
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_setzero_si128());
+		return data;
+	case 1: {
+		int bits;
+		std::memcpy(&bits, data, sizeof(bits));
+		const __m128i packed = _mm_cvtsi32_si128(bits);
+		const __m128i pairs = _mm_unpacklo_epi8(_mm_srli_epi16(packed, 4), packed);
+		const __m128i quads = _mm_unpacklo_epi8(_mm_srli_epi16(pairs, 2), pairs);
+		selectors = _mm_and_si128(quads, _mm_set1_epi8(3));
+		full = _mm_cmpeq_epi8(selectors, _mm_set1_epi8(3));
+		packedSize = 4;
+		break;
+	}
+	case 2: {
+		const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+		const __m128i pairs = _mm_unpacklo_epi8(_mm_srli_epi16(packed, 4), packed);
+		selectors = _mm_and_si128(pairs, _mm_set1_epi8(15));
+		full = _mm_cmpeq_epi8(selectors, _mm_set1_epi8(15));
+		packedSize = 8;
+		break;
+	}
+	default:
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+		return data + GROUP_SIZE;
+	}
+
+	const __m128i rest = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + packedSize));
+	const int mask = _mm_movemask_epi8(full);
+	const unsigned char mask0 = static_cast<unsigned char>(mask & 255);
+	const unsigned char mask1 = static_cast<unsigned char>(mask >> 8);
+
+	// The second half continues where the first stopped, unused lanes keep their high bit and read as zero
+	const __m128i shuffle0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(groupShuffle.shuffle[mask0]));
+	const __m128i shuffle1 = _mm_add_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(groupShuffle.shuffle[mask1])),
+		_mm_set1_epi8(static_cast<char>(groupShuffle.count[mask0])));
+	const __m128i shuffle = _mm_unpacklo_epi64(shuffle0, shuffle1);
+
+	const __m128i result = _mm_or_si128(_mm_shuffle_epi8(rest, shuffle), _mm_andnot_si128(full, selectors));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out), result);
+	return data + packedSize + groupShuffle.count[mask0] + groupShuffle.count[mask1];
+}
+
+GLTF_TARGET("ssse3")
+static const unsigned char* decodeBytesSSSE3(const unsigned char* data, const unsigned char* dataEnd, unsigned char* out, size_t size)
+{
+	const unsigned char* header = data;
+	const size_t headerSize = (size / GROUP_SIZE + 3) / 4;
+	if (static_cast<size_t>(dataEnd - data) < headerSize) {
+		return nullptr;
+	}
+	data += headerSize;
+
+	for (size_t i = 0; i < size; i += GROUP_SIZE) {
+		if (static_cast<size_t>(dataEnd - data) < GROUP_DECODE_LIMIT) {
+			return nullptr;
+		}
+		const size_t group = i / GROUP_SIZE;
+		const int bitsLog2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+		data = decodeGroupSSSE3(data, out + i, bitsLog2);
+	}
+	return data;
+}
+
+// Undo the zigzag and sum the deltas of 16 vertices, carry holds the previous value in every lane
+GLTF_TARGET("ssse3")
+static inline __m128i accumulate(__m128i deltas, __m128i& carry)
+{
+	const __m128i one = _mm_set1_epi8(1);
+	const __m128i values = _mm_xor_si128(_mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(deltas, one)),
+		_mm_and_si128(_mm_srli_epi16(deltas, 1), _mm_set1_epi8(127)));
+	__m128i sum = _mm_add_epi8(values, _mm_slli_si128(values, 1));
+	sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 2));
+	sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 4));
+	sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 8));
+	sum = _mm_add_epi8(sum, carry);
+	carry = _mm_shuffle_epi8(sum, _mm_set1_epi8(15));
+	return sum;
+}
+
+// decodeBlock four bytes of the vertex at a time, transposed back into vertices with unpacks.
+// Vertices past count are decoded too, the block buffer is sized for a whole number of groups.
+GLTF_TARGET("ssse3")
+static const unsigned char* decodeBlockSSSE3(const unsigned char* data, const unsigned char* dataEnd, unsigned char* out, size_t count, size_t byteStride, unsigned char* lastVertex)
+{
+	alignas(16) unsigned char deltas[4][BLOCK_MAX_VERTICES];
+	alignas(16) unsigned char transposed[BLOCK_MAX_BYTES];
+	const size_t countAligned = (count + GROUP_SIZE - 1) & ~(GROUP_SIZE - 1);
+
+	for (size_t k = 0; k != byteStride; k += 4) {
+		__m128i carry[4];
+		for (size_t j = 0; j != 4; ++j) {
+			data = decodeBytesSSSE3(data, dataEnd, deltas[j], countAligned);
+			if (data == nullptr) {
+				return nullptr;
+			}
+			carry[j] = _mm_set1_epi8(static_cast<char>(lastVertex[k + j]));
+		}
+
+		for (size_t i = 0; i != countAligned; i += GROUP_SIZE) {
+			const __m128i byte0 = accumulate(_mm_load_si128(reinterpret_cast<const __m128i*>(deltas[0] + i)), carry[0]);
+			const __m128i byte1 = accumulate(_mm_load_si128(reinterpret_cast<const __m128i*>(deltas[1] + i)), carry[1]);
+			const __m128i byte2 = accumulate(_mm_load_si128(reinterpret_cast<const __m128i*>(deltas[2] + i)), carry[2]);
+			const __m128i byte3 = accumulate(_mm_load_si128(reinterpret_cast<const __m128i*>(deltas[3] + i)), carry[3]);
+
+			const __m128i low01 = _mm_unpacklo_epi8(byte0, byte1);
+			const __m128i high01 = _mm_unpackhi_epi8(byte0, byte1);
+			const __m128i low23 = _mm_unpacklo_epi8(byte2, byte3);
+			const __m128i high23 = _mm_unpackhi_epi8(byte2, byte3);
+			__m128i quads[4] = {
+				_mm_unpacklo_epi16(low01, low23),
+				_mm_unpackhi_epi16(low01, low23),
+				_mm_unpacklo_epi16(high01, high23),
+				_mm_unpackhi_epi16(high01, high23)
+			};
+
+			unsigned char* vertex = transposed + i * byteStride + k;
+			for (__m128i& quad : quads) {
+				for (int v = 0; v != 4; ++v, vertex += byteStride) {
+					const int bytes = _mm_cvtsi128_si32(quad);
+					std::memcpy(vertex, &bytes, sizeof(bytes));
+					quad = _mm_srli_si128(quad, 4);
+				}
+			}
+		}
+	}
+
+	std::memcpy(out, transposed, count * byteStride);
+	std::memcpy(lastVertex, transposed + (count - 1) * byteStride, byteStride);
+	return data;
+}
+
+#endif
+
+bool decodeMeshoptAttributes(unsigned char* out, size_t count, size_t byteStride, const unsigned char* data, size_t size)
+{
+	if (byteStride == 0 || byteStride > 256 || byteStride % 4 != 0) {
+		return false;
+	}
+	if (size < 1 + byteStride || (data[0] & 0xF0) != ATTRIBUTE_HEADER || (data[0] & 0x0F) > 0) {
+		return false;
+	}
+	const unsigned char* dataEnd = data + size;
+
+	// The stream ends with the first vertex, each block starts from the last vertex of the one before
+	unsigned char lastVertex[256];
+	std::memcpy(lastVertex, dataEnd - byteStride, byteStride);
+	++data;
+
+#if defined(GLTF_X86)
+	const bool simd = getCpuFeatures().ssse3;
+#else
+	const bool simd = false;
+#endif
+	const size_t blockVertices = getBlockVertices(byteStride);
+	for (size_t first = 0; first < count; first += blockVertices) {
+		const size_t blockCount = count - first < blockVertices ? count - first : blockVertices;
+		unsigned char* block = out + first * byteStride;
+#if defined(GLTF_X86)
+		if (simd) {
+			data = decodeBlockSSSE3(data, dataEnd, block, blockCount, byteStride, lastVertex);
+		}
+		else
+#endif
+		{
+			data = decodeBlock(data, dataEnd, block, blockCount, byteStride, lastVertex);
+		}
+		if (data == nullptr) {
+			return false;
+		}
+	}
+	(void)simd;
+
+	const size_t tailSize = byteStride < TAIL_MIN_SIZE ? TAIL_MIN_SIZE : byteStride;
+	return static_cast<size_t>(dataEnd - data) == tailSize;
+}
+
+
+// Triangles are coded against a FIFO of recent edges and one of recent vertices
+typedef unsigned int VertexFifo[16];
+typedef unsigned int EdgeFifo[16][2];
+
+static inline void pushEdge(EdgeFifo fifo, unsigned int a, unsigned int b, size_t& offset)
+{
+	fifo[offset][0] = a;
+	fifo[offset][1] = b;
+	offset = (offset + 1) & 15;
+}
+
+static inline void pushVertex(VertexFifo fifo, unsigned int v, size_t& offset, bool push = true)
+{
+	fifo[offset] = v;
+	offset = (offset + push) & 15;
+}
+
+// A little endian base 128 integer of at most 5 bytes
+static inline unsigned int decodeVByte(const unsigned char*& data)
+{
+	const unsigned char lead = *data++;
+	if (lead < 128) {
+		return lead;
+	}
+	unsigned int result = lead & 127;
+	unsigned int shift = 7;
+	for (int i = 0; i != 4; ++i) {
+		const unsigned char group = *data++;
+		result |= static_cast<unsigned int>(group & 127) << shift;
+		shift += 7;
+		if (group < 128) {
+			break;
+		}
+	}
+	return result;
+}
+
+// An index stored as the zigzag delta from the last one
+static inline unsigned int decodeIndex(const unsigned char*& data, unsigned int last)
+{
+	const unsigned int value = decodeVByte(data);
+	return last + ((value >> 1) ^ (0u - (value & 1)));
+}
+
+static inline void writeTriangle(unsigned char* out, size_t i, size_t indexSize, unsigned int a, unsigned int b, unsigned int c)
+{
+	if (indexSize == 2) {
+		const uint16_t triangle[3] = { static_cast<uint16_t>(a), static_cast<uint16_t>(b), static_cast<uint16_t>(c) };
+		std::memcpy(out + i * 2, triangle, sizeof(triangle));
+	}
+	else {
+		const uint32_t triangle[3] = { a, b, c };
+		std::memcpy(out + i * 4, triangle, sizeof(triangle));
+	}
+}
+
+bool decodeMeshoptTriangles(unsigned char* out, size_t count, size_t indexSize, const unsigned char* data, size_t size)
+{
+	if (count % 3 != 0 || (indexSize != 2 && indexSize != 4)) {
+		return false;
+	}
+	// At least the header, one code per triangle and the 16 byte table of auxiliary codes
+	if (size < 1 + count / 3 + 16 || (data[0] & 0xF0) != TRIANGLE_HEADER || (data[0] & 0x0F) > 1) {
+		return false;
+	}
+	const int version = data[0] & 0x0F;
+
+	EdgeFifo edges;
+	VertexFifo vertices;
+	std::memset(edges, -1, sizeof(edges));
+	std::memset(vertices, -1, sizeof(vertices));
+	size_t edgeOffset = 0;
+	size_t vertexOffset = 0;
+	unsigned int next = 0;
+	unsigned int last = 0;
+	const int fecMax = version >= 1 ? 13 : 15;
+
+	// Each triangle reads at most 16 bytes past its code, the table at the end keeps those reads in bounds
+	const unsigned char* code = data + 1;
+	const unsigned char* extra = code + count / 3;
+	const unsigned char* extraEnd = data + size - 16;
+	const unsigned char* auxTable = extraEnd;
+
+	for (size_t i = 0; i < count; i += 3) {
+		if (extra > extraEnd) {
+			return false;
+		}
+		const unsigned char codeTriangle = *code++;
+
+		if (codeTriangle < 0xF0) {
+			// Two vertices from a recent edge, the third is new, recent or stored
+			const int fe = codeTriangle >> 4;
+			const unsigned int a = edges[(edgeOffset - 1 - fe) & 15][0];
+			const unsigned int b = edges[(edgeOffset - 1 - fe) & 15][1];
+			const int fec = codeTriangle & 15;
+
+			unsigned int c;
+			if (fec < fecMax) {
+				c = fec == 0 ? next : vertices[(vertexOffset - 1 - fec) & 15];
+				next += fec == 0;
+				pushVertex(vertices, c, vertexOffset, fec == 0);
+			}
+			else {
+				// 13 and 14 step the last stored index down or up by one
+				c = last = fec != 15 ? last + (fec - (fec ^ 3)) : decodeIndex(extra, last);
+				pushVertex(vertices, c, vertexOffset);
+			}
+			writeTriangle(out, i, indexSize, a, b, c);
+			pushEdge(edges, c, b, edgeOffset);
+			pushEdge(edges, a, c, edgeOffset);
+		}
+		else if (codeTriangle < 0xFE) {
+			// The first vertex is new, the other two are described by an entry of the table
+			const unsigned char codeAux = auxTable[codeTriangle & 15];
+			const int feb = codeAux >> 4;
+			const int fec = codeAux & 15;
+
+			const unsigned int a = next++;
+			const unsigned int b = feb == 0 ? next : vertices[(vertexOffset - feb) & 15];
+			next += feb == 0;
+			const unsigned int c = fec == 0 ? next : vertices[(vertexOffset - fec) & 15];
+			next += fec == 0;
+
+			writeTriangle(out, i, indexSize, a, b, c);
+			pushVertex(vertices, a, vertexOffset);
+			pushVertex(vertices, b, vertexOffset, feb == 0);
+			pushVertex(vertices, c, vertexOffset, fec == 0);
+			pushEdge(edges, b, a, edgeOffset);
+			pushEdge(edges, c, b, edgeOffset);
+			pushEdge(edges, a, c, edgeOffset);
+		}
+		else {
+			// The auxiliary code is stored in full, a zero restarts the new vertex counter
+			const unsigned char codeAux = *extra++;
+			const int fea = codeTriangle == 0xFE ? 0 : 15;
+			const int feb = codeAux >> 4;
+			const int fec = codeAux & 15;
+			if (codeAux == 0) {
+				next = 0;
+			}
+
+			unsigned int a = fea == 0 ? next++ : 0;
+			unsigned int b = feb == 0 ? next++ : vertices[(vertexOffset - feb) & 15];
+			unsigned int c = fec == 0 ? next++ : vertices[(vertexOffset - fec) & 15];
+			if (fea == 15) {
+				last = a = decodeIndex(extra, last);
+			}
+			if (feb == 15) {
+				last = b = decodeIndex(extra, last);
+			}
+			if (fec == 15) {
+				last = c = decodeIndex(extra, last);
+			}
+
+			writeTriangle(out, i, indexSize, a, b, c);
+			pushVertex(vertices, a, vertexOffset);
+			pushVertex(vertices, b, vertexOffset, feb == 0 || feb == 15);
+			pushVertex(vertices, c, vertexOffset, fec == 0 || fec == 15);
+			pushEdge(edges, b, a, edgeOffset);
+			pushEdge(edges, c, b, edgeOffset);
+			pushEdge(edges, a, c, edgeOffset);
+		}
+	}
+
+	// Every stored byte has to be consumed, up to the table
+	return extra == extraEnd;
+}
+
+bool decodeMeshoptIndices(unsigned char* out, size_t count, size_t indexSize, const unsigned char* data, size_t size)
+{
+	if (indexSize != 2 && indexSize != 4) {
+		return false;
+	}
+	// At least the header, one byte per index and a 4 byte tail
+	if (size < 1 + count + 4 || (data[0] & 0xF0) != SEQUENCE_HEADER || (data[0] & 0x0F) > 1) {
+		return false;
+	}
+
+	// Each index is a delta from one of two baselines, the lowest bit picks which
+	const unsigned char* extra = data + 1;
+	const unsigned char* extraEnd = data + size - 4;
+	unsigned int last[2] = { 0, 0 };
+	for (size_t i = 0; i != count; ++i) {
+		if (extra >= extraEnd) {
+			return false;
+		}
+		unsigned int value = decodeVByte(extra);
+		const unsigned int baseline = value & 1;
+		value >>= 1;
+		const unsigned int index = last[baseline] + ((value >> 1) ^ (0u - (value & 1)));
+		last[baseline] = index;
+
+		if (indexSize == 2) {
+			const uint16_t narrow = static_cast<uint16_t>(index);
+			std::memcpy(out + i * 2, &narrow, sizeof(narrow));
+		}
+		else {
+			std::memcpy(out + i * 4, &index, sizeof(index));
+		}
+	}
+	return extra == extraEnd;
+}
+
+
+// Truncate toward zero like the SIMD conversion, which turns values out of range into INT32_MIN
+static inline int truncate(float value)
+{
+	return value > -2147483904.0f && value < 2147483648.0f ? static_cast<int>(value) : INT32_MIN;
+}
+
+// Round half away from zero
+static inline int roundSigned(float value)
+{
+	return truncate(value + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+// Each element holds x and y of the octahedral map, the component size in z and an untouched fourth component
+template<typename T>
+static void unfilterOctahedral(unsigned char* data, size_t first, size_t count)
+{
+	const float scale = static_cast<float>((1 << (sizeof(T) * 8 - 1)) - 1);
+	for (size_t i = first; i < count; ++i) {
+		T element[4];
+		std::memcpy(element, data + i * sizeof(element), sizeof(element));
+
+		float x = static_cast<float>(element[0]);
+		float y = static_cast<float>(element[1]);
+		const float z = static_cast<float>(element[2]) - std::fabs(x) - std::fabs(y);
+
+		// Fold the lower hemisphere back
+		const float t = z < 0.0f ? z : 0.0f;
+		x += x >= 0.0f ? t : -t;
+		y += y >= 0.0f ? t : -t;
+
+		const float length = std::sqrt(x * x + y * y + z * z);
+		const float s = scale / length;
+		element[0] = static_cast<T>(roundSigned(x * s));
+		element[1] = static_cast<T>(roundSigned(y * s));
+		element[2] = static_cast<T>(roundSigned(z * s));
+		std::memcpy(data + i * sizeof(element), element, sizeof(element));
+	}
+}
+
+// Each element holds the three smallest components, scaled by sqrt(2), then the precision and which component was dropped
+static void unfilterQuaternion(unsigned char* data, size_t first, size_t count)
+{
+	const float scale = 1.0f / std::sqrt(2.0f);
+	for (size_t i = first; i < count; ++i) {
+		int16_t element[4];
+		std::memcpy(element, data + i * sizeof(element), sizeof(element));
+
+		const float s = scale / static_cast<float>(element[3] | 3);
+		const float x = static_cast<float>(element[0]) * s;
+		const float y = static_cast<float>(element[1]) * s;
+		const float z = static_cast<float>(element[2]) * s;
+		const float ww = 1.0f - x * x - y * y - z * z;
+		const float w = std::sqrt(ww >= 0.0f ? ww : 0.0f);
+
+		const int dropped = element[3] & 3;
+		int16_t result[4];
+		result[(dropped + 1) & 3] = static_cast<int16_t>(roundSigned(x * 32767.0f));
+		result[(dropped + 2) & 3] = static_cast<int16_t>(roundSigned(y * 32767.0f));
+		result[(dropped + 3) & 3] = static_cast<int16_t>(roundSigned(z * 32767.0f));
+		result[dropped] = static_cast<int16_t>(truncate(w * 32767.0f + 0.5f));
+		std::memcpy(data + i * sizeof(result), result, sizeof(result));
+	}
+}
+
+// Each 32 bit value holds a signed 24 bit mantissa below a signed 8 bit exponent
+static void unfilterExponential(unsigned char* data, size_t first, size_t count)
+{
+	for (size_t i = first; i < count; ++i) {
+		uint32_t value;
+		std::memcpy(&value, data + i * sizeof(value), sizeof(value));
+		const int mantissa = static_cast<int32_t>(value << 8) >> 8;
+		const int exponent = static_cast<int32_t>(value) >> 24;
+
+		// ldexp without the library call: the power of two is built from its bits
+		const uint32_t powerBits = static_cast<uint32_t>(exponent + 127) << 23;
+		float power;
+		std::memcpy(&power, &powerBits, sizeof(power));
+		const float result = power * static_cast<float>(mantissa);
+		std::memcpy(data + i * sizeof(result), &result, sizeof(result));
+	}
+}
+
+#if defined(GLTF_X86)
+
+// The same arithmetic as the scalar filters, in the same order, so both give identical results
+GLTF_TARGET("sse4.1")
+static inline __m128 signOf(__m128 value)
+{
+	return _mm_and_ps(_mm_cmplt_ps(value, _mm_setzero_ps()), _mm_set1_ps(-0.0f));
+}
+
+GLTF_TARGET("sse4.1")
+static inline __m128i roundSignedSSE41(__m128 value)
+{
+	return _mm_cvttps_epi32(_mm_add_ps(value, _mm_xor_ps(_mm_set1_ps(0.5f), signOf(value))));
+}
+
+GLTF_TARGET("sse4.1")
+static inline void octahedralSSE41(__m128i xi, __m128i yi, __m128i zi, float scale, __m128i& xr, __m128i& yr, __m128i& zr)
+{
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 x = _mm_cvtepi32_ps(xi);
+	__m128 y = _mm_cvtepi32_ps(yi);
+	const __m128 z = _mm_sub_ps(_mm_sub_ps(_mm_cvtepi32_ps(zi), _mm_and_ps(x, absMask)), _mm_and_ps(y, absMask));
+
+	const __m128 t = _mm_min_ps(z, _mm_setzero_ps());
+	x = _mm_add_ps(x, _mm_xor_ps(t, signOf(x)));
+	y = _mm_add_ps(y, _mm_xor_ps(t, signOf(y)));
+
+	const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+	const __m128 s = _mm_div_ps(_mm_set1_ps(scale), length);
+	xr = roundSignedSSE41(_mm_mul_ps(x, s));
+	yr = roundSignedSSE41(_mm_mul_ps(y, s));
+	zr = roundSignedSSE41(_mm_mul_ps(z, s));
+}
+
+// Four 4 byte elements per step, the components are sign extended out of each 32 bit lane
+GLTF_TARGET("sse4.1")
+static size_t unfilterOctahedral8SSE41(unsigned char* data, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i* element = reinterpret_cast<__m128i*>(data + i * 4);
+		const __m128i packed = _mm_loadu_si128(element);
+		const __m128i xi = _mm_srai_epi32(_mm_slli_epi32(packed, 24), 24);
+		const __m128i yi = _mm_srai_epi32(_mm_slli_epi32(packed, 16), 24);
+		const __m128i zi = _mm_srai_epi32(_mm_slli_epi32(packed, 8), 24);
+
+		__m128i xr, yr, zr;
+		octahedralSSE41(xi, yi, zi, 127.0f, xr, yr, zr);
+
+		const __m128i byteMask = _mm_set1_epi32(0xFF);
+		__m128i result = _mm_and_si128(packed, _mm_set1_epi32(static_cast<int>(0xFF000000u)));
+		result = _mm_or_si128(result, _mm_and_si128(xr, byteMask));
+		result = _mm_or_si128(result, _mm_slli_epi32(_mm_and_si128(yr, byteMask), 8));
+		result = _mm_or_si128(result, _mm_slli_epi32(_mm_and_si128(zr, byteMask), 16));
+		_mm_storeu_si128(element, result);
+	}
+	return i;
+}
+
+// Four 8 byte elements per step, split into their xy and zw halves
+GLTF_TARGET("sse4.1")
+static size_t unfilterOctahedral16SSE41(unsigned char* data, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i* elements = reinterpret_cast<__m128i*>(data + i * 8);
+		const __m128 first = _mm_castsi128_ps(_mm_loadu_si128(elements));
+		const __m128 second = _mm_castsi128_ps(_mm_loadu_si128(elements + 1));
+		const __m128i xy = _mm_castps_si128(_mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)));
+		const __m128i zw = _mm_castps_si128(_mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)));
+		const __m128i xi = _mm_srai_epi32(_mm_slli_epi32(xy, 16), 16);
+		const __m128i yi = _mm_srai_epi32(xy, 16);
+		const __m128i zi = _mm_srai_epi32(_mm_slli_epi32(zw, 16), 16);
+
+		__m128i xr, yr, zr;
+		octahedralSSE41(xi, yi, zi, 32767.0f, xr, yr, zr);
+
+		const __m128i low = _mm_set1_epi32(0xFFFF);
+		const __m128i xyr = _mm_or_si128(_mm_and_si128(xr, low), _mm_slli_epi32(yr, 16));
+		const __m128i zwr = _mm_or_si128(_mm_and_si128(zr, low), _mm_andnot_si128(low, zw));
+		_mm_storeu_si128(elements, _mm_unpacklo_epi32(xyr, zwr));
+		_mm_storeu_si128(elements + 1, _mm_unpackhi_epi32(xyr, zwr));
+	}
+	return i;
+}
+
+// Four elements per step, assembled as w, x, y, z and rotated into place by the dropped component
+GLTF_TARGET("sse4.1")
+static size_t unfilterQuaternionSSE41(unsigned char* data, size_t count)
+{
+	const float scale = 1.0f / std::sqrt(2.0f);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i* elements = reinterpret_cast<__m128i*>(data + i * 8);
+		const __m128 first = _mm_castsi128_ps(_mm_loadu_si128(elements));
+		const __m128 second = _mm_castsi128_ps(_mm_loadu_si128(elements + 1));
+		const __m128i xy = _mm_castps_si128(_mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)));
+		const __m128i zc = _mm_castps_si128(_mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)));
+		const __m128i ci = _mm_srai_epi32(zc, 16);
+
+		const __m128 s = _mm_div_ps(_mm_set1_ps(scale), _mm_cvtepi32_ps(_mm_or_si128(ci, _mm_set1_epi32(3))));
+		const __m128 x = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(xy, 16), 16)), s);
+		const __m128 y = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(xy, 16)), s);
+		const __m128 z = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(zc, 16), 16)), s);
+		const __m128 ww = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(x, x)), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+		const __m128 w = _mm_sqrt_ps(_mm_max_ps(ww, _mm_setzero_ps()));
+
+		const __m128 full = _mm_set1_ps(32767.0f);
+		const __m128i xr = roundSignedSSE41(_mm_mul_ps(x, full));
+		const __m128i yr = roundSignedSSE41(_mm_mul_ps(y, full));
+		const __m128i zr = roundSignedSSE41(_mm_mul_ps(z, full));
+		const __m128i wr = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(w, full), _mm_set1_ps(0.5f)));
+
+		const __m128i low = _mm_set1_epi32(0xFFFF);
+		const __m128i wx = _mm_or_si128(_mm_and_si128(wr, low), _mm_slli_epi32(xr, 16));
+		const __m128i yz = _mm_or_si128(_mm_and_si128(yr, low), _mm_slli_epi32(zr, 16));
+
+		alignas(16) uint64_t assembled[4];
+		alignas(16) int32_t dropped[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(assembled), _mm_unpacklo_epi32(wx, yz));
+		_mm_store_si128(reinterpret_cast<__m128i*>(assembled + 2), _mm_unpackhi_epi32(wx, yz));
+		_mm_store_si128(reinterpret_cast<__m128i*>(dropped), _mm_and_si128(ci, _mm_set1_epi32(3)));
+		for (int k = 0; k != 4; ++k) {
+			const int bits = dropped[k] * 16;
+			const uint64_t element = bits == 0 ? assembled[k] : (assembled[k] << bits) | (assembled[k] >> (64 - bits));
+			std::memcpy(data + (i + k) * 8, &element, sizeof(element));
+		}
+	}
+	return i;
+}
+
+GLTF_TARGET("sse4.1")
+static size_t unfilterExponentialSSE41(unsigned char* data, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i* values = reinterpret_cast<__m128i*>(data + i * 4);
+		const __m128i packed = _mm_loadu_si128(values);
+		const __m128i mantissa = _mm_srai_epi32(_mm_slli_epi32(packed, 8), 8);
+		const __m128i exponent = _mm_srai_epi32(packed, 24);
+		const __m128 power = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(exponent, _mm_set1_epi32(127)), 23));
+		_mm_storeu_si128(values, _mm_castps_si128(_mm_mul_ps(power, _mm_cvtepi32_ps(mantissa))));
+	}
+	return i;
+}
+
+#endif
+
+bool unfilterMeshopt(unsigned char* data, size_t count, size_t byteStride, Meshopt_Filter filter)
+{
+	size_t done = 0;
+#if defined(GLTF_X86)
+	const bool simd = getCpuFeatures().sse41;
+#else
+	const bool simd = false;
+#endif
+	(void)simd;
+
+	switch (filter) {
+	case MESHOPT_FILTER_NONE:
+		return true;
+	case MESHOPT_FILTER_OCTAHEDRAL:
+		if (byteStride == 4) {
+#if defined(GLTF_X86)
+			done = simd ? unfilterOctahedral8SSE41(data, count) : 0;
+#endif
+			unfilterOctahedral<int8_t>(data, done, count);
+			return true;
+		}
+		if (byteStride == 8) {
+#if defined(GLTF_X86)
+			done = simd ? unfilterOctahedral16SSE41(data, count) : 0;
+#endif
+			unfilterOctahedral<int16_t>(data, done, count);
+			return true;
+		}
+		return false;
+	case MESHOPT_FILTER_QUATERNION:
+		if (byteStride != 8) {
+			return false;
+		}
+#if defined(GLTF_X86)
+		done = simd ? unfilterQuaternionSSE41(data, count) : 0;
+#endif
+		unfilterQuaternion(data, done, count);
+		return true;
+	case MESHOPT_FILTER_EXPONENTIAL: {
+		if (byteStride % 4 != 0) {
+			return false;
+		}
+		const size_t values = count * (byteStride / 4);
+#if defined(GLTF_X86)
+		done = simd ? unfilterExponentialSSE41(data, values) : 0;
+#endif
+		unfilterExponential(data, done, values);
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+bool decodeMeshoptView(const Meshopt_Compression& compression, const unsigned char* data, unsigned char* out)
+{
+	switch (compression.mode) {
+	case MESHOPT_ATTRIBUTES:
+		return decodeMeshoptAttributes(out, compression.count, compression.byteStride, data, compression.byteLength) &&
+			unfilterMeshopt(out, compression.count, compression.byteStride, compression.filter);
+	case MESHOPT_TRIANGLES:
+		return compression.filter == MESHOPT_FILTER_NONE &&
+			decodeMeshoptTriangles(out, compression.count, compression.byteStride, data, compression.byteLength);
+	case MESHOPT_INDICES:
+		return compression.filter == MESHOPT_FILTER_NONE &&
+			decodeMeshoptIndices(out, compression.count, compression.byteStride, data, compression.byteLength);
+	default:
+		return false;
+	}
+}
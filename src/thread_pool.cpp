@@ -0,0 +1,81 @@
+#include "../include/thread_pool.h"
+
+
+ThreadPool::ThreadPool(unsigned int workers)
+{
+	if (workers == 0) {
+		workers = std::max(1u, std::thread::hardware_concurrency());
+	}
+	threads.reserve(workers);
+	for (unsigned int i = 0; i != workers; ++i) {
+		threads.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	ready.notify_all();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+std::future<void> ThreadPool::Submit(std::function<void()> task)
+{
+	std::packaged_task<void()> packaged(std::move(task));
+	std::future<void> result = packaged.get_future();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(std::move(packaged));
+	}
+	ready.notify_one();
+	return result;
+}
+
+void ThreadPool::work()
+{
+	for (;;) {
+		std::packaged_task<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			ready.wait(lock, [this]() { return stopping || !queue.empty(); });
+			if (queue.empty()) {
+				return;
+			}
+			task = std::move(queue.front());
+			queue.pop_front();
+		}
+		task();
+	}
+}
+
+ByteBudget::ByteBudget(size_t capacity)
+	: capacity(capacity)
+{
+}
+
+void ByteBudget::Acquire(size_t bytes)
+{
+	if (capacity == 0) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	released.wait(lock, [this, bytes]() { return inFlight == 0 || inFlight + bytes <= capacity; });
+	inFlight += bytes;
+}
+
+void ByteBudget::Release(size_t bytes)
+{
+	if (capacity == 0) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		inFlight -= bytes;
+	}
+	released.notify_all();
+}
@@ -0,0 +1,148 @@
+#include "../include/vertex_encoding.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+const char* const OCTAHEDRAL_DECODE_GLSL =
+	"vec3 decodeOctahedral(vec2 e)\n"
+	"{\n"
+	"\tvec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+	"\tfloat t = max(-v.z, 0.0);\n"
+	"\tv.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);\n"
+	"\treturn normalize(v);\n"
+	"}\n";
+
+const char* const TANGENT_DECODE_GLSL =
+	"vec4 decodeTangent(vec2 e)\n"
+	"{\n"
+	"\treturn vec4(decodeOctahedral(vec2(e.x, abs(e.y) * 2.0 - 1.0)), e.y < 0.0 ? -1.0 : 1.0);\n"
+	"}\n";
+
+// The largest snorm integer of the given bits, which stands for 1
+static float snormScale(unsigned int bits)
+{
+	return static_cast<float>((1 << (bits - 1)) - 1);
+}
+
+// A snorm integer as the GPU maps it to [-1, 1], the most negative value clamped to -1
+static float snormToFloat(int32_t value, float scale)
+{
+	return std::max(static_cast<float>(value) / scale, -1.0f);
+}
+
+// The point of the octahedral map of a vector, both components in [-1, 1]
+static void mapOctahedral(const float* vector, float& u, float& v)
+{
+	const float length = std::fabs(vector[0]) + std::fabs(vector[1]) + std::fabs(vector[2]);
+	if (length == 0.0f) {
+		u = 0.0f;
+		v = 0.0f;
+		return;
+	}
+	u = vector[0] / length;
+	v = vector[1] / length;
+	// The lower half folds over the diagonals onto the corners
+	if (vector[2] < 0.0f) {
+		const float foldedU = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+		const float foldedV = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+		u = foldedU;
+		v = foldedV;
+	}
+}
+
+// The unit vector of a point of the octahedral map, as OCTAHEDRAL_DECODE_GLSL computes it
+static void unmapOctahedral(float u, float v, float* vector)
+{
+	float z = 1.0f - std::fabs(u) - std::fabs(v);
+	const float t = std::max(-z, 0.0f);
+	u += u >= 0.0f ? -t : t;
+	v += v >= 0.0f ? -t : t;
+	const float length = std::sqrt(u * u + v * v + z * z);
+	vector[0] = u / length;
+	vector[1] = v / length;
+	vector[2] = z / length;
+}
+
+static float dot3(const float* a, const float* b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+void encodeOctahedral(const float* vector, unsigned int bits, int32_t* encoded)
+{
+	const float scale = snormScale(bits);
+	float u;
+	float v;
+	mapOctahedral(vector, u, v);
+	float bestDot = -2.0f;
+	for (int rounding = 0; rounding != 4; ++rounding) {
+		const int32_t candidate[2] = {
+			static_cast<int32_t>(std::clamp(rounding & 1 ? std::ceil(u * scale) : std::floor(u * scale), -scale, scale)),
+			static_cast<int32_t>(std::clamp(rounding & 2 ? std::ceil(v * scale) : std::floor(v * scale), -scale, scale)) };
+		float decoded[3];
+		decodeOctahedral(candidate, bits, decoded);
+		const float alignment = dot3(decoded, vector);
+		if (alignment > bestDot) {
+			bestDot = alignment;
+			encoded[0] = candidate[0];
+			encoded[1] = candidate[1];
+		}
+	}
+}
+
+void decodeOctahedral(const int32_t* encoded, unsigned int bits, float* vector)
+{
+	const float scale = snormScale(bits);
+	unmapOctahedral(snormToFloat(encoded[0], scale), snormToFloat(encoded[1], scale), vector);
+}
+
+void encodeTangent(const float* tangent, unsigned int bits, int32_t* encoded)
+{
+	const float scale = snormScale(bits);
+	float u;
+	float v;
+	mapOctahedral(tangent, u, v);
+	// v moves to [0, 1]. It never reaches 0, so its sign survives the snorm conversion.
+	const float remapped = v * 0.5f + 0.5f;
+	const int32_t sign = tangent[3] < 0.0f ? -1 : 1;
+	float bestDot = -2.0f;
+	for (int rounding = 0; rounding != 4; ++rounding) {
+		const int32_t candidate[2] = {
+			static_cast<int32_t>(std::clamp(rounding & 1 ? std::ceil(u * scale) : std::floor(u * scale), -scale, scale)),
+			sign * static_cast<int32_t>(std::clamp(rounding & 2 ? std::ceil(remapped * scale) : std::floor(remapped * scale), 1.0f, scale)) };
+		float decoded[4];
+		decodeTangent(candidate, bits, decoded);
+		const float alignment = dot3(decoded, tangent);
+		if (alignment > bestDot) {
+			bestDot = alignment;
+			encoded[0] = candidate[0];
+			encoded[1] = candidate[1];
+		}
+	}
+}
+
+void decodeTangent(const int32_t* encoded, unsigned int bits, float* tangent)
+{
+	const float scale = snormScale(bits);
+	const float second = snormToFloat(encoded[1], scale);
+	unmapOctahedral(snormToFloat(encoded[0], scale), std::fabs(second) * 2.0f - 1.0f, tangent);
+	tangent[3] = second < 0.0f ? -1.0f : 1.0f;
+}
+
+float halfToFloat(uint16_t half)
+{
+	const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+	const uint32_t exponent = (half >> 10) & 0x1Fu;
+	const uint32_t mantissa = half & 0x3FFu;
+	if (exponent == 0) {
+		// Zero or a subnormal, the mantissa counts steps of 2^-24
+		const float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+		return sign ? -magnitude : magnitude;
+	}
+	const uint32_t bits = sign | (exponent == 0x1Fu ? 0x7F800000u : (exponent + 127 - 15) << 23) | mantissa << 13;
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}